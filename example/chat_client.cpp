@@ -67,10 +67,6 @@ private:
 };
 
 bool shutdown_requested = false;
-void on_shutdown_requested(int)
-{
-    shutdown_requested = true;
-}
 
 void print_usage()
 {
@@ -275,10 +271,17 @@ void chat_client::run()
         }
     });
 
-    while (!shutdown_requested)
-    {
-        manager.service();
-    }
+    manager.on_signal(SIGINT, [&manager](auto const &) {
+        manager.stop();
+    });
+    manager.on_idle([&manager]() {
+        if (shutdown_requested)
+        {
+            manager.stop();
+        }
+    });
+
+    manager.run();
 }
 
 
@@ -290,8 +293,6 @@ int main(int argc, char* argv[])
 
     if (!ctx.show_help)
     {
-        signal(SIGINT, on_shutdown_requested);
-
         try
         {
             chat_client client(ctx.name, ctx.path);
@@ -12,6 +12,7 @@
 #include <sys/un.h>
 
 #include <csignal>
+#include <chrono>
 
 #include <string>
 #include <iostream>
@@ -67,10 +68,6 @@ private:
 };
 
 bool shutdown_requested = false;
-void on_shutdown_requested(int)
-{
-    shutdown_requested = true;
-}
 
 void print_usage()
 {
@@ -279,7 +276,12 @@ void chat_server::run()
     sockman::manager manager;
     std::unordered_map<int, std::shared_ptr<connection>> connections;
 
-    manager.add(fd, sockman::readable, [&connections, &manager](int sock, auto events){
+    // each client may send up to 5 messages per second, with bursts of 20
+    sockman::shaping_options flood_control;
+    flood_control.receive_events.rate = 5.0;
+    flood_control.receive_events.burst = 20;
+
+    manager.add(fd, sockman::readable, [&connections, &manager, &flood_control](int sock, auto events){
         if (events.readable())
         {
             int client_fd = ::accept(sock, nullptr, nullptr);
@@ -331,14 +333,35 @@ void chat_server::run()
                         manager.remove(fd);
                     }
                 });
+                manager.track_inactivity(client_fd);
+                manager.set_rate_limit(client_fd, flood_control);
             }
         }
     });
 
-    while (!shutdown_requested)
-    {
-        manager.service();
-    }
+    // drop clients which did not send anything for 10 minutes
+    manager.set_inactivity_timeout(std::chrono::minutes(10), [&connections, &manager](int sock) {
+        auto it = connections.find(sock);
+        if (it != connections.end())
+        {
+            std::cout << it->second->get_name() << " timed out" << std::endl;
+            it->second->send("Bye, you have been idle for too long");
+            connections.erase(it);
+        }
+        manager.remove(sock);
+    });
+
+    manager.on_signal(SIGINT, [&manager](auto const &) {
+        manager.stop();
+    });
+    manager.on_idle([&manager]() {
+        if (shutdown_requested)
+        {
+            manager.stop();
+        }
+    });
+
+    manager.run();
 
     for(auto const &entry: connections)
     {
@@ -356,8 +379,6 @@ int main(int argc, char* argv[])
 
     if (!ctx.show_help)
     {
-        signal(SIGINT, on_shutdown_requested);
-
         try
         {
             chat_server server(ctx.path);
@@ -21,12 +21,6 @@
 namespace
 {
 
-bool shutdown_requested = false;
-void on_shutdown_requested(int)
-{
-    shutdown_requested = true;
-}
-
 class connection
 {
 public:
@@ -49,7 +43,7 @@ public:
         return fd;
     }
 
-    void connect(std::string const & path)
+    void connect(sockman::manager & manager, std::string const & path, sockman::connect_callback callback)
     {
         if (path.size() > 107)
         {
@@ -61,12 +55,7 @@ public:
         address.sun_family = AF_LOCAL;
         strcpy(address.sun_path, path.c_str());
 
-        int rc = ::connect(fd, (sockaddr*) &address, sizeof(address));
-        if (0 != rc)
-        {
-            ::close(fd);
-            throw std::runtime_error("connect failed");
-        }
+        manager.connect(fd, (sockaddr*) &address, sizeof(address), callback);
     }
 
     void write(std::string const & value)
@@ -123,61 +112,66 @@ int main(int argc, char * argv[])
 {
     if (argc > 1)
     {
-        signal(SIGINT, on_shutdown_requested);
         std::string path = argv[1];
 
         sockman::manager manager;
         std::queue<std::string> messages;
 
         connection conn;
-        conn.connect(path);
-
-        manager.add(conn.get_fd(), sockman::readable, [&manager, &conn, &messages](int, auto events){
-            if ((events.error()) || (events.hungup()))
+        conn.connect(manager, path, [&manager, &conn, &messages](int, int error){
+            if (0 != error)
             {
-                shutdown_requested = true;
+                std::cerr << "error: connect failed" << std::endl;
+                manager.stop();
+                return;
             }
-            else if (events.readable())
-            {
-                std::cout << conn.read() << std::endl;
-            }
-            else if (events.writable())
-            {
-                if (!messages.empty())
+
+            manager.add(conn.get_fd(), sockman::readable, [&manager, &conn, &messages](int, auto events){
+                if ((events.error()) || (events.hungup()))
                 {
-                    conn.write(messages.front());
-                    messages.pop();
+                    manager.stop();
                 }
+                else if (events.readable())
+                {
+                    std::cout << conn.read() << std::endl;
+                }
+                else if (events.writable())
+                {
+                    if (!messages.empty())
+                    {
+                        conn.write(messages.front());
+                        messages.pop();
+                    }
 
-                manager.notify_on_writable(conn.get_fd(), !messages.empty());
-            }
+                    manager.notify_on_writable(conn.get_fd(), !messages.empty());
+                }
 
-        });
+            });
 
-        manager.add(STDIN_FILENO, sockman::readable, [&manager, &conn, &messages](int, auto events){
-            if (events.readable())
-            {
-                std::string line;
-                if (std::getline(std::cin, line))
+            manager.add(STDIN_FILENO, sockman::readable, [&manager, &conn, &messages](int, auto events){
+                if (events.readable())
                 {
-                    messages.push(line);
-                    manager.notify_on_writable(conn.get_fd());
+                    std::string line;
+                    if (std::getline(std::cin, line))
+                    {
+                        messages.push(line);
+                        manager.notify_on_writable(conn.get_fd());
+                    }
                 }
-            }
+            });
         });
 
+        manager.on_signal(SIGINT, [&manager](auto const &) {
+            manager.stop();
+        });
 
-        while (!shutdown_requested)
+        try
         {
-            try
-            {
-                manager.service();
-            }
-            catch (std::exception const & ex)
-            {
-                std::cerr << "error: " << ex.what() << std::endl;
-                shutdown_requested = true;
-            }
+            manager.run();
+        }
+        catch (std::exception const & ex)
+        {
+            std::cerr << "error: " << ex.what() << std::endl;
         }
 
         std::cout << "shutdown" << std::endl;        
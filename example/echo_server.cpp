@@ -22,13 +22,6 @@
 namespace
 {
 
-bool shutdown_requested = false;
-void on_shutdown_requested(int)
-{
-    shutdown_requested = true;
-}
-
-
 class connection
 {
     connection(sockman::manager& manager, int sock, int id)
@@ -75,7 +68,9 @@ public:
 
     void on_readable()
     {
-        uint8_t buffer[257];
+        // pooled, so the reply is queued without copying
+        auto message = manager_.buffers().allocate(257);
+        uint8_t * buffer = reinterpret_cast<uint8_t*>(message.data());
         auto count = ::read(fd, buffer, 1);
         if (count != 1)
         {
@@ -94,12 +89,9 @@ public:
         buffer[buffer[0] + 1] = '\0';
         std::cout << "connection #" << id_ << ": received: " << buffer << std::endl;
 
-        count = ::write(fd, buffer, buffer[0] + 1);
-        if (count != (buffer[0] + 1))
-        {
-            manager_.remove(fd);
-            return;
-        }
+        // gathered with other replies of the same batch and written at its end
+        message.resize(buffer[0] + 1);
+        manager_.send(fd, message);
     }
 
     void on_hungup()
@@ -204,16 +196,15 @@ int main(int argc, char* argv[])
 {
     if (argc > 1)
     {
-        signal(SIGINT, on_shutdown_requested);
         std::string path = argv[1];
 
         sockman::manager manager;
         auto server = listener::create(manager, path);
 
-        while (!shutdown_requested)
-        {
-            manager.service();
-        }
+        manager.on_signal(SIGINT, [&manager](auto const &) {
+            manager.stop();
+        });
+        manager.run();
     }
     else
     {
@@ -15,17 +15,6 @@
 #include <csignal>
 #include <iostream>
 
-namespace
-{
-
-bool shutdown_requested = false;
-void on_shutdown_requested(int)
-{
-    shutdown_requested = true;
-}
-
-}
-
 int main()
 {
     constexpr char const path[] = "/tmp/sockman_simple.sock";
@@ -60,31 +49,23 @@ int main()
     }
 
     sockman::manager manager;
-    manager.add(fd, sockman::readable, [](int sock, auto events) {
-        if (events.error() || events.hungup())
-        {
-            std::cout << "shutdown..." << std::endl;
-            shutdown_requested = true;
-        }
-        else if (events.readable())
-        {
-            int const client_fd = accept(sock, nullptr, nullptr);
-            if (0 <= client_fd)
-            {
-                std::cout << "new connection: send hello message" << std::endl;
-                
-                char const message[] = "Hello";
-                write(client_fd, reinterpret_cast<void const*>(message), strlen(message));
-                close(client_fd);
-            }
-        }
+    // at most 100 accepts per second; excess connections wait in the backlog
+    sockman::listener_options options;
+    options.accept_rate = 100.0;
+    options.accept_burst = 10;
+    manager.add_listener(fd, options, [](int client_fd) {
+        std::cout << "new connection: send hello message" << std::endl;
+
+        char const message[] = "Hello";
+        write(client_fd, reinterpret_cast<void const*>(message), strlen(message));
+        close(client_fd);
     });
- 
+
     std::cout << "waiting for incoming connections on " << path << std::endl;
-    while (!shutdown_requested)
-    {
-        manager.service();
-    }
+    manager.on_signal(SIGINT, [&manager](auto const &) {
+        manager.stop();
+    });
+    manager.run();
  
     manager.remove(fd);
     close(fd);
@@ -36,12 +36,11 @@ int main()
         return EXIT_FAILURE;
     }
  
-    bool shutdown_requested = false;
     sockman::manager manager;
-    manager.add(fd, sockman::readable, [&shutdown_requested](int sock, auto events) {
+    manager.add(fd, sockman::readable, [&manager](int sock, auto events) {
         if (events.error() || events.hungup())
         {
-            shutdown_requested = true;
+            manager.stop();
         }
         if (events.readable())
         {
@@ -55,10 +54,7 @@ int main()
         }
     });
  
-    while (!shutdown_requested)
-    {
-        manager.service();
-    }
+    manager.run();
  
     manager.remove(fd);
     ::close(fd);
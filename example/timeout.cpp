@@ -13,9 +13,11 @@
 namespace
 {
 
+using clock = std::chrono::steady_clock;
+
 struct timeout_id
 {
-    int64_t timeout;
+    clock::time_point timeout;
     int id;
 
     bool operator<(timeout_id const & other) const
@@ -38,9 +40,8 @@ public:
     timeout_manager();
     timeout_id add(int millis, std::function<void()> handler);
     void remove(timeout_id id);
-    int poll();
+    clock::time_point poll();
 private:
-    int64_t now() const;
     int id_;
     std::map<timeout_id, std::function<void()>> timeouts;
 };
@@ -53,7 +54,7 @@ timeout_manager::timeout_manager()
 
 timeout_id timeout_manager::add(int millis, std::function<void()> handler)
 {
-    timeout_id id = {now() + millis, ++id_};
+    timeout_id id = {clock::now() + std::chrono::milliseconds(millis), ++id_};
     timeouts.emplace(id, handler);    
     return id;
 }
@@ -63,9 +64,9 @@ void timeout_manager::remove(timeout_id id)
     timeouts.erase(id);
 }
 
-int timeout_manager::poll()
+clock::time_point timeout_manager::poll()
 {
-    auto now_ = now();
+    auto now_ = clock::now();
     auto entry = timeouts.begin();
     while ((entry != timeouts.end()) && (entry->first.timeout < now_))
     {
@@ -76,22 +77,15 @@ int timeout_manager::poll()
         entry = timeouts.begin();
     }
 
-    int result = -1;
+    clock::time_point result = clock::time_point::max();
     if (entry != timeouts.end())
     {
-        result = entry->first.timeout - now_;
+        result = entry->first.timeout;
     }
 
     return result;
 }
 
-int64_t timeout_manager::now() const
-{
-    auto now_ = std::chrono::steady_clock::now();
-    auto now_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(now_);
-    return now_ms.time_since_epoch().count();
-}
-
 }
 
 
@@ -116,12 +110,12 @@ int main(int argc, char * argv[])
         shutdown_requested = true;
     });
 
-    int timeout = timeouts.poll();
+    auto deadline = timeouts.poll();
     while (!shutdown_requested)
     {
         std::cout << "loop" << std::endl;
-        manager.service(timeout);
-        timeout = timeouts.poll();
+        manager.service_until(deadline);
+        deadline = timeouts.poll();
     }
 
     return EXIT_SUCCESS;
@@ -0,0 +1,53 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_AFFINITY_HPP
+#define SOCKMAN_AFFINITY_HPP
+
+namespace sockman
+{
+
+/// @brief pins the calling thread to a CPU
+///
+/// @throws std::exception failed to set the affinity
+///
+/// @param cpu index of the CPU
+void pin_thread_to_cpu(int cpu);
+
+/// @brief returns the NUMA node of a CPU
+///
+/// @param cpu index of the CPU
+/// @return NUMA node of the CPU or -1, if unknown
+int numa_node_of_cpu(int cpu);
+
+/// @brief sets the CPU, that should handle incoming packets of a socket (SO_INCOMING_CPU)
+///
+/// When set on listening sockets sharing a port via SO_REUSEPORT, the
+/// kernel prefers the listener whose CPU matches the CPU processing the
+/// incoming connection.
+///
+/// @throws std::exception failed to set socket option
+///
+/// @param sock socket to configure
+/// @param cpu index of the CPU
+void set_incoming_cpu(int sock, int cpu);
+
+/// @brief steers new connections of a SO_REUSEPORT group by receiving CPU
+///
+/// Attaches a classic BPF program to the group (SO_ATTACH_REUSEPORT_CBPF),
+/// which selects the listener at index (cpu % group_size). Listeners are
+/// indexed in the order they were bound, so the i-th listener should be
+/// serviced by a loop pinned to CPU i (modulo group_size).
+///
+/// @throws std::exception failed to attach the program
+///
+/// @param sock any listening socket of the group
+/// @param group_size number of listening sockets in the group
+void steer_reuseport_by_cpu(int sock, unsigned int group_size);
+
+}
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_BACKEND_HPP
+#define SOCKMAN_BACKEND_HPP
+
+#include <sys/epoll.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+
+namespace sockman
+{
+
+/// @brief readiness notification mechanism of a \ref manager
+///
+/// The manager registers descriptors together with an opaque data
+/// pointer, which is reported back by \ref wait using epoll_event.
+/// Control functions follow the conventions of epoll_ctl: they return
+/// 0 on success and -1 on failure with errno set.
+class backend
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    virtual ~backend() = default;
+
+    /// @brief starts watching a descriptor
+    /// @param fd descriptor to watch
+    /// @param events epoll event mask
+    /// @param data pointer reported with events of fd
+    /// @return 0 on success, -1 otherwise
+    virtual int add(int fd, uint32_t events, void * data) = 0;
+
+    /// @brief changes the event mask of a watched descriptor
+    /// @param fd watched descriptor
+    /// @param events epoll event mask
+    /// @param data pointer reported with events of fd
+    /// @return 0 on success, -1 otherwise
+    virtual int modify(int fd, uint32_t events, void * data) = 0;
+
+    /// @brief stops watching a descriptor
+    /// @param fd watched descriptor
+    /// @return 0 on success, -1 otherwise
+    virtual int remove(int fd) = 0;
+
+    /// @brief waits for events
+    ///
+    /// time_point::min polls without waiting,
+    /// time_point::max waits without a deadline.
+    ///
+    /// @param events array to store events
+    /// @param max_events size of events
+    /// @param deadline point in time to stop waiting
+    /// @return number of events, -1 on error
+    virtual int wait(epoll_event * events, int max_events, clock::time_point deadline) = 0;
+
+    /// @brief arms the alarm, which is reported as EPOLLIN event with data
+    ///
+    /// There is only a single alarm; arming it again replaces the
+    /// previous deadline and clears an expiration not waited for yet.
+    ///
+    /// @param deadline point in time the alarm fires, time_point::max disarms it
+    /// @param data pointer reported when the alarm fires
+    virtual void set_alarm(clock::time_point deadline, void * data) = 0;
+
+    /// @brief returns the current time of the backend
+    /// @return current time
+    virtual clock::time_point now() const = 0;
+
+    /// @brief returns a descriptor, which becomes readable when events are pending
+    /// @return descriptor or -1 if not available
+    virtual int native_handle() const = 0;
+};
+
+/// @brief backend based on epoll
+///
+/// Uses epoll_pwait2 for waits with nanosecond resolution if
+/// supported by the kernel, a timerfd otherwise.
+class epoll_backend final: public backend
+{
+    epoll_backend(epoll_backend const &) = delete;
+    epoll_backend& operator=(epoll_backend const &) = delete;
+public:
+    /// @brief creates an epoll instance
+    ///
+    /// @throws std::exception failed to create epoll instance
+    epoll_backend();
+
+    ~epoll_backend() override;
+
+    int add(int fd, uint32_t events, void * data) override;
+    int modify(int fd, uint32_t events, void * data) override;
+    int remove(int fd) override;
+    int wait(epoll_event * events, int max_events, clock::time_point deadline) override;
+    void set_alarm(clock::time_point deadline, void * data) override;
+    clock::time_point now() const override;
+    int native_handle() const override;
+
+private:
+    int wait_timerfd(epoll_event * events, int max_events, clock::time_point deadline);
+
+    int fd;
+    int timer_fd;
+    int alarm_fd;
+    bool has_pwait2;
+};
+
+/// @brief in-memory backend with virtual time
+///
+/// Readiness is injected by the test or benchmark instead of the
+/// kernel, so scenarios with many sockets, injected errors and
+/// reordered readiness can be driven through the real dispatch code
+/// reproducibly.
+///
+/// Time only advances by \ref advance or when \ref wait reaches its
+/// deadline without events; waits never block. Descriptors are not
+/// touched, so any number can be registered. Signals and wakeups of
+/// the manager are not delivered.
+class simulated_backend final: public backend
+{
+    simulated_backend(simulated_backend const &) = delete;
+    simulated_backend& operator=(simulated_backend const &) = delete;
+public:
+    simulated_backend();
+
+    ~simulated_backend() override;
+
+    int add(int fd, uint32_t events, void * data) override;
+    int modify(int fd, uint32_t events, void * data) override;
+    int remove(int fd) override;
+    int wait(epoll_event * events, int max_events, clock::time_point deadline) override;
+    void set_alarm(clock::time_point deadline, void * data) override;
+    clock::time_point now() const override;
+    int native_handle() const override;
+
+    /// @brief sets readiness of a descriptor
+    ///
+    /// Events are reported by each wait as long as they are set
+    /// and enabled by the interest mask of the descriptor.
+    /// EPOLLERR and EPOLLHUP are reported regardless of interest.
+    ///
+    /// Like epoll, descriptors registered with EPOLLET only report
+    /// events that became ready since the last report (or since the
+    /// interest was modified) and descriptors registered with
+    /// EPOLLONESHOT are disabled after a report until modified.
+    ///
+    /// @param fd descriptor
+    /// @param events ready events, 0 clears readiness
+    void set_ready(int fd, uint32_t events);
+
+    /// @brief reports events of a descriptor once
+    /// @param fd descriptor
+    /// @param events events to report by the next wait
+    void trigger(int fd, uint32_t events);
+
+    /// @brief advances virtual time
+    /// @param duration time to advance
+    void advance(std::chrono::nanoseconds duration);
+
+    /// @brief lets the next control operation fail
+    /// @param error errno value of the failure
+    void fail_next(int error);
+
+    /// @brief reorders reported events deterministically
+    /// @param seed seed of the reordering, 0 reports events in descriptor order
+    void shuffle(uint32_t seed);
+
+    /// @brief returns the number of watched descriptors
+    /// @return number of watched descriptors
+    std::size_t watched() const;
+
+    /// @brief returns the interest mask of a descriptor
+    /// @param fd descriptor
+    /// @return interest mask, 0 if not watched
+    uint32_t interest(int fd) const;
+
+private:
+    struct entry
+    {
+        uint32_t interest;
+        void * data;
+        uint32_t ready;
+        uint32_t triggered;
+        uint32_t edges;
+        bool armed;
+    };
+
+    bool take_failure();
+    uint32_t pending(entry const & e) const;
+    void update(int fd, entry const & e);
+
+    std::unordered_map<int, entry> entries;
+    std::set<int> candidates;
+    int cursor;
+    clock::time_point current;
+    clock::time_point alarm;
+    void * alarm_data;
+    int failure;
+    uint32_t seed_;
+};
+
+}
+
+#endif
@@ -0,0 +1,770 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_BASIC_MANAGER_HPP
+#define SOCKMAN_BASIC_MANAGER_HPP
+
+#include <sockman/sockman.hpp>
+#include <sockman/backend.hpp>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace sockman
+{
+
+/// @brief backend policy, which forwards to a \ref backend
+///
+/// Allows to drive a \ref basic_manager by a \ref simulated_backend
+/// or any other backend chosen at runtime.
+class dynamic_backend
+{
+    dynamic_backend(dynamic_backend const &) = delete;
+    dynamic_backend& operator=(dynamic_backend const &) = delete;
+public:
+    using clock = backend::clock;
+
+    /// @brief uses an \ref epoll_backend
+    dynamic_backend()
+    : impl(new epoll_backend())
+    {
+    }
+
+    /// @brief uses the given backend
+    ///
+    /// @throws std::exception invalid backend
+    ///
+    /// @param backend_ backend to forward to
+    explicit dynamic_backend(std::unique_ptr<backend> backend_)
+    : impl(std::move(backend_))
+    {
+        if (nullptr == impl)
+        {
+            throw std::runtime_error("invalid backend");
+        }
+    }
+
+    int add(int sock, uint32_t events, void * data)
+    {
+        return impl->add(sock, events, data);
+    }
+
+    int modify(int sock, uint32_t events, void * data)
+    {
+        return impl->modify(sock, events, data);
+    }
+
+    int remove(int sock)
+    {
+        return impl->remove(sock);
+    }
+
+    int wait(epoll_event * events, int max_events, clock::time_point deadline)
+    {
+        return impl->wait(events, max_events, deadline);
+    }
+
+    void set_alarm(clock::time_point deadline, void * data)
+    {
+        impl->set_alarm(deadline, data);
+    }
+
+    clock::time_point now() const
+    {
+        return impl->now();
+    }
+
+    int native_handle() const
+    {
+        return impl->native_handle();
+    }
+
+    /// @brief returns the underlying backend
+    backend & get()
+    {
+        return *impl;
+    }
+
+private:
+    std::unique_ptr<backend> impl;
+};
+
+/// @brief storage policy with a fixed number of slots
+///
+/// Slots are part of the manager, so there is no allocation
+/// after construction. Descriptors must be less than Capacity.
+template<std::size_t Capacity>
+struct fixed_storage
+{
+    template<typename Entry>
+    class container
+    {
+    public:
+        Entry * find(int fd)
+        {
+            return ((0 <= fd) && (Capacity > static_cast<std::size_t>(fd))) ? &(entries[static_cast<std::size_t>(fd)]) : nullptr;
+        }
+
+        Entry * allocate(int fd)
+        {
+            return find(fd);
+        }
+
+        template<typename Function>
+        void for_each(Function function)
+        {
+            for (std::size_t i = 0; i < Capacity; i++)
+            {
+                function(static_cast<int>(i), entries[i]);
+            }
+        }
+
+    private:
+        std::array<Entry, Capacity> entries;
+    };
+};
+
+/// @brief storage policy, which grows with the largest descriptor
+///
+/// Slots are never moved, so a callback may add sockets while it runs.
+struct growable_storage
+{
+    template<typename Entry>
+    class container
+    {
+    public:
+        Entry * find(int fd)
+        {
+            return ((0 <= fd) && (entries.size() > static_cast<std::size_t>(fd))) ? &(entries[static_cast<std::size_t>(fd)]) : nullptr;
+        }
+
+        Entry * allocate(int fd)
+        {
+            if ((0 <= fd) && (entries.size() <= static_cast<std::size_t>(fd)))
+            {
+                entries.resize(static_cast<std::size_t>(fd) + 1);
+            }
+            return find(fd);
+        }
+
+        template<typename Function>
+        void for_each(Function function)
+        {
+            for (std::size_t i = 0; i < entries.size(); i++)
+            {
+                function(static_cast<int>(i), entries[i]);
+            }
+        }
+
+    private:
+        std::deque<Entry> entries;
+    };
+};
+
+/// @brief threading policy of a manager used by a single thread
+///
+/// Only \ref basic_manager::stop may be called from other threads.
+struct single_thread
+{
+    struct mutex_type
+    {
+        void lock() { }
+        void unlock() { }
+    };
+};
+
+/// @brief threading policy, which allows to call all methods from any thread
+///
+/// Dispatching and control operations are serialized by a recursive
+/// mutex, so callbacks may call the manager. The mutex is not held
+/// while waiting for events.
+struct synchronized
+{
+    using mutex_type = std::recursive_mutex;
+};
+
+/// @brief instrumentation policy without any instrumentation
+struct no_instrumentation
+{
+    void waited(int count) { (void) count; }
+    void dispatched(int fd, uint32_t events) { (void) fd; (void) events; }
+};
+
+/// @brief instrumentation policy, which counts waits and dispatched events
+struct counting_instrumentation
+{
+    std::size_t waits = 0;
+    std::size_t events = 0;
+
+    void waited(int count) { (void) count; waits++; }
+    void dispatched(int fd, uint32_t received) { (void) fd; (void) received; events++; }
+};
+
+/// @brief policy used by \ref default_manager
+struct default_policy
+{
+    using backend_type = epoll_backend;
+    using storage_type = growable_storage;
+    using callback_type = socket_callback;
+    using threading = single_thread;
+    using instrumentation_type = no_instrumentation;
+};
+
+/// @brief socket manager configured at compile time
+///
+/// basic_manager is the event loop core of \ref manager, which hides
+/// its instantiation for a stable ABI. Used directly, all code of the
+/// dispatch path is visible to the compiler, so it can be inlined from
+/// the wait down to the callback. The policy selects:
+///
+/// - backend_type: \ref epoll_backend (called without virtual dispatch),
+///   \ref dynamic_backend or any type providing the functions of \ref backend
+/// - storage_type: \ref fixed_storage or \ref growable_storage
+/// - callback_type: callable with (int fd, socket_events), default
+///   constructible and move assignable, e.g. a function pointer or
+///   \ref socket_callback
+/// - threading: \ref single_thread or \ref synchronized
+/// - instrumentation_type: \ref no_instrumentation,
+///   \ref counting_instrumentation or any type providing the same hooks
+///
+/// Only the core of \ref manager is provided: sockets, interest, a single
+/// alarm, wakeup, service and run. Buffering, timers and signals are not.
+///
+/// Sockets may be added and removed while dispatching, including the
+/// socket whose callback is running, also from nested dispatches.
+/// Events of a socket, which was removed or replaced earlier in the same
+/// batch, are dropped.
+template<typename Policy>
+class basic_manager
+{
+    basic_manager(basic_manager const &) = delete;
+    basic_manager& operator=(basic_manager const &) = delete;
+
+public:
+    using backend_type = typename Policy::backend_type;
+    using callback_type = typename Policy::callback_type;
+    using clock = backend::clock;
+
+private:
+    using mutex_type = typename Policy::threading::mutex_type;
+    using instrumentation_type = typename Policy::instrumentation_type;
+
+    struct entry
+    {
+        callback_type callback = callback_type();
+        uint32_t events = 0;
+        uint32_t generation = 0; // 0: not registered
+    };
+
+    // a callback running for a descriptor; add and remove of the
+    // descriptor are parked in the outermost frame running it
+    struct frame
+    {
+        int fd;
+        callback_type pending;
+        bool has_pending;
+        frame * outer;
+    };
+
+    using storage_type = typename Policy::storage_type::template container<entry>;
+
+    // Tags are passed as data pointer: the generation in the upper bits,
+    // the descriptor in the lower bits. Generation 0 is reserved for
+    // internal tags; a null pointer is never dispatched.
+    static constexpr unsigned const tag_bits = sizeof(uintptr_t) * 8;
+    static constexpr unsigned const fd_bits = (64 <= tag_bits) ? 32 : 24;
+    static constexpr uintptr_t const fd_mask = (~static_cast<uintptr_t>(0)) >> (tag_bits - fd_bits);
+    static constexpr uintptr_t const generation_mask = (~static_cast<uintptr_t>(0)) >> fd_bits;
+    static constexpr uintptr_t const wakeup_tag = 1;
+    static constexpr uintptr_t const alarm_tag = 2;
+
+public:
+    /// @brief maximum number of events waited for by \ref service
+    static constexpr int const batch_size = 64;
+
+    /// @brief creates the manager
+    ///
+    /// @throws std::exception failed to create the backend or eventfd
+    ///
+    /// @param args arguments passed to the constructor of the backend
+    template<typename... Args>
+    explicit basic_manager(Args &&... args)
+    : poller(std::forward<Args>(args)...)
+    , wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , next_generation(1)
+    , running(nullptr)
+    , stop_flag(false)
+    {
+        if (0 > wake_fd)
+        {
+            throw std::runtime_error("failed to create eventfd");
+        }
+
+        if (0 != poller.add(wake_fd, EPOLLIN, to_data(wakeup_tag)))
+        {
+            ::close(wake_fd);
+            throw std::runtime_error("failed to add eventfd");
+        }
+    }
+
+    /// @brief releases the manager; sockets are not closed
+    ~basic_manager()
+    {
+        ::close(wake_fd);
+    }
+
+    /// @brief adds a socket; replaces a previous registration
+    ///
+    /// Events of the previous registration, that are not dispatched yet,
+    /// are dropped. A socket, that was closed without being removed, is
+    /// added again.
+    ///
+    /// @throws std::exception socket out of range of the storage or epoll_ctl failed
+    ///
+    /// @param sock socket to add
+    /// @param events events to listen (0, or any combination of epoll events)
+    /// @param callback callback to invoke on events
+    void add(int sock, uint32_t events, callback_type callback)
+    {
+        std::lock_guard<mutex_type> lock(mutex);
+
+        entry * const e = (0 <= sock) ? storage.allocate(sock) : nullptr;
+        if ((nullptr == e) || (fd_mask < static_cast<uintptr_t>(sock)))
+        {
+            throw std::runtime_error("invalid socket");
+        }
+
+        uint32_t const generation = new_generation();
+        void * const data = to_data(make_tag(sock, generation));
+        int rc;
+        if (0 != e->generation)
+        {
+            rc = poller.modify(sock, events, data);
+            if ((0 != rc) && (ENOENT == errno))
+            {
+                // closed without being removed; the descriptor was reused
+                rc = poller.add(sock, events, data);
+            }
+        }
+        else
+        {
+            rc = poller.add(sock, events, data);
+        }
+
+        if (0 != rc)
+        {
+            throw std::runtime_error("epoll_ctl: failed to add socket");
+        }
+
+        e->events = events;
+        e->generation = generation;
+        frame * const f = outermost(sock);
+        if (nullptr != f)
+        {
+            // the running callback is replaced once it returned
+            f->pending = std::move(callback);
+            f->has_pending = true;
+        }
+        else
+        {
+            e->callback = std::move(callback);
+        }
+    }
+
+    /// @brief removes a socket; unknown sockets are ignored
+    /// @param sock socket to remove
+    void remove(int sock)
+    {
+        std::lock_guard<mutex_type> lock(mutex);
+
+        entry * const e = storage.find(sock);
+        if ((nullptr == e) || (0 == e->generation))
+        {
+            return;
+        }
+
+        poller.remove(sock);
+        e->generation = 0;
+        e->events = 0;
+        frame * const f = outermost(sock);
+        if (nullptr != f)
+        {
+            // the running callback is released once it returned
+            f->pending = callback_type();
+            f->has_pending = false;
+        }
+        else
+        {
+            e->callback = callback_type();
+        }
+    }
+
+    /// @brief sets the events of a socket
+    ///
+    /// The events are always passed to the backend, so a one-shot
+    /// socket is re-armed, even if the events did not change.
+    ///
+    /// @throws std::exception socket not found or epoll_ctl failed
+    ///
+    /// @param sock socket to modify
+    /// @param events events to listen
+    void set_events(int sock, uint32_t events)
+    {
+        std::lock_guard<mutex_type> lock(mutex);
+
+        entry & e = registered(sock);
+        if (0 != poller.modify(sock, events, to_data(make_tag(sock, e.generation))))
+        {
+            throw std::runtime_error("epoll_ctl: failed to modify socket");
+        }
+        e.events = events;
+    }
+
+    /// @brief returns the callback of a registered socket
+    ///
+    /// While the callback of the socket runs, a callback replacing it
+    /// is returned. The pointer is valid until the socket is added or
+    /// removed.
+    ///
+    /// @param sock socket to look up
+    /// @return callback, nullptr if the socket is not registered
+    callback_type * find(int sock)
+    {
+        std::lock_guard<mutex_type> lock(mutex);
+
+        entry * const e = storage.find(sock);
+        return ((nullptr != e) && (0 != e->generation)) ? &current(sock, *e) : nullptr;
+    }
+
+    /// @brief invokes function(fd, callback) for each registered socket
+    ///
+    /// The function must not add or remove sockets.
+    ///
+    /// @param function function to invoke
+    template<typename Function>
+    void for_each(Function function)
+    {
+        std::lock_guard<mutex_type> lock(mutex);
+
+        storage.for_each([this, &function](int fd, entry & e) {
+            if (0 != e.generation)
+            {
+                function(fd, current(fd, e));
+            }
+        });
+    }
+
+    /// @brief enables or disables callbacks for readable events
+    ///
+    /// @throws std::exception socket not found
+    void notify_on_readable(int sock, bool enable = true)
+    {
+        modify(sock, EPOLLIN, enable);
+    }
+
+    /// @brief enables or disables callbacks for writable events
+    ///
+    /// @throws std::exception socket not found
+    void notify_on_writable(int sock, bool enable = true)
+    {
+        modify(sock, EPOLLOUT, enable);
+    }
+
+    /// @brief waits for one batch of events and dispatches it
+    /// @param timeout timeout in milliseconds (-1 waits infinitely)
+    void service(int timeout = -1)
+    {
+        clock::time_point deadline = clock::time_point::max();
+        if (0 == timeout)
+        {
+            deadline = clock::time_point::min();
+        }
+        else if (0 < timeout)
+        {
+            deadline = now() + std::chrono::milliseconds(timeout);
+        }
+
+        epoll_event events[batch_size];
+        int const count = wait(events, batch_size, deadline);
+        dispatch(events, count);
+    }
+
+    /// @brief services the manager until \ref stop is called
+    void run()
+    {
+        while (!stop_requested())
+        {
+            service(-1);
+        }
+
+        clear_stop();
+    }
+
+    /// @brief stops \ref run; can be called from any thread
+    ///
+    /// A stop requested while no loop is running makes the next
+    /// loop return immediately.
+    void stop()
+    {
+        stop_flag = true;
+        wakeup();
+    }
+
+    /// @brief returns true, if \ref stop was called and not cleared yet
+    bool stop_requested() const
+    {
+        return stop_flag;
+    }
+
+    /// @brief clears a requested stop; called by loops when they return
+    void clear_stop()
+    {
+        stop_flag = false;
+    }
+
+    /// @brief wakes up a blocked wait; can be called from any thread
+    void wakeup()
+    {
+        uint64_t const value = 1;
+        auto const count = ::write(wake_fd, &value, sizeof(value));
+        (void) count;
+    }
+
+    /// @brief waits for events without dispatching them
+    ///
+    /// Allows to run code before and after each batch; pass the
+    /// events to \ref dispatch.
+    ///
+    /// @param events array to store events
+    /// @param max_events size of events
+    /// @param deadline point in time to stop waiting (see \ref backend::wait)
+    /// @return number of events, -1 on error
+    int wait(epoll_event * events, int max_events, clock::time_point deadline)
+    {
+        int const count = poller.wait(events, max_events, deadline);
+        instrumentation_.waited(count);
+        return count;
+    }
+
+    /// @brief dispatches events returned by \ref wait
+    /// @param events events to dispatch
+    /// @param count number of events (negative values are ignored)
+    void dispatch(epoll_event const * events, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            dispatch_event(events[i]);
+        }
+    }
+
+    /// @brief sets the callback invoked when the alarm fires
+    ///
+    /// The callback is invoked with -1 and EPOLLIN.
+    ///
+    /// @param callback callback to invoke
+    void on_alarm(callback_type callback)
+    {
+        std::lock_guard<mutex_type> lock(mutex);
+        alarm_callback = std::move(callback);
+    }
+
+    /// @brief arms the alarm; see \ref backend::set_alarm
+    /// @param deadline point in time the alarm fires, time_point::max disarms it
+    void set_alarm(clock::time_point deadline)
+    {
+        poller.set_alarm(deadline, to_data(alarm_tag));
+    }
+
+    /// @brief returns the current time of the backend
+    clock::time_point now() const
+    {
+        return poller.now();
+    }
+
+    /// @brief returns the descriptor of the backend
+    int native_handle() const
+    {
+        return poller.native_handle();
+    }
+
+    /// @brief returns the eventfd used by \ref wakeup
+    ///
+    /// Writing to it wakes up a blocked wait, e.g. from a signal handler.
+    int wakeup_handle() const
+    {
+        return wake_fd;
+    }
+
+    /// @brief returns the backend
+    backend_type & get_backend()
+    {
+        return poller;
+    }
+
+    /// @brief returns the instrumentation
+    instrumentation_type & instrumentation()
+    {
+        return instrumentation_;
+    }
+
+private:
+    static uintptr_t make_tag(int fd, uint32_t generation)
+    {
+        return (static_cast<uintptr_t>(generation) << fd_bits) | static_cast<uintptr_t>(fd);
+    }
+
+    static void * to_data(uintptr_t tag)
+    {
+        return reinterpret_cast<void*>(tag);
+    }
+
+    uint32_t new_generation()
+    {
+        uint32_t generation = static_cast<uint32_t>(next_generation++ & generation_mask);
+        if (0 == generation)
+        {
+            generation = static_cast<uint32_t>(next_generation++ & generation_mask);
+        }
+        return generation;
+    }
+
+    entry & registered(int sock)
+    {
+        entry * const e = storage.find(sock);
+        if ((nullptr == e) || (0 == e->generation))
+        {
+            throw std::runtime_error("socket not found");
+        }
+        return *e;
+    }
+
+    frame * outermost(int fd) const
+    {
+        frame * result = nullptr;
+        for (frame * f = running; nullptr != f; f = f->outer)
+        {
+            if (fd == f->fd)
+            {
+                result = f;
+            }
+        }
+        return result;
+    }
+
+    // the callback, that is in effect once running callbacks returned
+    callback_type & current(int fd, entry & e) const
+    {
+        frame * const f = outermost(fd);
+        return ((nullptr != f) && (f->has_pending)) ? f->pending : e.callback;
+    }
+
+    void modify(int sock, uint32_t mask, bool enable)
+    {
+        std::lock_guard<mutex_type> lock(mutex);
+
+        entry & e = registered(sock);
+        uint32_t const events = enable ? (e.events | mask) : (e.events & (~mask));
+        if (events != e.events)
+        {
+            if (0 != poller.modify(sock, events, to_data(make_tag(sock, e.generation))))
+            {
+                throw std::runtime_error("epoll_ctl: failed to modify socket");
+            }
+            e.events = events;
+        }
+    }
+
+    void dispatch_event(epoll_event const & event)
+    {
+        uintptr_t const tag = reinterpret_cast<uintptr_t>(event.data.ptr);
+        if (wakeup_tag == tag)
+        {
+            uint64_t value;
+            auto const count = ::read(wake_fd, &value, sizeof(value));
+            (void) count;
+            return;
+        }
+
+        std::lock_guard<mutex_type> lock(mutex);
+
+        if (alarm_tag == tag)
+        {
+            alarm_callback(-1, socket_events(event.events));
+            return;
+        }
+
+        int const fd = static_cast<int>(tag & fd_mask);
+        uint32_t const generation = static_cast<uint32_t>(tag >> fd_bits);
+        entry * const e = storage.find(fd);
+        if ((0 == generation) || (nullptr == e) || (generation != e->generation))
+        {
+            return;
+        }
+
+        instrumentation_.dispatched(fd, event.events);
+        frame current = {fd, callback_type(), false, running};
+        running = &current;
+        try
+        {
+            e->callback(fd, socket_events(event.events));
+        }
+        catch (...)
+        {
+            finish(*e, current);
+            throw;
+        }
+        finish(*e, current);
+    }
+
+    void finish(entry & e, frame & current)
+    {
+        running = current.outer;
+        if (nullptr != outermost(current.fd))
+        {
+            // an outer dispatch still runs the callback
+            return;
+        }
+
+        if (current.has_pending)
+        {
+            e.callback = std::move(current.pending);
+        }
+        else if (0 == e.generation)
+        {
+            e.callback = callback_type();
+        }
+    }
+
+    backend_type poller;
+    storage_type storage;
+    instrumentation_type instrumentation_;
+    mutex_type mutex;
+    int wake_fd;
+    uintptr_t next_generation;
+    frame * running;
+    callback_type alarm_callback;
+    std::atomic<bool> stop_flag;
+};
+
+/// @brief header-only manager with the default policy
+using default_manager = basic_manager<default_policy>;
+
+}
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_BUFFER_HPP
+#define SOCKMAN_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace sockman
+{
+
+struct buffer_pool_state;
+
+/// @brief header of a memory block managed by a \ref buffer_pool
+///
+/// @note this is an implementation detail of \ref buffer
+struct alignas(16) buffer_block
+{
+    buffer_pool_state * state;
+    buffer_block * next;
+    std::size_t capacity;
+    std::size_t size;
+    uint32_t refcount;
+    uint32_t size_class;
+
+    char * data()
+    {
+        return reinterpret_cast<char *>(this + 1);
+    }
+};
+
+/// @brief reference counted handle of a pooled memory block
+///
+/// Copies of a buffer share the same memory, so buffers can be passed
+/// to write queues without copying the data. The memory is returned to
+/// its pool when the last handle is destroyed.
+///
+/// @note reference counting is not synchronized; buffers must only
+///       be used by the thread owning the pool
+class buffer
+{
+public:
+    /// @brief creates an empty handle
+    buffer() noexcept
+    : block_(nullptr)
+    {
+    }
+
+    /// @brief shares the memory of another buffer
+    /// @param other buffer to share
+    buffer(buffer const & other) noexcept
+    : block_(other.block_)
+    {
+        if (nullptr != block_)
+        {
+            block_->refcount++;
+        }
+    }
+
+    /// @brief takes over the memory of another buffer
+    /// @param other buffer to take over
+    buffer(buffer && other) noexcept
+    : block_(other.block_)
+    {
+        other.block_ = nullptr;
+    }
+
+    /// @brief releases the memory
+    ~buffer()
+    {
+        release();
+    }
+
+    /// @brief shares the memory of another buffer
+    /// @param other buffer to share
+    /// @return reference to this buffer
+    buffer& operator=(buffer const & other) noexcept
+    {
+        buffer copy(other);
+        std::swap(block_, copy.block_);
+        return *this;
+    }
+
+    /// @brief takes over the memory of another buffer
+    /// @param other buffer to take over
+    /// @return reference to this buffer
+    buffer& operator=(buffer && other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            block_ = other.block_;
+            other.block_ = nullptr;
+        }
+        return *this;
+    }
+
+    /// @brief returns true, if the handle refers to memory
+    /// @return true, if the handle refers to memory
+    explicit operator bool() const
+    {
+        return (nullptr != block_);
+    }
+
+    /// @brief returns the data
+    /// @return pointer to the data or nullptr for empty handles
+    char * data()
+    {
+        return (nullptr != block_) ? block_->data() : nullptr;
+    }
+
+    /// @brief returns the data
+    /// @return pointer to the data or nullptr for empty handles
+    char const * data() const
+    {
+        return (nullptr != block_) ? block_->data() : nullptr;
+    }
+
+    /// @brief returns the number of used bytes
+    /// @return number of used bytes
+    std::size_t size() const
+    {
+        return (nullptr != block_) ? block_->size : 0;
+    }
+
+    /// @brief returns the number of available bytes
+    /// @return number of available bytes
+    std::size_t capacity() const
+    {
+        return (nullptr != block_) ? block_->capacity : 0;
+    }
+
+    /// @brief sets the number of used bytes
+    ///
+    /// @param size number of used bytes, limited to \ref capacity
+    void resize(std::size_t size)
+    {
+        if (nullptr != block_)
+        {
+            block_->size = (size < block_->capacity) ? size : block_->capacity;
+        }
+    }
+
+    /// @brief returns the number of handles sharing the memory
+    /// @return number of handles
+    uint32_t use_count() const
+    {
+        return (nullptr != block_) ? block_->refcount : 0;
+    }
+
+private:
+    friend class buffer_pool;
+
+    explicit buffer(buffer_block * block) noexcept
+    : block_(block)
+    {
+    }
+
+    void release();
+
+    buffer_block * block_;
+};
+
+/// @brief pool of buffers with power-of-two size classes
+///
+/// Released buffers are kept in per size class free lists and reused,
+/// so allocations do not call malloc in steady state. Memory is taken
+/// from the system in chunks, which are bound to a preferred NUMA node
+/// if set. Buffers larger than \ref max_size are not pooled.
+///
+/// Buffers may outlive their pool; the memory is freed when the pool
+/// and all of its buffers are gone.
+///
+/// @note the pool is not synchronized; it is intended to be owned
+///       by a single loop thread, e.g. via \ref manager::buffers
+class buffer_pool
+{
+    buffer_pool(buffer_pool const &) = delete;
+    buffer_pool& operator=(buffer_pool const &) = delete;
+public:
+    /// @brief capacity of the smallest size class
+    static constexpr std::size_t const min_size = 64;
+
+    /// @brief capacity of the largest size class
+    static constexpr std::size_t const max_size = 1024 * 1024;
+
+    /// @brief creates an empty pool
+    buffer_pool();
+
+    /// @brief releases all cached memory
+    ~buffer_pool();
+
+    /// @brief allocates a buffer
+    ///
+    /// @throws std::bad_alloc out of memory
+    ///
+    /// @param size initial size; the capacity is rounded up to the next size class
+    /// @return buffer
+    buffer allocate(std::size_t size);
+
+    /// @brief sets the NUMA node for memory taken from the system from now on
+    /// @param node NUMA node, negative values remove the preference
+    void set_numa_node(int node);
+
+    /// @brief returns the number of memory chunks taken from the system
+    /// @return number of chunks (excluding unpooled buffers)
+    std::size_t chunk_count() const;
+
+    /// @brief returns the number of free buffers kept for reuse
+    /// @return number of free buffers
+    std::size_t free_count() const;
+
+private:
+    friend class buffer;
+    static void recycle(buffer_block * block);
+
+    buffer_pool_state * state;
+};
+
+inline void buffer::release()
+{
+    if ((nullptr != block_) && (0 == --block_->refcount))
+    {
+        buffer_pool::recycle(block_);
+    }
+    block_ = nullptr;
+}
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_CONCURRENT_MANAGER_HPP
+#define SOCKMAN_CONCURRENT_MANAGER_HPP
+
+#include <sockman/sockman.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sockman
+{
+
+/// @brief socket event manager, which is serviced by multiple threads
+///
+/// In contrast to \ref manager, all methods may be called from any
+/// thread. Several threads may call \ref service or \ref run on the
+/// same epoll instance; each event is dispatched by exactly one of
+/// them. Sockets are registered with EPOLLONESHOT and re-armed after
+/// their callback returns, so the callback of a socket never runs
+/// concurrently with itself, while different sockets are dispatched
+/// in parallel. There is no affinity between sockets and threads.
+///
+/// Registrations are kept in a lock-free table indexed by descriptor.
+/// Removed registrations are reclaimed by epoch based reclamation once
+/// no thread can be inside their callback anymore, so a socket may be
+/// removed from any thread, even while its callback is running. Threads
+/// waiting for events do not hold back reclamation.
+///
+/// Buffering, timers and admission control of \ref manager are not
+/// provided.
+class concurrent_manager
+{
+    concurrent_manager(concurrent_manager const &) = delete;
+    concurrent_manager& operator=(concurrent_manager const &) = delete;
+public:
+    /// @brief maximum descriptor, which can be managed (exclusive)
+    static constexpr int const max_descriptor = 4 * 1024 * 1024;
+
+    /// @brief creates an epoll instance
+    ///
+    /// @throws std::exception failed to create epoll instance
+    concurrent_manager();
+
+    /// @brief releases all registrations
+    ///
+    /// No thread must be servicing the manager anymore.
+    /// Sockets are not closed.
+    ~concurrent_manager();
+
+    /// @brief adds a socket; replaces a previous registration
+    ///
+    /// Thread-safe.
+    ///
+    /// @throws std::exception invalid socket or epoll_ctl failed
+    ///
+    /// @param sock socket to add
+    /// @param events events to listen (0, or any comination of \ref readable an \ref writable)
+    /// @param callback callback to invoke on events
+    void add(int sock, uint32_t events, socket_callback callback);
+
+    /// @brief removes a socket
+    ///
+    /// Thread-safe. When this returns, the socket is not dispatched
+    /// anymore, but a callback running in another thread may still be
+    /// in progress. The socket can be closed afterwards.
+    ///
+    /// @param sock socket to remove
+    void remove(int sock);
+
+    /// @brief enables or disables callbacks for readable events
+    ///
+    /// Thread-safe.
+    ///
+    /// @throws std::exception socket not found
+    ///
+    /// @param sock socket to modify
+    /// @param enable true to enable, false to disable
+    void notify_on_readable(int sock, bool enable = true);
+
+    /// @brief enables or disables callbacks for writable events
+    ///
+    /// Thread-safe.
+    ///
+    /// @throws std::exception socket not found
+    ///
+    /// @param sock socket to modify
+    /// @param enable true to enable, false to disable
+    void notify_on_writable(int sock, bool enable = true);
+
+    /// @brief waits for one batch of events and dispatches it
+    ///
+    /// Thread-safe.
+    ///
+    /// @param timeout timeout in milliseconds (-1 waits infinitely)
+    void service(int timeout = -1);
+
+    /// @brief services the manager until \ref stop is called
+    ///
+    /// Thread-safe; typically called by each thread of a pool.
+    void run();
+
+    /// @brief stops all threads, which are in \ref run
+    ///
+    /// The request is kept until the last thread left \ref run.
+    ///
+    /// Thread-safe.
+    void stop();
+
+    /// @brief returns the underlying epoll file descriptor
+    /// @return epoll file descriptor
+    int native_handle() const;
+
+    /// @brief returns the number of removed registrations, which
+    ///        are not reclaimed yet
+    /// @return number of registrations waiting for reclamation
+    std::size_t pending_reclamation() const;
+
+private:
+    class detail;
+    detail * d;
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_EVENT_HANDLER_HPP
+#define SOCKMAN_EVENT_HANDLER_HPP
+
+#include <sys/epoll.h>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace sockman
+{
+
+/// @brief base of typed socket handlers (CRTP)
+///
+/// Derived classes hide the handlers they are interested in:
+///
+/// \code
+/// class connection: public sockman::event_handler<connection>
+/// {
+/// public:
+///     void on_readable(int fd);
+///     void on_close(int fd);
+/// };
+/// \endcode
+///
+/// When registered with \ref manager::add, the manager derives the
+/// interest mask from the handlers present and calls them directly,
+/// without std::function and without branching on events, which
+/// are not handled:
+///
+/// - on_readable: EPOLLIN is watched
+/// - on_writable: called when writable; enable via \ref manager::notify_on_writable
+/// - on_close: EPOLLRDHUP is watched; called on hangup, peer shutdown or error
+/// - on_error: called on errors instead of on_close
+///
+/// Handlers are called in the order above. After a handler removed
+/// the socket, no further handler is called.
+template<typename Derived>
+class event_handler
+{
+public:
+    void on_readable(int fd) { (void) fd; }
+    void on_writable(int fd) { (void) fd; }
+    void on_close(int fd) { (void) fd; }
+    void on_error(int fd) { (void) fd; }
+
+protected:
+    event_handler() = default;
+    ~event_handler() = default;
+};
+
+/// @brief compile-time information about the handlers of a handler type
+template<typename Handler>
+struct handler_traits
+{
+    using base = event_handler<Handler>;
+
+    static_assert(std::is_base_of<base, Handler>::value, "Handler must derive from event_handler<Handler>");
+
+    static constexpr bool const has_readable = !std::is_same<decltype(&Handler::on_readable), decltype(&base::on_readable)>::value;
+    static constexpr bool const has_writable = !std::is_same<decltype(&Handler::on_writable), decltype(&base::on_writable)>::value;
+    static constexpr bool const has_close = !std::is_same<decltype(&Handler::on_close), decltype(&base::on_close)>::value;
+    static constexpr bool const has_error = !std::is_same<decltype(&Handler::on_error), decltype(&base::on_error)>::value;
+
+    static constexpr uint32_t const events =
+        (has_readable ? static_cast<uint32_t>(EPOLLIN) : 0u) |
+        (has_close ? static_cast<uint32_t>(EPOLLRDHUP) : 0u);
+
+    /// Calls the handlers matching events; removed is set by the manager
+    /// when a handler removes the socket.
+    static void dispatch(void * target, int fd, uint32_t events, bool const & removed)
+    {
+        Handler & handler = *static_cast<Handler*>(target);
+
+        if (has_readable && (0 != (events & EPOLLIN)))
+        {
+            handler.on_readable(fd);
+            if (removed)
+            {
+                return;
+            }
+        }
+
+        if (has_writable && (0 != (events & EPOLLOUT)))
+        {
+            handler.on_writable(fd);
+            if (removed)
+            {
+                return;
+            }
+        }
+
+        if (has_error && (0 != (events & EPOLLERR)))
+        {
+            handler.on_error(fd);
+        }
+        else if (has_close && (0 != (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))))
+        {
+            handler.on_close(fd);
+        }
+    }
+};
+
+template<typename Handler>
+constexpr bool const handler_traits<Handler>::has_readable;
+template<typename Handler>
+constexpr bool const handler_traits<Handler>::has_writable;
+template<typename Handler>
+constexpr bool const handler_traits<Handler>::has_close;
+template<typename Handler>
+constexpr bool const handler_traits<Handler>::has_error;
+template<typename Handler>
+constexpr uint32_t const handler_traits<Handler>::events;
+
+/// @brief type-erased entry point of a typed handler
+using handler_dispatcher = void (*)(void * target, int fd, uint32_t events, bool const & removed);
+
+}
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_EVENT_SOURCE_HPP
+#define SOCKMAN_EVENT_SOURCE_HPP
+
+#include <sockman/sockman.hpp>
+
+#include <sys/types.h>
+#include <signal.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sockman
+{
+
+/// @brief base class of typed event sources
+///
+/// An event source owns a file descriptor, which is added to a
+/// \ref manager on construction and removed on destruction. Whenever the
+/// descriptor becomes readable, the source drains it and delivers the
+/// decoded payload to its callback.
+///
+/// @note an event source must not outlive the manager it is added to
+class event_source
+{
+    event_source(event_source const &) = delete;
+    event_source& operator=(event_source const &) = delete;
+public:
+    /// @brief removes the descriptor from the manager and closes it
+    virtual ~event_source();
+
+    /// @brief returns the underlying file descriptor
+    /// @return file descriptor
+    int native_handle() const;
+
+protected:
+    /// @brief adds the descriptor to the manager
+    ///
+    /// Takes the ownership of the descriptor, even if adding fails.
+    ///
+    /// @throws std::exception invalid descriptor or failed to add it
+    ///
+    /// @param manager manager to add the descriptor to
+    /// @param fd descriptor to own
+    event_source(manager & manager, int fd);
+
+    /// @brief invoked whenever the descriptor is readable
+    virtual void on_readable() = 0;
+
+    /// @brief removes the descriptor from the manager (the descriptor stays open)
+    void detach();
+
+    manager & manager_;
+    int fd;
+};
+
+/// @brief timer callback
+///
+/// @param expirations number of expirations since the last callback (>= 1)
+using timer_callback = ::std::function<void(uint64_t expirations)>;
+
+/// @brief timer based on timerfd (CLOCK_MONOTONIC)
+///
+/// Expirations are read with a single 8 byte read, so no ticks are lost
+/// when the loop is late; the callback receives the number of
+/// expirations instead.
+class timer_source: public event_source
+{
+public:
+    /// @brief creates a disarmed timer
+    ///
+    /// @throws std::exception failed to create timer
+    ///
+    /// @param manager manager to add the timer to
+    /// @param callback callback to invoke on expiration
+    timer_source(manager & manager, timer_callback callback);
+
+    /// @brief arms the timer
+    ///
+    /// @throws std::exception negative timeout or interval
+    ///
+    /// @param timeout relative time of the first expiration
+    /// @param interval interval of subsequent expirations, 0 means one-shot
+    void start(std::chrono::nanoseconds timeout, std::chrono::nanoseconds interval = std::chrono::nanoseconds::zero());
+
+    /// @brief arms the timer at an absolute deadline
+    ///
+    /// @throws std::exception negative interval
+    ///
+    /// @param deadline point in time of the first expiration
+    /// @param interval interval of subsequent expirations, 0 means one-shot
+    void start_at(std::chrono::steady_clock::time_point deadline, std::chrono::nanoseconds interval = std::chrono::nanoseconds::zero());
+
+    /// @brief disarms the timer
+    void stop();
+
+protected:
+    void on_readable() override;
+
+private:
+    timer_callback callback_;
+};
+
+/// @brief eventfd callback
+///
+/// @param value sum of all values notified since the last callback
+using eventfd_callback = ::std::function<void(uint64_t value)>;
+
+/// @brief notification source based on eventfd
+///
+/// \ref notify can be called from any thread.
+class eventfd_source: public event_source
+{
+public:
+    /// @brief creates an eventfd
+    ///
+    /// @throws std::exception failed to create eventfd
+    ///
+    /// @param manager manager to add the eventfd to
+    /// @param callback callback to invoke on notification
+    eventfd_source(manager & manager, eventfd_callback callback);
+
+    /// @brief adds a value to the eventfd counter
+    /// @param value value to add
+    void notify(uint64_t value = 1);
+
+protected:
+    void on_readable() override;
+
+private:
+    eventfd_callback callback_;
+};
+
+/// @brief signal source based on \ref manager::on_signal
+///
+/// Registers the callback for each signal at the signalfd of the
+/// manager, so signal sources and \ref manager::on_signal share a single
+/// signalfd. All pending signals are drained in bulk; the callback is
+/// invoked once per received signal. The signals are blocked for the
+/// calling thread on construction. On destruction the handlers are
+/// removed, but the signals stay blocked.
+class signal_source
+{
+    signal_source(signal_source const &) = delete;
+    signal_source& operator=(signal_source const &) = delete;
+public:
+    /// @brief handles the given signals
+    ///
+    /// Replaces handlers registered before for the same signals.
+    ///
+    /// @throws std::exception invalid signal or failed to create signalfd
+    ///
+    /// @param manager manager to handle the signals
+    /// @param signals signals to handle
+    /// @param callback callback to invoke for each received signal
+    signal_source(manager & manager, std::vector<int> const & signals, signal_callback callback);
+
+    /// @brief removes the handlers of all signals
+    ~signal_source();
+
+private:
+    manager & manager_;
+    std::vector<int> signals_;
+};
+
+/// @brief decoded inotify event
+struct inotify_record
+{
+    /// @brief watch descriptor
+    int wd;
+
+    /// @brief event mask (IN_*)
+    uint32_t mask;
+
+    /// @brief cookie to correlate rename events
+    uint32_t cookie;
+
+    /// @brief name of the affected file, empty for the watched object itself
+    std::string name;
+};
+
+/// @brief inotify callback
+///
+/// @param records all events received by a single read
+using inotify_callback = ::std::function<void(std::vector<inotify_record> const & records)>;
+
+/// @brief file system event source based on inotify
+class inotify_source: public event_source
+{
+public:
+    /// @brief creates an inotify instance
+    ///
+    /// @throws std::exception failed to create inotify instance
+    ///
+    /// @param manager manager to add the inotify instance to
+    /// @param callback callback to invoke with each batch of events
+    inotify_source(manager & manager, inotify_callback callback);
+
+    /// @brief watches a path
+    ///
+    /// @throws std::exception failed to add watch
+    ///
+    /// @param path path to watch
+    /// @param mask events to watch (IN_*)
+    /// @return watch descriptor
+    int add_watch(std::string const & path, uint32_t mask);
+
+    /// @brief removes a watch
+    /// @param wd watch descriptor
+    void remove_watch(int wd);
+
+protected:
+    void on_readable() override;
+
+private:
+    inotify_callback callback_;
+    std::vector<inotify_record> records;
+};
+
+/// @brief process exit callback
+///
+/// For child processes, info contains the exit status (see waitid(2)),
+/// which is reaped. For other processes only si_pid is set.
+///
+/// @param info information about the terminated process
+using process_callback = ::std::function<void(siginfo_t const & info)>;
+
+/// @brief process exit source based on pidfd
+///
+/// The callback is invoked once, afterwards the source is removed from
+/// the manager.
+class process_source: public event_source
+{
+public:
+    /// @brief opens a pidfd for a process
+    ///
+    /// @throws std::system_error failed to open pidfd; ENOSYS if the
+    ///         kernel or its headers do not support pidfds
+    ///
+    /// @param manager manager to add the pidfd to
+    /// @param pid process to watch
+    /// @param callback callback to invoke when the process terminated
+    process_source(manager & manager, pid_t pid, process_callback callback);
+
+protected:
+    void on_readable() override;
+
+private:
+    pid_t pid_;
+    process_callback callback_;
+};
+
+}
+
+#endif
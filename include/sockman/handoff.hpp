@@ -0,0 +1,53 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_HANDOFF_HPP
+#define SOCKMAN_HANDOFF_HPP
+
+#include <sockman/sockman.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace sockman
+{
+
+/// @brief maximum number of sockets transferred by a single message
+constexpr std::size_t const handoff_batch_size = 250;
+
+/// @brief maximum size of the state (mostly pending output) of a single message
+constexpr std::size_t const handoff_max_payload_size = 64 * 1024 * 1024;
+
+/// @brief transfers detached sockets over a UNIX domain socket
+///
+/// Sockets are passed via SCM_RIGHTS in batches of at most
+/// \ref handoff_batch_size together with their serialized state,
+/// followed by an end marker. The sockets are still open in the
+/// sending process afterwards and should be closed there.
+///
+/// The channel is used in blocking mode; it should not be managed
+/// by a manager during the transfer.
+///
+/// @throws std::exception failed to send or the pending output of a batch
+///         exceeds \ref handoff_max_payload_size
+///
+/// @param channel connected UNIX domain stream socket
+/// @param sockets states returned by \ref manager::detach
+void send_sockets(int channel, std::vector<socket_state> const & sockets);
+
+/// @brief receives sockets sent by \ref send_sockets
+///
+/// Attach the received sockets via \ref manager::attach.
+///
+/// @throws std::exception failed to receive or invalid data
+///
+/// @param channel connected UNIX domain stream socket
+/// @return states of the received sockets
+std::vector<socket_state> receive_sockets(int channel);
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_LINE_CODEC_HPP
+#define SOCKMAN_LINE_CODEC_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace sockman
+{
+
+/// @brief returns the position of the first newline ('\n')
+///
+/// Uses AVX2 or SSE2 if supported by the CPU (detected at runtime)
+/// and falls back to a portable implementation otherwise.
+///
+/// @param data data to scan
+/// @param length length of data
+/// @return position of the first newline or length, if there is no newline
+std::size_t find_newline(char const * data, std::size_t length);
+
+/// @brief view of a single line
+///
+/// The view is only valid during the callback it is passed to.
+struct line_view
+{
+    /// @brief first character of the line
+    char const * data;
+
+    /// @brief length of the line, excluding the delimiter
+    std::size_t size;
+
+    /// @brief returns a copy of the line
+    /// @return line as string
+    std::string str() const
+    {
+        return std::string(data, size);
+    }
+};
+
+/// @brief splits a byte stream into lines terminated by "\n" or "\r\n"
+///
+/// All complete lines of received data are emitted in one pass. Lines
+/// located entirely within the received data are passed as views into that
+/// data without copying; only a trailing incomplete line is buffered.
+class line_codec
+{
+public:
+    /// @brief creates a codec
+    /// @param max_line_length maximum length of a line (excluding delimiter)
+    explicit line_codec(std::size_t max_line_length = 64 * 1024)
+    : max_line_length_(max_line_length)
+    {
+    }
+
+    /// @brief feeds received data and emits complete lines
+    ///
+    /// @param data received data
+    /// @param length length of data
+    /// @param callback invoked as callback(line_view) for each complete line
+    /// @return false, if a line exceeds the maximum length; the remaining
+    ///         data is discarded and the codec is reset
+    template <typename Callback>
+    bool feed(char const * data, std::size_t length, Callback && callback)
+    {
+        std::size_t position = 0;
+
+        if (!partial.empty())
+        {
+            std::size_t const end = find_newline(data, length);
+            if (end == length)
+            {
+                return buffer(data, length);
+            }
+
+            partial.append(data, end);
+            bool const ok = emit(partial.data(), partial.size(), callback);
+            partial.clear();
+            if (!ok)
+            {
+                return false;
+            }
+            position = end + 1;
+        }
+
+        while (position < length)
+        {
+            std::size_t const end = position + find_newline(&data[position], length - position);
+            if (end == length)
+            {
+                break;
+            }
+
+            if (!emit(&data[position], end - position, callback))
+            {
+                return false;
+            }
+            position = end + 1;
+        }
+
+        return buffer(&data[position], length - position);
+    }
+
+    /// @brief returns the number of bytes of the incomplete line
+    /// @return number of buffered bytes
+    std::size_t buffered() const
+    {
+        return partial.size();
+    }
+
+    /// @brief discards the incomplete line
+    void reset()
+    {
+        partial.clear();
+    }
+
+private:
+    template <typename Callback>
+    bool emit(char const * line, std::size_t size, Callback && callback)
+    {
+        if ((0 < size) && ('\r' == line[size - 1]))
+        {
+            size--;
+        }
+
+        if (size > max_line_length_)
+        {
+            return false;
+        }
+
+        callback(line_view{line, size});
+        return true;
+    }
+
+    bool buffer(char const * data, std::size_t length)
+    {
+        std::size_t const size = partial.size() + length;
+
+        // the length limit does not include a trailing '\r'
+        bool const pending_cr = (0 < length) && ('\r' == data[length - 1]);
+        if ((size > max_line_length_) && (!((size == (max_line_length_ + 1)) && pending_cr)))
+        {
+            partial.clear();
+            return false;
+        }
+
+        partial.append(data, length);
+        return true;
+    }
+
+    std::size_t max_line_length_;
+    std::string partial;
+};
+
+}
+
+#endif
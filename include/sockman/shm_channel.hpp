@@ -0,0 +1,115 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_SHM_CHANNEL_HPP
+#define SOCKMAN_SHM_CHANNEL_HPP
+
+#include <sockman/sockman.hpp>
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace sockman
+{
+
+/// @brief descriptors of a shared memory channel
+///
+/// Created by \ref create_shm_channel. To connect another process,
+/// pass the descriptors via SCM_RIGHTS. The descriptors are owned by
+/// the caller; channels duplicate the descriptors they need.
+struct shm_descriptors
+{
+    /// @brief memfd holding both rings
+    int memory;
+
+    /// @brief eventfd of each side, readable when the side has work
+    int notify[2];
+};
+
+/// @brief side of a shared memory channel
+enum class shm_side
+{
+    first,
+    second
+};
+
+/// @brief creates the shared memory of a channel
+///
+/// @throws std::exception failed to create memory or eventfds
+///
+/// @param capacity size of each ring in bytes, rounded up to a power of two
+/// @return descriptors of the channel
+shm_descriptors create_shm_channel(std::size_t capacity);
+
+/// @brief closes the descriptors of a channel
+///
+/// @param descriptors descriptors to close
+void close_shm_descriptors(shm_descriptors const & descriptors);
+
+/// @brief byte stream between two peers on the same host
+///
+/// Each direction is a single-producer / single-consumer ring in
+/// shared memory, so messages are copied once into the ring and once
+/// out of it, without system calls. The eventfd of a side is added to
+/// the manager; the peer signals it only when a ring changes from empty
+/// to non-empty while this side waits for data, or when space becomes
+/// available while this side waits to write. Waiting is announced by a
+/// flag in shared memory, so busy peers do not notify each other.
+///
+/// \ref read and \ref write behave like read(2) and write(2) on a
+/// non-blocking stream socket, and the callback receives the same
+/// events: readable while data is available (level-triggered),
+/// writable when a write, that failed with EAGAIN, can be retried,
+/// and hungup once the peer has closed its side.
+class shm_channel
+{
+    shm_channel(shm_channel const &) = delete;
+    shm_channel& operator=(shm_channel const &) = delete;
+public:
+    /// @brief maps the channel and adds it to the manager
+    ///
+    /// @throws std::exception invalid descriptors or failed to add
+    ///
+    /// @param manager manager to add the channel to
+    /// @param descriptors descriptors created by \ref create_shm_channel
+    /// @param side side of the channel
+    /// @param callback callback to invoke on events
+    shm_channel(manager & manager, shm_descriptors const & descriptors, shm_side side, socket_callback callback);
+
+    /// @brief closes the channel and removes it from the manager
+    ///
+    /// The peer reads the remaining data, followed by end of file.
+    ~shm_channel();
+
+    /// @brief returns the descriptor added to the manager
+    /// @return eventfd of this side
+    int native_handle() const;
+
+    /// @brief reads from the channel
+    ///
+    /// @param buffer buffer to store data
+    /// @param length size of buffer in bytes
+    /// @return number of bytes read, 0 if the peer closed the
+    ///         channel, -1 on error (see errno)
+    ssize_t read(void * buffer, std::size_t length);
+
+    /// @brief writes to the channel
+    ///
+    /// @param data data to write
+    /// @param length length of data in bytes
+    /// @return number of bytes written, -1 on error (see errno)
+    ssize_t write(void const * data, std::size_t length);
+
+private:
+    class detail;
+    std::shared_ptr<detail> d;
+};
+
+}
+
+#endif
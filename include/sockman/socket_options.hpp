@@ -0,0 +1,74 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_SOCKET_OPTIONS_HPP
+#define SOCKMAN_SOCKET_OPTIONS_HPP
+
+namespace sockman
+{
+
+/// @brief value of a socket option, which is left unchanged
+constexpr int const option_unset = -1;
+
+/// @brief profile of kernel socket options
+///
+/// Each option is left unchanged while it is \ref option_unset.
+/// Boolean options are enabled by 1 and disabled by 0.
+///
+/// @see listener_options, apply_socket_options
+struct socket_options
+{
+    /// @brief TCP_NODELAY: disables Nagle's algorithm
+    int no_delay = option_unset;
+
+    /// @brief SO_RCVBUF: receive buffer size in bytes
+    int receive_buffer = option_unset;
+
+    /// @brief SO_SNDBUF: send buffer size in bytes
+    int send_buffer = option_unset;
+
+    /// @brief TCP_QUICKACK: sends ACKs immediately
+    ///
+    /// Not inherited from a listener; applied to each accepted socket.
+    int quick_ack = option_unset;
+
+    /// @brief SO_RCVLOWAT: minimum number of bytes to report readable
+    int receive_lowat = option_unset;
+
+    /// @brief TCP_NOTSENT_LOWAT: maximum number of unsent bytes to report writable
+    ///
+    /// Limits the data queued in the kernel, so writable notifications
+    /// (see \ref manager::notify_on_writable) only fire when the
+    /// socket is close to running out of data.
+    int notsent_lowat = option_unset;
+
+    /// @brief SO_KEEPALIVE: enables keepalive probes
+    int keepalive = option_unset;
+
+    /// @brief TCP_KEEPIDLE: idle time in seconds before the first probe
+    int keepalive_idle = option_unset;
+
+    /// @brief TCP_KEEPINTVL: time in seconds between probes
+    int keepalive_interval = option_unset;
+
+    /// @brief TCP_KEEPCNT: number of unanswered probes before the connection is dropped
+    int keepalive_count = option_unset;
+
+    /// @brief SO_BUSY_POLL: time in microseconds to busy poll on receive
+    int busy_poll = option_unset;
+};
+
+/// @brief sets all options of a profile on a socket
+///
+/// @throws std::exception failed to set an option
+///
+/// @param sock socket to modify
+/// @param options options to set
+void apply_socket_options(int sock, socket_options const & options);
+
+}
+
+#endif
@@ -7,8 +7,22 @@
 #ifndef SOCKMAN_HPP
 #define SOCKMAN_HPP
 
+#include <sockman/trace.hpp>
+#include <sockman/buffer.hpp>
+#include <sockman/backend.hpp>
+#include <sockman/event_handler.hpp>
+#include <sockman/worker_pool.hpp>
+#include <sockman/socket_options.hpp>
+
 #include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
 #include <functional>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <memory>
+#include <type_traits>
 
 namespace sockman
 {
@@ -29,6 +43,16 @@ constexpr uint32_t const readable = EPOLLIN;
 /// @see manager::add
 constexpr uint32_t const writable = EPOLLOUT;
 
+/// @brief edge-triggered registration
+///
+/// This flag can be combined with \ref readable at @ref manager::add.
+/// The kernel reports new readiness only; the manager keeps the socket
+/// in a user-space ready list and dispatches it again without asking
+/// the kernel, until \ref manager::read hits EAGAIN.
+///
+/// @see manager::add, manager::read
+constexpr uint32_t const edge_triggered = EPOLLET;
+
 /// @brief Wrapper to encapsulate socket events.
 class socket_events
 {
@@ -90,15 +114,196 @@ private:
 /// @param events collection of raised events
 using socket_callback = ::std::function<void(int fd, socket_events events)>;
 
+/// @brief signal callback
+///
+/// Defines the callback the \ref manager will call
+/// whenever a registered signal is received.
+///
+/// @param info information about the received signal
+///
+/// @see manager::on_signal
+using signal_callback = ::std::function<void(signalfd_siginfo const & info)>;
+
+/// @brief idle callback
+///
+/// Defines the callback the \ref manager will call
+/// after each batch of events dispatched by a run loop.
+///
+/// @see manager::on_idle
+using idle_callback = ::std::function<void()>;
+
+/// @brief inactivity callback
+///
+/// Defines the callback the \ref manager will call for
+/// sockets that did not receive any event for too long.
+///
+/// @param sock inactive socket
+///
+/// @see manager::set_inactivity_timeout
+using inactivity_callback = ::std::function<void(int sock)>;
+
+/// @brief connect callback
+///
+/// Defines the callback the \ref manager will call
+/// when an asynchronous connect completes.
+///
+/// @param fd socket which was connected
+/// @param error 0 on success, otherwise the error code of the connect
+///
+/// @see manager::connect
+using connect_callback = ::std::function<void(int fd, int error)>;
+
+/// @brief callback invoked for each accepted connection
+///
+/// The callback owns the accepted socket; usually it adds the
+/// socket to the manager.
+///
+/// @param client accepted socket
+using accept_callback = ::std::function<void(int client)>;
+
+/// @brief admission control of a managed listener
+///
+/// see \ref manager::add_listener
+struct listener_options
+{
+    /// @brief maximum number of sockets registered at the manager,
+    ///        including the listener itself (0 for no limit)
+    std::size_t max_sockets = 0;
+
+    /// @brief sustained number of accepts per second (0 for no limit)
+    double accept_rate = 0.0;
+
+    /// @brief number of accepts allowed in a burst above accept_rate
+    std::size_t accept_burst = 64;
+
+    /// @brief flags passed to accept4 for accepted sockets
+    int accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+
+    /// @brief options of accepted sockets
+    ///
+    /// Options inherited by accepted sockets are set once on the
+    /// listener; the others are set on each accepted socket.
+    socket_options socket;
+};
+
+/// @brief registration of a single socket
+///
+/// @see manager::add_many
+struct registration
+{
+    /// @brief socket to add
+    int sock;
+
+    /// @brief events to listen (0, or any comination of \ref readable an \ref writable)
+    uint32_t events;
+
+    /// @brief callback to invoke on event
+    socket_callback callback;
+};
+
+/// @brief state of a socket detached from a manager
+///
+/// @see manager::detach, manager::attach, handoff.hpp
+struct socket_state
+{
+    /// @brief detached socket
+    int sock;
+
+    /// @brief registered events (\ref readable and / or \ref writable)
+    uint32_t events;
+
+    /// @brief true, if inactivity of the socket was tracked
+    bool track_inactivity;
+
+    /// @brief output queued by \ref manager::send, but not written yet
+    std::string pending_output;
+};
+
+/// @brief token bucket
+struct rate_limit
+{
+    /// @brief sustained number of tokens per second (0 for no limit)
+    double rate = 0.0;
+
+    /// @brief maximum number of tokens, i.e. the allowed burst
+    ///        (0 for one second worth of tokens)
+    std::size_t burst = 0;
+};
+
+/// @brief limits of a rate limited socket or group of sockets
+///
+/// @see manager::set_rate_limit, manager::add_rate_group
+struct shaping_options
+{
+    /// @brief bytes read via \ref manager::read
+    rate_limit receive_bytes;
+
+    /// @brief readable events dispatched
+    rate_limit receive_events;
+
+    /// @brief bytes written from the output queued by \ref manager::send
+    rate_limit send_bytes;
+};
+
+/// @brief identifies a group of rate limited sockets
+using rate_group = std::size_t;
+
+/// @brief identifies a timer scheduled by \ref manager::schedule
+using timer_id = uint64_t;
+
+/// @brief counters of a managed socket
+///
+/// Counters cover I/O done by the manager, i.e. \ref manager::read
+/// and output queued by \ref manager::send.
+///
+/// @see manager::statistics
+struct socket_statistics
+{
+    /// @brief socket
+    int sock = -1;
+
+    /// @brief bytes read via \ref manager::read
+    uint64_t bytes_received = 0;
+
+    /// @brief bytes written from the output queue
+    uint64_t bytes_sent = 0;
+
+    /// @brief read calls issued by \ref manager::read
+    uint64_t reads = 0;
+
+    /// @brief write calls issued for the output queue
+    uint64_t writes = 0;
+
+    /// @brief reads and writes, which failed with EAGAIN
+    uint64_t would_block = 0;
+
+    /// @brief maximum number of bytes queued for output
+    std::size_t peak_output = 0;
+
+    /// @brief time queued output waited for the socket to become writable
+    std::chrono::nanoseconds write_blocked = std::chrono::nanoseconds::zero();
+};
+
 /// @brief socket event manager
 class manager
 {
     manager(manager const &) = delete;
     manager& operator=(manager const &) = delete;
 public:
-    /// @brief initializes a socket event manager
+    /// @brief initializes a socket event manager based on epoll
     manager();
 
+    /// @brief initializes a socket event manager with a custom backend
+    ///
+    /// Timers, inactivity tracking and run loop deadlines use the
+    /// time of the backend, so a \ref simulated_backend can drive
+    /// the manager in virtual time.
+    ///
+    /// @throws std::exception invalid backend
+    ///
+    /// @param events_backend backend to wait for events
+    explicit manager(std::unique_ptr<backend> events_backend);
+
     /// @brief cleans up the instance
     ~manager();
 
@@ -118,10 +323,204 @@ public:
     /// @param callback callback to invoke on event
     void add(int sock, uint32_t events, socket_callback callback);
 
+    /// @brief adds a socket with a typed handler
+    ///
+    /// The interest mask is derived from the handlers present in
+    /// Handler and events are passed to them directly, see
+    /// \ref event_handler. The handler must outlive its registration.
+    ///
+    /// @param sock socket to add
+    /// @param handler handler derived from event_handler<Handler>
+    template<typename Handler, typename = typename std::enable_if<std::is_base_of<event_handler<Handler>, Handler>::value>::type>
+    void add(int sock, Handler & handler)
+    {
+        add(sock, handler_traits<Handler>::events, &handler_traits<Handler>::dispatch, reinterpret_cast<void*>(&handler));
+    }
+
+    /// @brief adds multiple sockets to the manager
+    ///
+    /// Same as calling \ref add for each registration, but storage is
+    /// reserved once. The call is all or nothing: if a socket cannot be
+    /// added, new sockets of the batch are removed and replaced
+    /// registrations are restored.
+    ///
+    /// @throws std::exception failed to add a socket or a socket is
+    ///         contained more than once
+    ///
+    /// @param registrations sockets to add
+    void add_many(std::vector<registration> registrations);
+
+    /// @brief adds a child manager as single readable source
+    ///
+    /// Whenever the child has pending events, the parent services
+    /// the child without blocking, dispatching at most budget events per
+    /// wakeup. Remaining events are dispatched on subsequent wakeups.
+    ///
+    /// To skip the child, e.g. for load shedding, its notifications can be
+    /// disabled via notify_on_readable(child.native_handle(), false).
+    /// The child is removed via remove(child.native_handle()) and must
+    /// outlive its registration.
+    ///
+    /// @throws std::exception failed to add the child or budget is 0
+    ///
+    /// @param child manager to add
+    /// @param budget maximum number of events dispatched per wakeup (at least 1)
+    void add(manager & child, std::size_t budget = 64);
+
+    /// @brief connects a socket asynchronously
+    ///
+    /// Starts a non-blocking connect and waits for the socket to become
+    /// writable. The result is determined via SO_ERROR and passed to the
+    /// callback, which is always invoked from a later \ref service call,
+    /// even if connect fails immediately.
+    ///
+    /// The socket is managed until the connect completes; it is removed
+    /// before the callback is invoked and its original file status flags
+    /// are restored.
+    ///
+    /// @throws std::exception failed to add the socket
+    ///
+    /// @param sock socket to connect
+    /// @param address address to connect to
+    /// @param length length of address
+    /// @param callback callback to invoke when the connect completes
+    void connect(int sock, sockaddr const * address, socklen_t length, connect_callback callback);
+
+    /// @brief adds a listening socket, which is accepted by the manager
+    ///
+    /// Pending connections are accepted when the listener becomes
+    /// readable and passed to callback. While the number of registered
+    /// sockets reaches options.max_sockets or the accept rate is
+    /// exhausted, readable interest of the listener is disabled, so
+    /// pending connections wait in the backlog instead of consuming
+    /// resources. It is re-enabled when sockets are removed or tokens
+    /// are refilled. Running out of file descriptors pauses the
+    /// listener for a short while as well.
+    ///
+    /// The listener is switched to non-blocking mode. Remove it
+    /// with \ref remove.
+    ///
+    /// @throws std::exception invalid socket, already managed or
+    ///         failed to set options.socket
+    ///
+    /// @param sock listening socket
+    /// @param options admission control
+    /// @param callback callback invoked for each accepted socket
+    void add_listener(int sock, listener_options const & options, accept_callback callback);
+
     /// @brief removes a socket from the manager
     /// @param sock socket to remove
     void remove(int sock);
 
+    /// @brief removes a socket from the manager and returns its state
+    ///
+    /// In contrast to \ref remove, pending output is not written but
+    /// returned, so the socket can be attached to another manager,
+    /// possibly in another process (see handoff.hpp). Offloaded work
+    /// of the socket is dropped. The socket is not closed.
+    ///
+    /// @throws std::exception it is not allowed to detach an
+    ///         unmanaged socket
+    ///
+    /// @param sock socket to detach
+    /// @return state of the socket
+    socket_state detach(int sock);
+
+    /// @brief adds a detached socket
+    ///
+    /// Registers the socket with its former events and queues its
+    /// pending output. Since readiness is level-triggered, events which
+    /// occurred while the socket was detached are reported afterwards.
+    ///
+    /// @param state state of a detached socket
+    /// @param callback callback to invoke on event
+    void attach(socket_state const & state, socket_callback callback);
+
+    /// @brief removes multiple sockets from the manager
+    /// @param socks sockets to remove
+    void remove_many(std::vector<int> const & socks);
+
+    /// @brief reads from a managed socket
+    ///
+    /// Behaves like read(2). For \ref edge_triggered sockets, the
+    /// manager learns whether the socket is drained: a socket is
+    /// dispatched again from the ready list until a read fails with
+    /// EAGAIN, fails otherwise or reaches end of file. While the ready
+    /// list is not empty, waits for new events do not block.
+    ///
+    /// @param sock socket to read from
+    /// @param buffer buffer to store data
+    /// @param length size of buffer in bytes
+    /// @return number of bytes read, 0 at end of file, -1 on error (see errno)
+    ssize_t read(int sock, void * buffer, std::size_t length);
+
+    /// @brief queues data to be written to a managed socket
+    ///
+    /// Writes issued while the manager is corked, i.e. during dispatch
+    /// of a batch or within a \ref cork_scope, are gathered per socket and
+    /// written with a single vectored write when the batch or scope ends.
+    /// Otherwise the data is written immediately. Data that cannot be
+    /// written without blocking is kept and written when the socket
+    /// becomes writable; these writable events are not reported unless
+    /// requested via \ref notify_on_writable.
+    ///
+    /// Write errors discard the pending data; they are reported to the
+    /// callback as error or hungup events. Pending data is flushed on a
+    /// best-effort basis when the socket is removed.
+    ///
+    /// @throws std::exception it is not allowed to send to an
+    ///         unmanaged socket
+    ///
+    /// @param sock socket to write to
+    /// @param data data to write
+    /// @param length length of data in bytes
+    void send(int sock, void const * data, std::size_t length);
+
+    /// @brief queues a pooled buffer for writing without copying it
+    ///
+    /// The buffer is shared with the write queue until it is written,
+    /// so it must not be modified afterwards. Apart from that, it
+    /// behaves like \ref send(int, void const *, std::size_t).
+    ///
+    /// @throws std::exception it is not allowed to send to an
+    ///         unmanaged socket
+    ///
+    /// @param sock socket to write to
+    /// @param data buffer to write
+    void send(int sock, buffer const & data);
+
+    /// @brief returns the buffer pool of this manager
+    ///
+    /// Pending output of \ref send is stored in buffers of this pool.
+    /// The pool is not synchronized and must only be used by the
+    /// thread running the manager.
+    ///
+    /// @return buffer pool
+    buffer_pool & buffers();
+
+    /// @brief writes pending data of a socket immediately, even if corked
+    ///
+    /// @throws std::exception it is not allowed to flush an
+    ///         unmanaged socket
+    ///
+    /// @param sock socket to flush
+    void flush(int sock);
+
+    /// @brief returns the number of bytes queued but not written yet
+    ///
+    /// @param sock socket to query
+    /// @return number of pending bytes (0 for unmanaged sockets)
+    std::size_t pending_output(int sock) const;
+
+    /// @brief defers writes issued by \ref send until \ref uncork
+    ///
+    /// Calls can be nested; data is written when the outermost
+    /// level is uncorked.
+    void cork();
+
+    /// @brief ends a \ref cork and writes all gathered data
+    void uncork();
+
     /// @brief enables or disables notification of readable events
     ///
     /// @throws std::excepttion it is not allowed to configure an 
@@ -146,11 +545,322 @@ public:
     ///
     /// @param timeout timeout in milliseconds, 0 means poll, -1 means to block until next event
     void service(int timeout = -1);
+
+    /// @brief waits for socket events and dispatches up to a limited number of events
+    ///
+    /// @param timeout timeout in milliseconds, 0 means poll, -1 means to block until next event
+    /// @param max_events maximum number of events to dispatch
+    void service(int timeout, std::size_t max_events);
+
+    /// @brief waits for the next socket event or timeout with sub-millisecond resolution
+    ///
+    /// Uses epoll_pwait2 when available and falls back to a timerfd
+    /// on older kernels, so the timeout is not rounded to milliseconds.
+    ///
+    /// @note the timeout is measured against CLOCK_MONOTONIC
+    ///
+    /// @param timeout relative timeout, negative values are treated as 0 (poll)
+    void service(std::chrono::nanoseconds timeout);
+
+    /// @brief waits for the next socket event or until an absolute deadline is reached
+    ///
+    /// In contrast to \ref service, the caller does not need to recompute
+    /// a relative timeout on each iteration. A deadline in the past polls,
+    /// std::chrono::steady_clock::time_point::max() blocks until the next event.
+    ///
+    /// @param deadline point in time (CLOCK_MONOTONIC) to stop waiting
+    void service_until(std::chrono::steady_clock::time_point deadline);
+
+    /// @brief services events until \ref stop is called
+    ///
+    /// The loop blocks until the next event; there is no need for a
+    /// polling timeout to detect a stop request.
+    void run();
+
+    /// @brief services events until \ref stop is called or the duration elapsed
+    ///
+    /// @param duration maximum duration to run
+    void run_for(std::chrono::nanoseconds duration);
+
+    /// @brief services events until \ref stop is called or the deadline is reached
+    ///
+    /// @param deadline point in time (CLOCK_MONOTONIC) to stop running
+    void run_until(std::chrono::steady_clock::time_point deadline);
+
+    /// @brief requests the current run loop to stop
+    ///
+    /// Wakes up a blocked run loop immediately. A stop requested while
+    /// no loop is running makes the next run loop return immediately.
+    ///
+    /// @note this is the only method that is safe to call from
+    ///       signal handlers; like \ref post, it is safe to call
+    ///       from other threads
+    void stop();
+
+    /// @brief runs a function on the loop thread
+    ///
+    /// The function is run at the next dispatch; a blocked loop is
+    /// woken up. Functions posted to a destroyed manager are dropped.
+    ///
+    /// @note thread-safe
+    ///
+    /// @param function function to run
+    void post(std::function<void()> function);
+
+    /// @brief returns the current time of the manager
+    ///
+    /// This is the time of the backend, which is virtual for
+    /// a \ref simulated_backend.
+    ///
+    /// @return current time
+    std::chrono::steady_clock::time_point now() const;
+
+    /// @brief runs a function on the loop thread at a deadline
+    ///
+    /// @param deadline time (see \ref now) to run the function
+    /// @param function function to run
+    /// @return id to cancel the timer
+    timer_id schedule(std::chrono::steady_clock::time_point deadline, std::function<void()> function);
+
+    /// @brief cancels a scheduled timer
+    ///
+    /// Unknown or expired timers are ignored.
+    ///
+    /// @param id timer to cancel
+    void cancel(timer_id id);
+
+    /// @brief runs work for a socket on a worker pool
+    ///
+    /// work is run on a worker; its result is passed to completion
+    /// on the loop thread. Completions of a socket are invoked in the
+    /// order the work was offloaded, regardless of the order the work
+    /// finishes. While a socket has work outstanding, it is disarmed
+    /// (one-shot), so no events are reported until the last completion
+    /// was invoked; pending output is still written.
+    ///
+    /// Completions of removed sockets are dropped. Exceptions thrown by
+    /// work are rethrown on the loop thread instead of the completion.
+    ///
+    /// @throws std::exception it is not allowed to offload work of an
+    ///         unmanaged socket
+    ///
+    /// @param pool worker pool to run work
+    /// @param sock socket the work belongs to
+    /// @param work function returning a (non-void) result
+    /// @param completion function accepting the result
+    template<typename Work, typename Completion>
+    void offload(worker_pool & pool, int sock, Work work, Completion completion)
+    {
+        submit_offload(pool, sock, [work, completion]() mutable -> std::function<void()> {
+            auto result = work();
+            return [completion, result]() mutable {
+                completion(std::move(result));
+            };
+        });
+    }
+
+    /// @brief returns the number of offloaded work items, whose completions are pending
+    ///
+    /// @param sock socket to query
+    /// @return number of pending completions (0 for unmanaged sockets)
+    std::size_t pending_offloads(int sock) const;
+
+    /// @brief handles a signal via signalfd
+    ///
+    /// The signal is blocked for the calling thread, so it should be
+    /// registered before other threads are created.
+    ///
+    /// @throws std::exception failed to create signalfd
+    ///
+    /// @param signal_number signal to handle
+    /// @param callback callback to invoke when the signal is received
+    void on_signal(int signal_number, signal_callback callback);
+
+    /// @brief removes the handler of a signal
+    ///
+    /// The signal is no longer read from the signalfd, but stays
+    /// blocked. Unknown signals are ignored.
+    ///
+    /// @param signal_number signal to remove
+    void remove_signal(int signal_number);
+
+    /// @brief adds a hook, that is invoked after each batch of a run loop
+    ///
+    /// @param callback callback to invoke
+    void on_idle(idle_callback callback);
+
+    /// @brief reports sockets without events for a given time
+    ///
+    /// Only sockets enabled by \ref track_inactivity are watched.
+    /// The callback is expected to remove (and usually close) the
+    /// socket; otherwise the socket is considered active again.
+    ///
+    /// Inactivity is checked periodically with a granularity of a
+    /// quarter of the timeout, so sockets may be reported somewhat late.
+    /// Tracking costs a timestamp and a list relink per dispatched event.
+    ///
+    /// @param timeout inactivity timeout, zero disables the check
+    /// @param callback callback to invoke for inactive sockets
+    void set_inactivity_timeout(std::chrono::nanoseconds timeout, inactivity_callback callback);
+
+    /// @brief enables or disables inactivity tracking of a socket
+    ///
+    /// @throws std::exception it is not allowed to track an
+    ///         unmanaged socket
+    ///
+    /// @param sock socket to track
+    /// @param enable true to track the socket, false otherwise
+    void track_inactivity(int sock, bool enable = true);
+
+    /// @brief limits the rate of a single socket
+    ///
+    /// When a receive bucket runs dry, readable interest of the socket
+    /// is disabled; when the send bucket runs dry, output queued by
+    /// \ref send is deferred. Both are re-enabled when the buckets are
+    /// refilled. Buckets are refilled lazily and throttled sockets are
+    /// resumed by a shared timer per resume slot (10ms), so no timer
+    /// runs per socket.
+    ///
+    /// A socket is limited by at most one rate group; this leaves
+    /// a group joined before.
+    ///
+    /// @throws std::exception it is not allowed to limit an
+    ///         unmanaged socket
+    ///
+    /// @param sock socket to limit
+    /// @param options limits of the socket
+    void set_rate_limit(int sock, shaping_options const & options);
+
+    /// @brief removes the rate limit of a socket
+    ///
+    /// @throws std::exception unmanaged socket
+    ///
+    /// @param sock socket, which is not limited anymore
+    void clear_rate_limit(int sock);
+
+    /// @brief creates a group of sockets, which share rate limits
+    ///
+    /// @param options limits shared by all members of the group
+    /// @return identifier of the group
+    rate_group add_rate_group(shaping_options const & options);
+
+    /// @brief adds a socket to a rate group
+    ///
+    /// @throws std::exception unmanaged socket or unknown group
+    ///
+    /// @param sock socket to add
+    /// @param group group to join
+    void join_rate_group(int sock, rate_group group);
+
+    /// @brief removes a rate group; its members are not limited anymore
+    ///
+    /// @param group group to remove
+    void remove_rate_group(rate_group group);
+
+    /// @brief returns the underlying epoll file descriptor
+    ///
+    /// The descriptor becomes readable whenever events are pending.
+    ///
+    /// @return epoll file descriptor, -1 if the backend has none
+    int native_handle() const;
+
+    /// @brief places the loop on a CPU
+    ///
+    /// Pins the calling thread, which is expected to run the loop, to
+    /// the given CPU. Socket contexts allocated afterwards are taken
+    /// from memory preferably located at the NUMA node of that CPU.
+    ///
+    /// @throws std::exception failed to set the affinity
+    ///
+    /// @see affinity.hpp for steering of incoming connections
+    ///
+    /// @param cpu index of the CPU
+    void set_cpu_affinity(int cpu);
+
+    /// @brief enables tracing of socket callbacks
+    ///
+    /// When enabled, the duration of each callback is recorded in a
+    /// per-socket \ref latency_histogram and a \ref trace_record is
+    /// added to a ring buffer, overwriting the oldest record when full.
+    /// When disabled, tracing costs a single branch per dispatched event.
+    ///
+    /// @param ring_capacity number of records kept in the ring buffer
+    /// @param slow_threshold callbacks lasting at least this long are reported to on_slow
+    /// @param on_slow optional callback to report slow callbacks
+    void enable_tracing(
+        std::size_t ring_capacity = 4096,
+        std::chrono::nanoseconds slow_threshold = std::chrono::nanoseconds::max(),
+        trace_callback on_slow = nullptr);
+
+    /// @brief disables tracing and discards all recorded data
+    void disable_tracing();
+
+    /// @brief returns the callback durations recorded for a socket
+    ///
+    /// @throws std::exception it is not allowed to query an
+    ///         unmanaged socket
+    ///
+    /// @param sock socket to query
+    /// @return histogram of callback durations (empty, if tracing is disabled)
+    latency_histogram callback_latency(int sock) const;
+
+    /// @brief returns the contents of the trace ring buffer
+    /// @return trace records, oldest first
+    std::vector<trace_record> dump_trace() const;
+
+    /// @brief returns the counters of a socket
+    ///
+    /// @throws std::exception it is not allowed to query an
+    ///         unmanaged socket
+    ///
+    /// @param sock socket to query
+    /// @return counters of the socket
+    socket_statistics statistics(int sock) const;
+
+    /// @brief takes a snapshot of the counters of all sockets
+    ///
+    /// The snapshot is replaced; its capacity is reused, so periodic
+    /// snapshots into the same vector do not allocate once it has
+    /// grown to the number of sockets. Counters are kept anyway, so
+    /// taking a snapshot only costs a copy per socket.
+    ///
+    /// @param snapshot receives the counters of all managed sockets (unordered)
+    void statistics(std::vector<socket_statistics> & snapshot) const;
 private:
+    void add(int sock, uint32_t events, handler_dispatcher dispatcher, void * handler);
+    void submit_offload(worker_pool & pool, int sock, std::function<std::function<void()>()> work);
+
     class detail;
     detail * d;
 };
 
+/// @brief scope, that corks a manager
+///
+/// Writes issued by \ref manager::send within the scope are gathered
+/// and flushed when the scope ends.
+class cork_scope
+{
+    cork_scope(cork_scope const &) = delete;
+    cork_scope& operator=(cork_scope const &) = delete;
+public:
+    /// @brief corks the manager
+    /// @param manager manager to cork
+    explicit cork_scope(manager & manager)
+    : manager_(manager)
+    {
+        manager_.cork();
+    }
+
+    /// @brief uncorks the manager
+    ~cork_scope()
+    {
+        manager_.uncork();
+    }
+
+private:
+    manager & manager_;
+};
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_TLS_STREAM_HPP
+#define SOCKMAN_TLS_STREAM_HPP
+
+#include <sockman/sockman.hpp>
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <functional>
+
+// OpenSSL's SSL_CTX
+struct ssl_ctx_st;
+
+namespace sockman
+{
+
+/// @brief side of a TLS connection
+enum class tls_role
+{
+    client,
+    server
+};
+
+class tls_stream;
+
+/// @brief callback of a \ref tls_stream
+///
+/// Readable and writable refer to application data: readable is
+/// reported when \ref tls_stream::read may return data, writable
+/// when the handshake is complete or a blocked write can be retried.
+/// A failed handshake is reported as error.
+using tls_callback = std::function<void(tls_stream & stream, socket_events events)>;
+
+/// @brief TLS connection on top of a managed socket
+///
+/// The stream adds the socket to the manager and performs the
+/// handshake. OpenSSL's WANT_READ and WANT_WRITE conditions are
+/// mapped onto the interest of the socket, so the callback is only
+/// invoked when reading or writing application data can make progress.
+///
+/// Kernel TLS is requested for the connection (SSL_OP_ENABLE_KTLS). If
+/// the kernel and OpenSSL support the negotiated cipher, records are
+/// encrypted and / or decrypted by the kernel after the handshake; see
+/// \ref kernel_send and \ref kernel_receive. With kernel TLS for sending,
+/// \ref sendfile does not copy file contents to user space.
+///
+/// The stream does not take ownership of the socket.
+class tls_stream
+{
+    tls_stream(tls_stream const &) = delete;
+    tls_stream& operator=(tls_stream const &) = delete;
+public:
+    /// @brief adds a connected socket to the manager and starts the handshake
+    ///
+    /// The socket is switched to non-blocking mode.
+    ///
+    /// @throws std::exception failed to create the TLS connection
+    ///
+    /// @param manager manager to add the socket to
+    /// @param sock connected (or connecting) stream socket
+    /// @param context OpenSSL context (SSL_CTX) with certificates and verification set up
+    /// @param role client or server side
+    /// @param callback callback to invoke on events
+    tls_stream(manager & manager, int sock, ssl_ctx_st * context, tls_role role, tls_callback callback);
+
+    /// @brief removes the socket from the manager
+    ///
+    /// The socket is not closed.
+    ~tls_stream();
+
+    /// @brief returns the underlying socket
+    /// @return socket
+    int native_handle() const;
+
+    /// @brief returns true, if the handshake is complete
+    /// @return true, if the handshake is complete
+    bool established() const;
+
+    /// @brief returns true, if records are encrypted by the kernel
+    /// @return true, if kernel TLS is used for sending
+    bool kernel_send() const;
+
+    /// @brief returns true, if records are decrypted by the kernel
+    /// @return true, if kernel TLS is used for receiving
+    bool kernel_receive() const;
+
+    /// @brief reads application data
+    ///
+    /// Read until -1 is returned with errno set to EAGAIN; data
+    /// buffered by OpenSSL is not reported by the socket.
+    ///
+    /// @param buffer buffer to store data
+    /// @param length size of buffer in bytes
+    /// @return number of bytes read, 0 if the peer closed the
+    ///         connection, -1 on error (see errno)
+    ssize_t read(void * buffer, std::size_t length);
+
+    /// @brief writes application data
+    ///
+    /// Partial writes are possible. If -1 is returned with errno set
+    /// to EAGAIN, the callback reports writable once the write can be
+    /// retried; retry with the same data.
+    ///
+    /// @param data data to write
+    /// @param length length of data in bytes
+    /// @return number of bytes written, -1 on error (see errno)
+    ssize_t write(void const * data, std::size_t length);
+
+    /// @brief writes contents of a file
+    ///
+    /// Uses SSL_sendfile with kernel TLS, otherwise the contents are
+    /// read and written via \ref write.
+    ///
+    /// @param file file to read from
+    /// @param offset offset within file
+    /// @param size number of bytes to write
+    /// @return number of bytes written, -1 on error (see errno)
+    ssize_t sendfile(int file, off_t offset, std::size_t size);
+
+    /// @brief sends a close notification to the peer (best effort)
+    void shutdown();
+
+private:
+    class detail;
+    detail * d;
+};
+
+}
+
+#endif
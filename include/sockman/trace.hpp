@@ -0,0 +1,103 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_TRACE_HPP
+#define SOCKMAN_TRACE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+namespace sockman
+{
+
+/// @brief single entry of the trace ring buffer
+///
+/// Trace records are plain data and can be written to a file
+/// as they are for offline analysis.
+struct trace_record
+{
+    /// @brief start of the callback in nanoseconds (CLOCK_MONOTONIC)
+    uint64_t timestamp;
+
+    /// @brief socket of the callback
+    int32_t fd;
+
+    /// @brief epoll events passed to the callback
+    uint32_t events;
+
+    /// @brief duration of the callback in nanoseconds
+    uint64_t duration;
+};
+
+/// @brief trace callback
+///
+/// Defines the callback the \ref manager will call
+/// whenever a socket callback exceeds the slow threshold.
+///
+/// @param record trace record of the slow callback
+///
+/// @see manager::enable_tracing
+using trace_callback = ::std::function<void(trace_record const & record)>;
+
+/// @brief HDR-style histogram of callback durations
+///
+/// Values are recorded in logarithmic buckets, each split into
+/// linear sub-buckets. Recording is O(1) and the relative error of
+/// a reported value is bounded by 1 / \ref sub_buckets.
+class latency_histogram
+{
+public:
+    /// @brief number of linear sub-buckets per power of two
+    static constexpr std::size_t const sub_buckets = 8;
+
+    /// @brief total number of buckets
+    static constexpr std::size_t const bucket_count = 62 * sub_buckets;
+
+    /// @brief creates an empty histogram
+    latency_histogram();
+
+    /// @brief records a value
+    /// @param value value in nanoseconds
+    void record(uint64_t value);
+
+    /// @brief removes all recorded values
+    void reset();
+
+    /// @brief returns the number of recorded values
+    /// @return number of recorded values
+    uint64_t count() const;
+
+    /// @brief returns the smallest recorded value
+    /// @return smallest recorded value or 0, if the histogram is empty
+    uint64_t min() const;
+
+    /// @brief returns the largest recorded value
+    /// @return largest recorded value or 0, if the histogram is empty
+    uint64_t max() const;
+
+    /// @brief returns the value at the given percentile
+    ///
+    /// The result is the upper bound of the bucket containing
+    /// the percentile, limited to \ref max.
+    ///
+    /// @param percentile percentile in the range [0, 100]
+    /// @return value at the percentile or 0, if the histogram is empty
+    uint64_t percentile(double percentile) const;
+
+private:
+    static std::size_t index_of(uint64_t value);
+    static uint64_t upper_bound_of(std::size_t index);
+
+    uint32_t counts[bucket_count];
+    uint64_t count_;
+    uint64_t min_;
+    uint64_t max_;
+};
+
+}
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_UPSTREAM_POOL_HPP
+#define SOCKMAN_UPSTREAM_POOL_HPP
+
+#include <sockman/sockman.hpp>
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sockman
+{
+
+/// @brief options of an \ref upstream_pool
+struct upstream_pool_options
+{
+    /// @brief maximum number of idle connections kept per upstream
+    std::size_t max_idle_per_upstream = 16;
+
+    /// @brief maximum number of connects in progress (all upstreams)
+    std::size_t max_concurrent_connects = 64;
+
+    /// @brief idle connections are closed after this time (0 keeps them)
+    std::chrono::nanoseconds idle_timeout = std::chrono::seconds(60);
+};
+
+/// @brief keyed pool of connections to upstream servers
+///
+/// Connections are acquired by upstream key. Idle connections are reused;
+/// otherwise a new connection is established via \ref manager::connect.
+/// Connects exceeding max_concurrent_connects are queued.
+///
+/// While idle, connections are watched by the manager: an idle connection
+/// that becomes readable, is hung up or reports an error is considered
+/// unhealthy and closed. Idle connections are closed by a timer of the
+/// manager once idle_timeout expired.
+///
+/// @note the pool must not outlive its manager
+class upstream_pool
+{
+    upstream_pool(upstream_pool const &) = delete;
+    upstream_pool& operator=(upstream_pool const &) = delete;
+public:
+    /// @brief creates an empty pool
+    ///
+    /// @param manager manager used to connect and watch connections
+    /// @param options pool options
+    explicit upstream_pool(manager & manager, upstream_pool_options const & options = upstream_pool_options());
+
+    /// @brief closes all idle connections and aborts pending connects
+    ///
+    /// Callbacks of pending or queued acquisitions are not invoked.
+    ~upstream_pool();
+
+    /// @brief defines the address of an upstream
+    ///
+    /// @throws std::exception address too long
+    ///
+    /// @param key key of the upstream
+    /// @param address address of the upstream
+    /// @param length length of the address
+    void add_upstream(std::string const & key, sockaddr const * address, socklen_t length);
+
+    /// @brief acquires a connection to an upstream
+    ///
+    /// The callback receives a connected socket (which is not managed) or
+    /// -1 and an error code. If an idle connection is available, the callback is
+    /// invoked before acquire returns; otherwise it is invoked from a later
+    /// \ref manager::service call, even if the connect fails immediately.
+    ///
+    /// @throws std::exception unknown upstream
+    ///
+    /// @param key key of the upstream
+    /// @param callback callback to invoke with the connection
+    void acquire(std::string const & key, connect_callback callback);
+
+    /// @brief returns a connection to the pool
+    ///
+    /// The connection must not be managed anymore. It is closed if it is
+    /// not reusable or the idle limit of the upstream is reached.
+    ///
+    /// @param key key of the upstream
+    /// @param fd connection to return
+    /// @param reusable false, if the connection is known to be unhealthy
+    void release(std::string const & key, int fd, bool reusable = true);
+
+    /// @brief returns the number of idle connections of an upstream
+    /// @param key key of the upstream
+    /// @return number of idle connections
+    std::size_t idle_count(std::string const & key) const;
+
+    /// @brief returns the number of connects in progress
+    /// @return number of connects in progress
+    std::size_t pending_connects() const;
+
+private:
+    struct idle_connection
+    {
+        int fd;
+        timer_id timer;
+    };
+
+    struct request
+    {
+        std::string key;
+        connect_callback callback;
+    };
+
+    struct upstream
+    {
+        sockaddr_storage address;
+        socklen_t length;
+        std::vector<idle_connection> idle;
+    };
+
+    void start_connect(std::string const & key, connect_callback callback);
+    void on_connected(int fd, int error, connect_callback const & callback);
+    void evict(int fd);
+    void fail(connect_callback callback, int error);
+
+    manager & manager_;
+    upstream_pool_options options_;
+    std::unordered_map<std::string, upstream> upstreams;
+    std::unordered_map<int, std::string> idle_keys;
+    std::vector<int> connecting;
+    std::deque<request> queue;
+    std::shared_ptr<bool> alive;
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_WORKER_POOL_HPP
+#define SOCKMAN_WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sockman
+{
+
+/// @brief work-stealing thread pool for CPU-heavy work
+///
+/// Each worker owns a queue. Tasks submitted by a worker are pushed
+/// to its own queue, other tasks are distributed round-robin. Workers
+/// take tasks from the back of their own queue and steal from the
+/// front of other queues when their queue is empty.
+///
+/// Use \ref manager::offload to run work for a socket and receive the
+/// results on the loop thread.
+class worker_pool
+{
+    worker_pool(worker_pool const &) = delete;
+    worker_pool& operator=(worker_pool const &) = delete;
+public:
+    /// @brief starts the workers
+    ///
+    /// @param threads number of workers, 0 uses one per hardware thread
+    explicit worker_pool(std::size_t threads = 0);
+
+    /// @brief runs all queued tasks and stops the workers
+    ~worker_pool();
+
+    /// @brief queues a task
+    ///
+    /// Thread-safe.
+    ///
+    /// @param task task to run on a worker
+    void submit(std::function<void()> task);
+
+    /// @brief returns the number of workers
+    /// @return number of workers
+    std::size_t size() const;
+
+private:
+    struct task_queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(std::size_t index);
+    bool take(std::size_t index, std::function<void()> & task);
+
+    std::vector<std::unique_ptr<task_queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::atomic<std::size_t> pending;
+    std::atomic<std::size_t> next;
+    bool stopping;
+};
+
+}
+
+#endif
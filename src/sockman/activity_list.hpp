@@ -0,0 +1,103 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_ACTIVITY_LIST_HPP
+#define SOCKMAN_ACTIVITY_LIST_HPP
+
+#include "sockman/socket_context.hpp"
+
+namespace sockman
+{
+
+/// Intrusive list of socket contexts ordered by last activity.
+///
+/// Touching a context moves it to the back in O(1), so the front
+/// always holds the context which was inactive for the longest time.
+class activity_list
+{
+    activity_list(activity_list const &) = delete;
+    activity_list& operator=(activity_list const &) = delete;
+public:
+    activity_list()
+    : head(nullptr)
+    , tail(nullptr)
+    {
+    }
+
+    socket_context * front() const
+    {
+        return head;
+    }
+
+    bool contains(socket_context const & context) const
+    {
+        return context.activity_tracked;
+    }
+
+    void touch(socket_context & context, std::chrono::steady_clock::time_point now)
+    {
+        context.last_activity = now;
+        if (&context != tail)
+        {
+            unlink(context);
+            link_back(context);
+        }
+    }
+
+    void link_back(socket_context & context)
+    {
+        context.activity_prev = tail;
+        context.activity_next = nullptr;
+        if (nullptr != tail)
+        {
+            tail->activity_next = &context;
+        }
+        else
+        {
+            head = &context;
+        }
+        tail = &context;
+        context.activity_tracked = true;
+    }
+
+    void unlink(socket_context & context)
+    {
+        if (!context.activity_tracked)
+        {
+            return;
+        }
+
+        if (nullptr != context.activity_prev)
+        {
+            context.activity_prev->activity_next = context.activity_next;
+        }
+        else
+        {
+            head = context.activity_next;
+        }
+
+        if (nullptr != context.activity_next)
+        {
+            context.activity_next->activity_prev = context.activity_prev;
+        }
+        else
+        {
+            tail = context.activity_prev;
+        }
+
+        context.activity_prev = nullptr;
+        context.activity_next = nullptr;
+        context.activity_tracked = false;
+    }
+
+private:
+    socket_context * head;
+    socket_context * tail;
+};
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/affinity.hpp"
+
+#include <sched.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+namespace sockman
+{
+
+void pin_thread_to_cpu(int cpu)
+{
+    if ((0 > cpu) || (CPU_SETSIZE <= cpu))
+    {
+        throw std::runtime_error("invalid cpu");
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    int const rc = sched_setaffinity(0, sizeof(cpus), &cpus);
+    if (0 != rc)
+    {
+        throw std::runtime_error("failed to set cpu affinity");
+    }
+}
+
+int numa_node_of_cpu(int cpu)
+{
+    std::string const path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR * dir = opendir(path.c_str());
+    if (nullptr == dir)
+    {
+        return -1;
+    }
+
+    int node = -1;
+    dirent * entry = readdir(dir);
+    while ((nullptr != entry) && (0 > node))
+    {
+        if ((0 == strncmp(entry->d_name, "node", 4)) && ('\0' != entry->d_name[4]))
+        {
+            char * end = nullptr;
+            long const value = strtol(&(entry->d_name[4]), &end, 10);
+            if ('\0' == *end)
+            {
+                node = static_cast<int>(value);
+            }
+        }
+
+        entry = readdir(dir);
+    }
+
+    closedir(dir);
+    return node;
+}
+
+void set_incoming_cpu(int sock, int cpu)
+{
+    int const rc = setsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+    if (0 != rc)
+    {
+        throw std::runtime_error("failed to set SO_INCOMING_CPU");
+    }
+}
+
+void steer_reuseport_by_cpu(int sock, unsigned int group_size)
+{
+    if (0 == group_size)
+    {
+        throw std::runtime_error("invalid group size");
+    }
+
+    sock_filter code[] =
+    {
+        // A = current cpu
+        { BPF_LD  | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+        // A = A % group_size
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, group_size },
+        // return A (index of the selected socket)
+        { BPF_RET | BPF_A, 0, 0, 0 }
+    };
+
+    sock_fprog program;
+    program.len = sizeof(code) / sizeof(code[0]);
+    program.filter = code;
+
+    int const rc = setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program));
+    if (0 != rc)
+    {
+        throw std::runtime_error("failed to attach reuseport program");
+    }
+}
+
+}
@@ -0,0 +1,454 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/backend.hpp"
+#include "sockman/timespec.hpp"
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace sockman
+{
+
+epoll_backend::epoll_backend()
+: fd(epoll_create1(EPOLL_CLOEXEC))
+, timer_fd(-1)
+, alarm_fd(-1)
+#ifdef SYS_epoll_pwait2
+, has_pwait2(true)
+#else
+, has_pwait2(false)
+#endif
+{
+    if (0 > fd)
+    {
+        throw std::runtime_error("failed to create epoll socket");
+    }
+}
+
+epoll_backend::~epoll_backend()
+{
+    if (0 <= alarm_fd)
+    {
+        ::close(alarm_fd);
+    }
+    if (0 <= timer_fd)
+    {
+        ::close(timer_fd);
+    }
+    ::close(fd);
+}
+
+int epoll_backend::add(int sock, uint32_t events, void * data)
+{
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.data.ptr = data;
+    event.events = events;
+
+    return epoll_ctl(fd, EPOLL_CTL_ADD, sock, &event);
+}
+
+int epoll_backend::modify(int sock, uint32_t events, void * data)
+{
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.data.ptr = data;
+    event.events = events;
+
+    return epoll_ctl(fd, EPOLL_CTL_MOD, sock, &event);
+}
+
+int epoll_backend::remove(int sock)
+{
+    return epoll_ctl(fd, EPOLL_CTL_DEL, sock, nullptr);
+}
+
+int epoll_backend::wait(epoll_event * events, int max_events, clock::time_point deadline)
+{
+    if (clock::time_point::max() == deadline)
+    {
+        return epoll_wait(fd, events, max_events, -1);
+    }
+
+    if (clock::time_point::min() == deadline)
+    {
+        return epoll_wait(fd, events, max_events, 0);
+    }
+
+#ifdef SYS_epoll_pwait2
+    if (has_pwait2)
+    {
+        auto const timeout = std::max(deadline - clock::now(), clock::duration::zero());
+        timespec const relative = to_timespec(timeout);
+        int const rc = ::syscall(SYS_epoll_pwait2, fd, events, max_events, &relative, nullptr, 0);
+        if ((0 <= rc) || (ENOSYS != errno))
+        {
+            return rc;
+        }
+
+        has_pwait2 = false;
+    }
+#endif
+
+    if (deadline <= clock::now())
+    {
+        return epoll_wait(fd, events, max_events, 0);
+    }
+
+    return wait_timerfd(events, max_events, deadline);
+}
+
+int epoll_backend::wait_timerfd(epoll_event * events, int max_events, clock::time_point deadline)
+{
+    if (0 > timer_fd)
+    {
+        int const tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (0 > tfd)
+        {
+            throw std::runtime_error("failed to create timerfd");
+        }
+
+        int const rc = add(tfd, EPOLLIN, nullptr);
+        if (0 != rc)
+        {
+            ::close(tfd);
+            throw std::runtime_error("epoll_ctl: failed to add timerfd");
+        }
+
+        timer_fd = tfd;
+    }
+
+    // steady_clock is based on CLOCK_MONOTONIC, so the deadline
+    // can be passed to the timerfd as absolute value
+    itimerspec value;
+    memset(&value, 0, sizeof(value));
+    value.it_value = to_timespec(deadline.time_since_epoch());
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &value, nullptr);
+
+    int const rc = epoll_wait(fd, events, max_events, -1);
+
+    // disarming the timer also discards an expiration, that is not read yet
+    memset(&value, 0, sizeof(value));
+    timerfd_settime(timer_fd, 0, &value, nullptr);
+
+    return rc;
+}
+
+void epoll_backend::set_alarm(clock::time_point deadline, void * data)
+{
+    if (0 > alarm_fd)
+    {
+        if (clock::time_point::max() == deadline)
+        {
+            return;
+        }
+
+        int const afd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (0 > afd)
+        {
+            throw std::runtime_error("failed to create timerfd");
+        }
+
+        int const rc = add(afd, EPOLLIN, data);
+        if (0 != rc)
+        {
+            ::close(afd);
+            throw std::runtime_error("epoll_ctl: failed to add timerfd");
+        }
+
+        alarm_fd = afd;
+    }
+
+    // setting the timer resets the expiration count, so the
+    // descriptor never needs to be read
+    itimerspec value;
+    memset(&value, 0, sizeof(value));
+    if (clock::time_point::max() != deadline)
+    {
+        value.it_value = to_timespec(deadline.time_since_epoch());
+        if ((0 == value.it_value.tv_sec) && (0 == value.it_value.tv_nsec))
+        {
+            value.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(alarm_fd, TFD_TIMER_ABSTIME, &value, nullptr);
+}
+
+backend::clock::time_point epoll_backend::now() const
+{
+    return clock::now();
+}
+
+int epoll_backend::native_handle() const
+{
+    return fd;
+}
+
+simulated_backend::simulated_backend()
+: cursor(-1)
+, current(clock::time_point())
+, alarm(clock::time_point::max())
+, alarm_data(nullptr)
+, failure(0)
+, seed_(0)
+{
+
+}
+
+simulated_backend::~simulated_backend()
+{
+
+}
+
+int simulated_backend::add(int fd, uint32_t events, void * data)
+{
+    if (take_failure())
+    {
+        return -1;
+    }
+
+    if (0 > fd)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    auto result = entries.insert({fd, entry{events, data, 0, 0, 0, true}});
+    if (!result.second)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    return 0;
+}
+
+int simulated_backend::modify(int fd, uint32_t events, void * data)
+{
+    if (take_failure())
+    {
+        return -1;
+    }
+
+    auto it = entries.find(fd);
+    if (it == entries.end())
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    // like epoll, modifying re-arms the descriptor and reports current readiness
+    it->second.interest = events;
+    it->second.data = data;
+    it->second.edges = it->second.ready;
+    it->second.armed = true;
+    update(fd, it->second);
+    return 0;
+}
+
+int simulated_backend::remove(int fd)
+{
+    if (take_failure())
+    {
+        return -1;
+    }
+
+    if (0 == entries.erase(fd))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    candidates.erase(fd);
+    return 0;
+}
+
+int simulated_backend::wait(epoll_event * events, int max_events, clock::time_point deadline)
+{
+    int count = 0;
+    if ((alarm <= current) && (count < max_events))
+    {
+        events[count].events = EPOLLIN;
+        events[count].data.ptr = alarm_data;
+        alarm = clock::time_point::max();
+        count++;
+    }
+
+    // like epoll, continue after the last reported descriptor,
+    // so descriptors beyond max_events are not starved
+    if (!candidates.empty())
+    {
+        auto it = candidates.upper_bound(cursor);
+        for (std::size_t visited = candidates.size(); (0 < visited) && (count < max_events); visited--)
+        {
+            if (it == candidates.end())
+            {
+                it = candidates.begin();
+            }
+
+            int const fd = *it;
+            ++it;
+
+            auto & e = entries[fd];
+            uint32_t const reported = pending(e);
+            if (0 != reported)
+            {
+                events[count].events = reported;
+                events[count].data.ptr = e.data;
+                count++;
+                cursor = fd;
+
+                e.triggered = 0;
+                e.edges = 0;
+                if (0 != (e.interest & EPOLLONESHOT))
+                {
+                    e.armed = false;
+                }
+                update(fd, e);
+            }
+        }
+    }
+
+    if (0 < count)
+    {
+        if (0 != seed_)
+        {
+            // xorshift32, deterministic for a given seed and sequence of waits
+            for (int i = count - 1; i > 0; i--)
+            {
+                seed_ ^= seed_ << 13;
+                seed_ ^= seed_ >> 17;
+                seed_ ^= seed_ << 5;
+                std::swap(events[i], events[seed_ % static_cast<uint32_t>(i + 1)]);
+            }
+        }
+
+        return count;
+    }
+
+    if ((clock::time_point::max() != alarm) && (alarm <= deadline))
+    {
+        current = std::max(current, alarm);
+        return wait(events, max_events, deadline);
+    }
+
+    if ((clock::time_point::min() != deadline) && (clock::time_point::max() != deadline))
+    {
+        current = std::max(current, deadline);
+    }
+
+    return 0;
+}
+
+void simulated_backend::set_alarm(clock::time_point deadline, void * data)
+{
+    alarm = deadline;
+    alarm_data = data;
+}
+
+backend::clock::time_point simulated_backend::now() const
+{
+    return current;
+}
+
+int simulated_backend::native_handle() const
+{
+    return -1;
+}
+
+void simulated_backend::set_ready(int fd, uint32_t events)
+{
+    auto it = entries.find(fd);
+    if (it != entries.end())
+    {
+        it->second.edges |= events & (~it->second.ready);
+        it->second.ready = events;
+        update(fd, it->second);
+    }
+}
+
+void simulated_backend::trigger(int fd, uint32_t events)
+{
+    auto it = entries.find(fd);
+    if (it != entries.end())
+    {
+        it->second.triggered |= events;
+        update(fd, it->second);
+    }
+}
+
+void simulated_backend::advance(std::chrono::nanoseconds duration)
+{
+    current += std::chrono::duration_cast<clock::duration>(duration);
+}
+
+void simulated_backend::fail_next(int error)
+{
+    failure = error;
+}
+
+void simulated_backend::shuffle(uint32_t seed)
+{
+    seed_ = seed;
+}
+
+std::size_t simulated_backend::watched() const
+{
+    return entries.size();
+}
+
+uint32_t simulated_backend::interest(int fd) const
+{
+    auto it = entries.find(fd);
+    return (it != entries.end()) ? it->second.interest : 0;
+}
+
+bool simulated_backend::take_failure()
+{
+    if (0 == failure)
+    {
+        return false;
+    }
+
+    errno = failure;
+    failure = 0;
+    return true;
+}
+
+uint32_t simulated_backend::pending(entry const & e) const
+{
+    if (!e.armed)
+    {
+        return 0;
+    }
+
+    constexpr uint32_t const always = EPOLLERR | EPOLLHUP;
+    uint32_t const ready = (0 != (e.interest & EPOLLET)) ? e.edges : e.ready;
+    return (ready | e.triggered) & (e.interest | always);
+}
+
+void simulated_backend::update(int fd, entry const & e)
+{
+    if (0 != pending(e))
+    {
+        candidates.insert(fd);
+    }
+    else
+    {
+        candidates.erase(fd);
+    }
+}
+
+}
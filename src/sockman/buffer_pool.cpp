@@ -0,0 +1,183 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/buffer.hpp"
+#include "sockman/numa.hpp"
+
+#include <sys/mman.h>
+
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace sockman
+{
+
+namespace
+{
+
+constexpr std::size_t const min_chunk_size = 64 * 1024;
+constexpr std::size_t const page_size = 4096;
+constexpr uint32_t const class_count = 15;
+
+static_assert((buffer_pool::min_size << (class_count - 1)) == buffer_pool::max_size,
+    "size classes must cover [min_size, max_size]");
+
+uint32_t size_class_of(std::size_t size)
+{
+    if (size <= buffer_pool::min_size)
+    {
+        return 0;
+    }
+
+    constexpr int const min_shift = 6;
+    int const bits = static_cast<int>(8 * sizeof(unsigned long)) - __builtin_clzl(static_cast<unsigned long>(size - 1));
+    return static_cast<uint32_t>(bits - min_shift);
+}
+
+}
+
+struct buffer_pool_state
+{
+    buffer_pool_state()
+    : free_list{}
+    , free_count(0)
+    , outstanding(0)
+    , numa_node(-1)
+    , alive(true)
+    {
+    }
+
+    ~buffer_pool_state()
+    {
+        for(auto const & chunk: chunks)
+        {
+            ::munmap(chunk.first, chunk.second);
+        }
+    }
+
+    void grow(uint32_t size_class);
+
+    buffer_block * free_list[class_count];
+    std::vector<std::pair<void*, std::size_t>> chunks;
+    std::size_t free_count;
+    std::size_t outstanding;
+    int numa_node;
+    bool alive;
+};
+
+void buffer_pool_state::grow(uint32_t size_class)
+{
+    std::size_t const capacity = buffer_pool::min_size << size_class;
+    std::size_t const stride = sizeof(buffer_block) + capacity;
+    std::size_t chunk_size = (stride < min_chunk_size) ? min_chunk_size : stride;
+    chunk_size = (chunk_size + page_size - 1) & ~(page_size - 1);
+
+    chunks.reserve(chunks.size() + 1);
+    void * chunk = ::mmap(nullptr, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == chunk)
+    {
+        throw std::bad_alloc();
+    }
+
+    if (0 <= numa_node)
+    {
+        bind_to_numa_node(chunk, chunk_size, numa_node);
+    }
+    chunks.emplace_back(chunk, chunk_size);
+
+    char * const base = reinterpret_cast<char*>(chunk);
+    std::size_t const count = chunk_size / stride;
+    for (std::size_t i = count; i > 0; i--)
+    {
+        auto * block = new (base + ((i - 1) * stride)) buffer_block{this, free_list[size_class], capacity, 0, 0, size_class};
+        free_list[size_class] = block;
+    }
+    free_count += count;
+}
+
+constexpr std::size_t const buffer_pool::min_size;
+constexpr std::size_t const buffer_pool::max_size;
+
+buffer_pool::buffer_pool()
+: state(new buffer_pool_state())
+{
+
+}
+
+buffer_pool::~buffer_pool()
+{
+    state->alive = false;
+    if (0 == state->outstanding)
+    {
+        delete state;
+    }
+}
+
+buffer buffer_pool::allocate(std::size_t size)
+{
+    buffer_block * block = nullptr;
+    if (size <= max_size)
+    {
+        uint32_t const size_class = size_class_of(size);
+        if (nullptr == state->free_list[size_class])
+        {
+            state->grow(size_class);
+        }
+
+        block = state->free_list[size_class];
+        state->free_list[size_class] = block->next;
+        state->free_count--;
+        state->outstanding++;
+    }
+    else
+    {
+        void * storage = ::operator new(sizeof(buffer_block) + size);
+        block = new (storage) buffer_block{nullptr, nullptr, size, 0, 0, class_count};
+    }
+
+    block->next = nullptr;
+    block->size = size;
+    block->refcount = 1;
+    return buffer(block);
+}
+
+void buffer_pool::set_numa_node(int node)
+{
+    state->numa_node = node;
+}
+
+std::size_t buffer_pool::chunk_count() const
+{
+    return state->chunks.size();
+}
+
+std::size_t buffer_pool::free_count() const
+{
+    return state->free_count;
+}
+
+void buffer_pool::recycle(buffer_block * block)
+{
+    buffer_pool_state * pool = block->state;
+    if (nullptr == pool)
+    {
+        ::operator delete(reinterpret_cast<void*>(block));
+        return;
+    }
+
+    block->next = pool->free_list[block->size_class];
+    pool->free_list[block->size_class] = block;
+    pool->free_count++;
+    pool->outstanding--;
+
+    if ((!pool->alive) && (0 == pool->outstanding))
+    {
+        delete pool;
+    }
+}
+
+}
@@ -0,0 +1,616 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/concurrent_manager.hpp"
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace sockman
+{
+
+namespace
+{
+
+constexpr int const batch_size = 64;
+constexpr std::size_t const chunk_size = 4096;
+constexpr std::size_t const chunk_count = concurrent_manager::max_descriptor / chunk_size;
+
+// identifies the wakeup eventfd; registrations use their generation
+// in the upper 32 bits, which is never zero
+constexpr uint64_t const wakeup_tag = 0;
+
+// The epoll data of a registration carries descriptor and generation
+// instead of a pointer, so an event of a removed registration, which
+// was already fetched by another thread, is detected as stale.
+uint64_t make_tag(int fd, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+
+struct registration_entry
+{
+    registration_entry(int sock, uint32_t generation_, uint32_t events_, socket_callback callback_)
+    : fd(sock)
+    , generation(generation_)
+    , events(events_)
+    , dispatching(false)
+    , removed(false)
+    , callback(std::move(callback_))
+    , next_retired(nullptr)
+    , retired_epoch(0)
+    {
+
+    }
+
+    int const fd;
+    uint32_t const generation;
+
+    // guards events and the arm state; only held for epoll_ctl, never
+    // while the callback runs
+    std::mutex mutex;
+    uint32_t events;
+    bool dispatching;
+    bool removed;
+
+    socket_callback callback;
+    registration_entry * next_retired;
+    uint64_t retired_epoch;
+};
+
+using slot = std::atomic<registration_entry*>;
+
+// Per-thread epoch announcement. The state is 0 while the thread is
+// outside a critical section, or (epoch << 1) | 1 inside.
+struct thread_record
+{
+    std::atomic<uint64_t> state;
+    std::atomic<bool> in_use;
+    thread_record * next;
+};
+
+}
+
+class concurrent_manager::detail
+{
+public:
+    detail(int epoll, int wakeup)
+    : epoll_fd(epoll)
+    , wake_fd(wakeup)
+    , next_generation(1)
+    , records(nullptr)
+    , epoch(1)
+    , retired(nullptr)
+    , retired_count(0)
+    , running(0)
+    , stop_requested(false)
+    {
+        for (auto & chunk: chunks)
+        {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+        reclaiming.clear();
+    }
+
+    ~detail()
+    {
+        for (auto & chunk: chunks)
+        {
+            slot * const slots = chunk.load(std::memory_order_relaxed);
+            if (nullptr != slots)
+            {
+                for (std::size_t i = 0; i < chunk_size; i++)
+                {
+                    delete slots[i].load(std::memory_order_relaxed);
+                }
+                delete[] slots;
+            }
+        }
+
+        registration_entry * entry = retired.load(std::memory_order_relaxed);
+        while (nullptr != entry)
+        {
+            registration_entry * const next = entry->next_retired;
+            delete entry;
+            entry = next;
+        }
+
+        thread_record * record = records.load(std::memory_order_relaxed);
+        while (nullptr != record)
+        {
+            thread_record * const next = record->next;
+            delete record;
+            record = next;
+        }
+
+        ::close(wake_fd);
+        ::close(epoll_fd);
+    }
+
+    slot * find_slot(int fd, bool create);
+    registration_entry * lookup(int fd);
+    void modify(int fd, uint32_t mask, bool enable);
+    void arm(registration_entry & entry);
+    void dispatch(epoll_event const * events, int count, bool & woken);
+    void release(epoll_event const * events, int count, bool & woken);
+    void dispatch_entry(registration_entry & entry, uint32_t received);
+    void pass_wakeup();
+
+    thread_record * acquire_record();
+    void enter(thread_record & record);
+    void leave(thread_record & record);
+    void retire(registration_entry * entry);
+    void reclaim();
+
+    int epoll_fd;
+    int wake_fd;
+    std::atomic<slot*> chunks[chunk_count];
+    std::atomic<uint32_t> next_generation;
+
+    std::atomic<thread_record*> records;
+    std::atomic<uint64_t> epoch;
+    std::atomic<registration_entry*> retired;
+    std::atomic<std::size_t> retired_count;
+    std::atomic_flag reclaiming;
+
+    std::atomic<std::size_t> running;
+    std::atomic<bool> stop_requested;
+};
+
+slot * concurrent_manager::detail::find_slot(int fd, bool create)
+{
+    if ((0 > fd) || (max_descriptor <= fd))
+    {
+        return nullptr;
+    }
+
+    std::size_t const index = static_cast<std::size_t>(fd);
+    auto & chunk = chunks[index / chunk_size];
+    slot * slots = chunk.load(std::memory_order_acquire);
+    if ((nullptr == slots) && (create))
+    {
+        // chunks are never freed before destruction, so a lost race
+        // just discards the new chunk
+        slot * const fresh = new slot[chunk_size];
+        for (std::size_t i = 0; i < chunk_size; i++)
+        {
+            fresh[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        if (chunk.compare_exchange_strong(slots, fresh, std::memory_order_acq_rel))
+        {
+            slots = fresh;
+        }
+        else
+        {
+            delete[] fresh;
+        }
+    }
+
+    return (nullptr != slots) ? &(slots[index % chunk_size]) : nullptr;
+}
+
+registration_entry * concurrent_manager::detail::lookup(int fd)
+{
+    slot * const entry_slot = find_slot(fd, false);
+    return (nullptr != entry_slot) ? entry_slot->load(std::memory_order_acquire) : nullptr;
+}
+
+void concurrent_manager::detail::arm(registration_entry & entry)
+{
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = entry.events | EPOLLONESHOT;
+    event.data.u64 = make_tag(entry.fd, entry.generation);
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, entry.fd, &event);
+}
+
+void concurrent_manager::detail::modify(int fd, uint32_t mask, bool enable)
+{
+    thread_record & record = *acquire_record();
+    enter(record);
+
+    registration_entry * const entry = lookup(fd);
+    if (nullptr != entry)
+    {
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        entry->events = enable ? (entry->events | mask) : (entry->events & (~mask));
+        if ((!entry->dispatching) && (!entry->removed))
+        {
+            // a concurrently fetched event is skipped by dispatch_entry
+            // while the callback of the socket is running
+            arm(*entry);
+        }
+    }
+
+    leave(record);
+    if (nullptr == entry)
+    {
+        throw std::runtime_error("socket not found");
+    }
+}
+
+void concurrent_manager::detail::dispatch(epoll_event const * events, int count, bool & woken)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t const tag = events[i].data.u64;
+        if (wakeup_tag == tag)
+        {
+            woken = true;
+            continue;
+        }
+
+        int const fd = static_cast<int>(static_cast<uint32_t>(tag));
+        uint32_t const generation = static_cast<uint32_t>(tag >> 32);
+        registration_entry * const entry = lookup(fd);
+        if ((nullptr != entry) && (entry->generation == generation))
+        {
+            try
+            {
+                dispatch_entry(*entry, events[i].events);
+            }
+            catch (...)
+            {
+                release(&(events[i + 1]), count - i - 1, woken);
+                throw;
+            }
+        }
+    }
+}
+
+void concurrent_manager::detail::release(epoll_event const * events, int count, bool & woken)
+{
+    // fetched events disarmed their sockets; without re-arming, the
+    // sockets of events left undispatched are never reported again
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t const tag = events[i].data.u64;
+        if (wakeup_tag == tag)
+        {
+            woken = true;
+            continue;
+        }
+
+        int const fd = static_cast<int>(static_cast<uint32_t>(tag));
+        uint32_t const generation = static_cast<uint32_t>(tag >> 32);
+        registration_entry * const entry = lookup(fd);
+        if ((nullptr != entry) && (entry->generation == generation))
+        {
+            std::lock_guard<std::mutex> lock(entry->mutex);
+            if ((!entry->removed) && (!entry->dispatching))
+            {
+                arm(*entry);
+            }
+        }
+    }
+}
+
+void concurrent_manager::detail::dispatch_entry(registration_entry & entry, uint32_t received)
+{
+    {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        if ((entry.removed) || (entry.dispatching))
+        {
+            return;
+        }
+        entry.dispatching = true;
+    }
+
+    try
+    {
+        entry.callback(entry.fd, socket_events(received));
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        entry.dispatching = false;
+        if (!entry.removed)
+        {
+            arm(entry);
+        }
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    entry.dispatching = false;
+    if (!entry.removed)
+    {
+        arm(entry);
+    }
+}
+
+void concurrent_manager::detail::pass_wakeup()
+{
+    if (!stop_requested.load(std::memory_order_acquire))
+    {
+        uint64_t value;
+        auto const count = ::read(wake_fd, &value, sizeof(value));
+        (void) count;
+    }
+
+    // the eventfd is one-shot too; while it is still readable, the
+    // next waiting thread is woken up
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = wakeup_tag;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, wake_fd, &event);
+}
+
+thread_record * concurrent_manager::detail::acquire_record()
+{
+    for (thread_record * record = records.load(std::memory_order_acquire); nullptr != record; record = record->next)
+    {
+        bool expected = false;
+        if ((!record->in_use.load(std::memory_order_relaxed))
+            && (record->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)))
+        {
+            return record;
+        }
+    }
+
+    // records are never removed, so pushing is the only modification
+    thread_record * const record = new thread_record();
+    record->state.store(0, std::memory_order_relaxed);
+    record->in_use.store(true, std::memory_order_relaxed);
+    record->next = records.load(std::memory_order_relaxed);
+    while (!records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+
+    return record;
+}
+
+void concurrent_manager::detail::enter(thread_record & record)
+{
+    uint64_t const current = epoch.load(std::memory_order_acquire);
+    record.state.store((current << 1) | 1, std::memory_order_seq_cst);
+}
+
+void concurrent_manager::detail::leave(thread_record & record)
+{
+    record.state.store(0, std::memory_order_release);
+    record.in_use.store(false, std::memory_order_release);
+}
+
+void concurrent_manager::detail::retire(registration_entry * entry)
+{
+    entry->retired_epoch = epoch.load(std::memory_order_seq_cst);
+    entry->next_retired = retired.load(std::memory_order_relaxed);
+    while (!retired.compare_exchange_weak(entry->next_retired, entry, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+    retired_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void concurrent_manager::detail::reclaim()
+{
+    if ((nullptr == retired.load(std::memory_order_relaxed)) || (reclaiming.test_and_set(std::memory_order_acquire)))
+    {
+        return;
+    }
+
+    // advance the epoch once all threads inside a critical section
+    // have seen the current one
+    uint64_t current = epoch.load(std::memory_order_seq_cst);
+    bool all_current = true;
+    for (thread_record * record = records.load(std::memory_order_acquire); nullptr != record; record = record->next)
+    {
+        uint64_t const state = record->state.load(std::memory_order_seq_cst);
+        if ((0 != (state & 1)) && ((state >> 1) != current))
+        {
+            all_current = false;
+            break;
+        }
+    }
+
+    if (all_current)
+    {
+        epoch.store(current + 1, std::memory_order_seq_cst);
+        current++;
+    }
+
+    // entries retired two epochs ago cannot be referenced anymore
+    registration_entry * entry = retired.exchange(nullptr, std::memory_order_acquire);
+    while (nullptr != entry)
+    {
+        registration_entry * const next = entry->next_retired;
+        if (entry->retired_epoch + 2 <= current)
+        {
+            delete entry;
+            retired_count.fetch_sub(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            entry->next_retired = retired.load(std::memory_order_relaxed);
+            while (!retired.compare_exchange_weak(entry->next_retired, entry, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        }
+        entry = next;
+    }
+
+    reclaiming.clear(std::memory_order_release);
+}
+
+concurrent_manager::concurrent_manager()
+{
+    int const epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (0 > epoll_fd)
+    {
+        throw std::runtime_error("failed to create epoll instance");
+    }
+
+    int const wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (0 > wake_fd)
+    {
+        ::close(epoll_fd);
+        throw std::runtime_error("failed to create eventfd");
+    }
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = wakeup_tag;
+    if (0 != epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event))
+    {
+        ::close(wake_fd);
+        ::close(epoll_fd);
+        throw std::runtime_error("epoll_ctl: failed to add eventfd");
+    }
+
+    d = new detail(epoll_fd, wake_fd);
+}
+
+concurrent_manager::~concurrent_manager()
+{
+    delete d;
+}
+
+void concurrent_manager::add(int sock, uint32_t events, socket_callback callback)
+{
+    slot * const entry_slot = d->find_slot(sock, true);
+    if (nullptr == entry_slot)
+    {
+        throw std::runtime_error("invalid socket");
+    }
+
+    remove(sock);
+
+    uint32_t generation = d->next_generation.fetch_add(1, std::memory_order_relaxed);
+    if (0 == generation)
+    {
+        // zero is reserved for the wakeup eventfd
+        generation = d->next_generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto * const entry = new registration_entry(sock, generation, events, std::move(callback));
+    registration_entry * expected = nullptr;
+    if (!entry_slot->compare_exchange_strong(expected, entry, std::memory_order_acq_rel))
+    {
+        delete entry;
+        throw std::runtime_error("socket added concurrently");
+    }
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events | EPOLLONESHOT;
+    event.data.u64 = make_tag(sock, generation);
+    if (0 != epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, sock, &event))
+    {
+        // not visible to dispatch yet, since no event refers to it
+        entry_slot->store(nullptr, std::memory_order_release);
+        d->retire(entry);
+        throw std::runtime_error("epoll_ctl: failed to add socket");
+    }
+}
+
+void concurrent_manager::remove(int sock)
+{
+    slot * const entry_slot = d->find_slot(sock, false);
+    registration_entry * const entry = (nullptr != entry_slot) ? entry_slot->exchange(nullptr, std::memory_order_acq_rel) : nullptr;
+    if (nullptr == entry)
+    {
+        return;
+    }
+
+    {
+        // after this, the running callback (if any) does not re-arm the socket
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        entry->removed = true;
+        epoll_ctl(d->epoll_fd, EPOLL_CTL_DEL, sock, nullptr);
+    }
+
+    d->retire(entry);
+    d->reclaim();
+}
+
+void concurrent_manager::notify_on_readable(int sock, bool enable)
+{
+    d->modify(sock, EPOLLIN, enable);
+}
+
+void concurrent_manager::notify_on_writable(int sock, bool enable)
+{
+    d->modify(sock, EPOLLOUT, enable);
+}
+
+void concurrent_manager::service(int timeout)
+{
+    epoll_event events[batch_size];
+    int const count = epoll_wait(d->epoll_fd, events, batch_size, timeout);
+
+    // waiting is outside of the critical section; stale events are
+    // detected by their generation
+    bool woken = false;
+    thread_record & record = *(d->acquire_record());
+    d->enter(record);
+    try
+    {
+        d->dispatch(events, count, woken);
+    }
+    catch (...)
+    {
+        d->leave(record);
+        if (woken)
+        {
+            d->pass_wakeup();
+        }
+        throw;
+    }
+    d->leave(record);
+
+    if (woken)
+    {
+        d->pass_wakeup();
+    }
+
+    d->reclaim();
+}
+
+void concurrent_manager::run()
+{
+    d->running.fetch_add(1, std::memory_order_acq_rel);
+    while (!d->stop_requested.load(std::memory_order_acquire))
+    {
+        service(-1);
+    }
+
+    // the last thread leaving resets the request
+    if (1 == d->running.fetch_sub(1, std::memory_order_acq_rel))
+    {
+        d->stop_requested.store(false, std::memory_order_release);
+    }
+}
+
+void concurrent_manager::stop()
+{
+    d->stop_requested.store(true, std::memory_order_release);
+
+    uint64_t const value = 1;
+    auto const count = ::write(d->wake_fd, &value, sizeof(value));
+    (void) count;
+}
+
+int concurrent_manager::native_handle() const
+{
+    return d->epoll_fd;
+}
+
+std::size_t concurrent_manager::pending_reclamation() const
+{
+    return d->retired_count.load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,109 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/context_pool.hpp"
+#include "sockman/numa.hpp"
+
+#include <sys/mman.h>
+
+#include <new>
+#include <utility>
+
+namespace sockman
+{
+
+namespace
+{
+
+constexpr std::size_t const chunk_size = context_pool::contexts_per_chunk * sizeof(socket_context);
+
+}
+
+constexpr std::size_t const context_pool::contexts_per_chunk;
+
+context_pool::context_pool()
+: free_list(nullptr)
+, numa_node(-1)
+{
+
+}
+
+context_pool::~context_pool()
+{
+    for(auto * chunk: chunks)
+    {
+        ::munmap(chunk, chunk_size);
+    }
+}
+
+context_ptr context_pool::create(int fd, uint32_t events, socket_callback callback)
+{
+    void * storage = allocate();
+    auto * context = new (storage) socket_context{fd, events, std::move(callback)};
+    return context_ptr(context, context_deleter{this});
+}
+
+void context_pool::destroy(socket_context * context)
+{
+    context->~socket_context();
+    deallocate(reinterpret_cast<void*>(context));
+}
+
+void context_pool::set_numa_node(int node)
+{
+    numa_node = node;
+}
+
+std::size_t context_pool::chunk_count() const
+{
+    return chunks.size();
+}
+
+void * context_pool::allocate()
+{
+    if (nullptr == free_list)
+    {
+        grow();
+    }
+
+    slot * result = free_list;
+    free_list = result->next;
+    return reinterpret_cast<void*>(result);
+}
+
+void context_pool::deallocate(void * storage)
+{
+    slot * entry = reinterpret_cast<slot*>(storage);
+    entry->next = free_list;
+    free_list = entry;
+}
+
+void context_pool::grow()
+{
+    static_assert(sizeof(slot) == sizeof(socket_context), "unexpected slot size");
+
+    chunks.reserve(chunks.size() + 1);
+    void * chunk = ::mmap(nullptr, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == chunk)
+    {
+        throw std::bad_alloc();
+    }
+
+    if (0 <= numa_node)
+    {
+        bind_to_numa_node(chunk, chunk_size, numa_node);
+    }
+    chunks.push_back(chunk);
+
+    slot * slots = reinterpret_cast<slot*>(chunk);
+    for (std::size_t i = contexts_per_chunk; i > 0; i--)
+    {
+        slots[i - 1].next = free_list;
+        free_list = &(slots[i - 1]);
+    }
+}
+
+}
@@ -0,0 +1,78 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_CONTEXT_POOL_HPP
+#define SOCKMAN_CONTEXT_POOL_HPP
+
+#include "sockman/socket_context.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace sockman
+{
+
+class context_pool;
+
+struct context_deleter
+{
+    context_pool * pool;
+
+    void operator()(socket_context * context) const;
+};
+
+using context_ptr = std::unique_ptr<socket_context, context_deleter>;
+
+/// Slab allocator for socket contexts.
+///
+/// Contexts are carved from page aligned chunks, which are bound to
+/// a preferred NUMA node if one is set. Released contexts are kept
+/// in a free list and reused by subsequent allocations.
+class context_pool
+{
+    context_pool(context_pool const &) = delete;
+    context_pool& operator=(context_pool const &) = delete;
+public:
+    static constexpr std::size_t const contexts_per_chunk = 256;
+
+    context_pool();
+    ~context_pool();
+
+    context_ptr create(int fd, uint32_t events, socket_callback callback);
+
+    void destroy(socket_context * context);
+
+    /// Sets the NUMA node used for chunks allocated from now on.
+    /// A negative value removes the preference.
+    void set_numa_node(int node);
+
+    std::size_t chunk_count() const;
+
+private:
+    union slot
+    {
+        slot * next;
+        alignas(socket_context) unsigned char storage[sizeof(socket_context)];
+    };
+
+    void * allocate();
+    void deallocate(void * storage);
+    void grow();
+
+    slot * free_list;
+    std::vector<void*> chunks;
+    int numa_node;
+};
+
+inline void context_deleter::operator()(socket_context * context) const
+{
+    pool->destroy(context);
+}
+
+}
+
+#endif
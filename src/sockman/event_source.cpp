@@ -0,0 +1,334 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/event_source.hpp"
+#include "sockman/timespec.hpp"
+
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+namespace sockman
+{
+
+namespace
+{
+
+int create_timerfd()
+{
+    int const fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (0 > fd)
+    {
+        throw std::runtime_error("failed to create timerfd");
+    }
+
+    return fd;
+}
+
+int create_eventfd()
+{
+    int const fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (0 > fd)
+    {
+        throw std::runtime_error("failed to create eventfd");
+    }
+
+    return fd;
+}
+
+int create_inotify()
+{
+    int const fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (0 > fd)
+    {
+        throw std::runtime_error("failed to create inotify instance");
+    }
+
+    return fd;
+}
+
+int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    int const fd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+    // kernel headers older than 5.3 do not know pidfd_open
+    (void) pid;
+    errno = ENOSYS;
+    int const fd = -1;
+#endif
+    if (0 > fd)
+    {
+        throw std::system_error(errno, std::generic_category(), "failed to open pidfd");
+    }
+
+    return fd;
+}
+
+}
+
+event_source::event_source(manager & manager, int fd_)
+: manager_(manager)
+, fd(fd_)
+{
+    try
+    {
+        manager_.add(fd, readable, [this](int, socket_events) {
+            on_readable();
+        });
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+}
+
+event_source::~event_source()
+{
+    manager_.remove(fd);
+    ::close(fd);
+}
+
+int event_source::native_handle() const
+{
+    return fd;
+}
+
+void event_source::detach()
+{
+    manager_.remove(fd);
+}
+
+timer_source::timer_source(manager & manager, timer_callback callback)
+: event_source(manager, create_timerfd())
+, callback_(std::move(callback))
+{
+
+}
+
+void timer_source::start(std::chrono::nanoseconds timeout, std::chrono::nanoseconds interval)
+{
+    if ((std::chrono::nanoseconds::zero() > timeout) || (std::chrono::nanoseconds::zero() > interval))
+    {
+        throw std::runtime_error("invalid timeout");
+    }
+
+    itimerspec value;
+    value.it_value = to_timespec(timeout);
+    value.it_interval = to_timespec(interval);
+
+    // a zero it_value disarms the timer, so expire as soon as possible
+    if ((0 == value.it_value.tv_sec) && (0 >= value.it_value.tv_nsec))
+    {
+        value.it_value.tv_sec = 0;
+        value.it_value.tv_nsec = 1;
+    }
+
+    if (0 != timerfd_settime(fd, 0, &value, nullptr))
+    {
+        throw std::runtime_error("failed to start timer");
+    }
+}
+
+void timer_source::start_at(std::chrono::steady_clock::time_point deadline, std::chrono::nanoseconds interval)
+{
+    if (std::chrono::nanoseconds::zero() > interval)
+    {
+        throw std::runtime_error("invalid interval");
+    }
+
+    itimerspec value;
+    value.it_value = to_timespec(deadline.time_since_epoch());
+    value.it_interval = to_timespec(interval);
+
+    if ((0 == value.it_value.tv_sec) && (0 >= value.it_value.tv_nsec))
+    {
+        value.it_value.tv_nsec = 1;
+    }
+
+    if (0 != timerfd_settime(fd, TFD_TIMER_ABSTIME, &value, nullptr))
+    {
+        throw std::runtime_error("failed to start timer");
+    }
+}
+
+void timer_source::stop()
+{
+    itimerspec value;
+    memset(&value, 0, sizeof(value));
+    timerfd_settime(fd, 0, &value, nullptr);
+}
+
+void timer_source::on_readable()
+{
+    uint64_t expirations = 0;
+    auto const count = ::read(fd, &expirations, sizeof(expirations));
+    if ((sizeof(expirations) == count) && (0 < expirations))
+    {
+        callback_(expirations);
+    }
+}
+
+eventfd_source::eventfd_source(manager & manager, eventfd_callback callback)
+: event_source(manager, create_eventfd())
+, callback_(std::move(callback))
+{
+
+}
+
+void eventfd_source::notify(uint64_t value)
+{
+    auto const count = ::write(fd, &value, sizeof(value));
+    (void) count;
+}
+
+void eventfd_source::on_readable()
+{
+    uint64_t value = 0;
+    auto const count = ::read(fd, &value, sizeof(value));
+    if (sizeof(value) == count)
+    {
+        callback_(value);
+    }
+}
+
+signal_source::signal_source(manager & manager, std::vector<int> const & signals, signal_callback callback)
+: manager_(manager)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int signal_number: signals)
+    {
+        if (0 != sigaddset(&mask, signal_number))
+        {
+            throw std::runtime_error("invalid signal number");
+        }
+    }
+
+    signals_.reserve(signals.size());
+    try
+    {
+        for (int signal_number: signals)
+        {
+            manager_.on_signal(signal_number, callback);
+            signals_.push_back(signal_number);
+        }
+    }
+    catch (...)
+    {
+        for (int signal_number: signals_)
+        {
+            manager_.remove_signal(signal_number);
+        }
+        throw;
+    }
+}
+
+signal_source::~signal_source()
+{
+    for (int signal_number: signals_)
+    {
+        manager_.remove_signal(signal_number);
+    }
+}
+
+inotify_source::inotify_source(manager & manager, inotify_callback callback)
+: event_source(manager, create_inotify())
+, callback_(std::move(callback))
+{
+
+}
+
+int inotify_source::add_watch(std::string const & path, uint32_t mask)
+{
+    int const wd = inotify_add_watch(fd, path.c_str(), mask);
+    if (0 > wd)
+    {
+        throw std::runtime_error("failed to add watch");
+    }
+
+    return wd;
+}
+
+void inotify_source::remove_watch(int wd)
+{
+    inotify_rm_watch(fd, wd);
+}
+
+void inotify_source::on_readable()
+{
+    alignas(inotify_event) char buffer[4096];
+
+    records.clear();
+    ssize_t count = ::read(fd, buffer, sizeof(buffer));
+    while (0 < count)
+    {
+        ssize_t offset = 0;
+        while (offset < count)
+        {
+            auto const * event = reinterpret_cast<inotify_event const *>(&buffer[offset]);
+
+            inotify_record record;
+            record.wd = event->wd;
+            record.mask = event->mask;
+            record.cookie = event->cookie;
+            if (0 < event->len)
+            {
+                record.name = event->name;
+            }
+            records.push_back(std::move(record));
+
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+
+        count = ::read(fd, buffer, sizeof(buffer));
+    }
+
+    if (!records.empty())
+    {
+        callback_(records);
+    }
+}
+
+process_source::process_source(manager & manager, pid_t pid, process_callback callback)
+: event_source(manager, open_pidfd(pid))
+, pid_(pid)
+, callback_(std::move(callback))
+{
+
+}
+
+void process_source::on_readable()
+{
+    // the pidfd stays readable after the process terminated
+    detach();
+
+    siginfo_t info;
+    memset(&info, 0, sizeof(info));
+    int const rc = waitid(static_cast<idtype_t>(P_PIDFD), static_cast<id_t>(fd), &info, WEXITED | WNOHANG);
+    if ((0 != rc) || (0 == info.si_pid))
+    {
+        memset(&info, 0, sizeof(info));
+        info.si_pid = pid_;
+    }
+
+    callback_(info);
+}
+
+}
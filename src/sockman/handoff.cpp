@@ -0,0 +1,280 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/handoff.hpp"
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace sockman
+{
+
+namespace
+{
+
+constexpr uint32_t const handoff_magic = 0x534b4d48; // "SKMH"
+constexpr uint32_t const flag_track_inactivity = 1;
+
+// Each batch is a header carrying the descriptors as ancillary data,
+// followed by one record per socket and the pending output of all
+// sockets. A batch without sockets marks the end of the transfer.
+struct batch_header
+{
+    uint32_t magic;
+    uint32_t count;
+    uint64_t payload_size;
+};
+
+struct socket_record
+{
+    uint32_t events;
+    uint32_t flags;
+    uint64_t output_size;
+};
+
+void write_all(int channel, char const * data, std::size_t length)
+{
+    while (0 < length)
+    {
+        ssize_t const count = ::send(channel, data, length, MSG_NOSIGNAL);
+        if (0 > count)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            throw std::runtime_error("failed to send sockets");
+        }
+
+        data += count;
+        length -= static_cast<std::size_t>(count);
+    }
+}
+
+void read_all(int channel, char * data, std::size_t length)
+{
+    while (0 < length)
+    {
+        ssize_t const count = ::recv(channel, data, length, 0);
+        if (0 >= count)
+        {
+            if ((0 > count) && (EINTR == errno))
+            {
+                continue;
+            }
+            throw std::runtime_error("failed to receive sockets");
+        }
+
+        data += count;
+        length -= static_cast<std::size_t>(count);
+    }
+}
+
+void close_all(std::vector<int> const & fds)
+{
+    for (int fd: fds)
+    {
+        ::close(fd);
+    }
+}
+
+void send_batch(int channel, socket_state const * sockets, std::size_t count)
+{
+    std::string payload;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        socket_record const record = {
+            sockets[i].events,
+            sockets[i].track_inactivity ? flag_track_inactivity : 0,
+            sockets[i].pending_output.size()};
+        payload.append(reinterpret_cast<char const *>(&record), sizeof(record));
+    }
+    for (std::size_t i = 0; i < count; i++)
+    {
+        payload.append(sockets[i].pending_output);
+    }
+
+    if (handoff_max_payload_size < payload.size())
+    {
+        throw std::runtime_error("pending output too large");
+    }
+
+    batch_header header = {handoff_magic, static_cast<uint32_t>(count), payload.size()};
+    iovec iov;
+    iov.iov_base = reinterpret_cast<void*>(&header);
+    iov.iov_len = sizeof(header);
+
+    char control[CMSG_SPACE(handoff_batch_size * sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+
+    if (0 < count)
+    {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(count * sizeof(int));
+
+        cmsghdr * cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+
+        int * fds = reinterpret_cast<int *>(CMSG_DATA(cmsg));
+        for (std::size_t i = 0; i < count; i++)
+        {
+            fds[i] = sockets[i].sock;
+        }
+    }
+
+    ssize_t rc;
+    do
+    {
+        rc = ::sendmsg(channel, &message, MSG_NOSIGNAL);
+    }
+    while ((0 > rc) && (EINTR == errno));
+
+    if (static_cast<ssize_t>(sizeof(header)) != rc)
+    {
+        throw std::runtime_error("failed to send sockets");
+    }
+
+    write_all(channel, payload.data(), payload.size());
+}
+
+bool receive_batch(int channel, std::vector<socket_state> & sockets)
+{
+    batch_header header;
+    iovec iov;
+    iov.iov_base = reinterpret_cast<void*>(&header);
+    iov.iov_len = sizeof(header);
+
+    char control[CMSG_SPACE(handoff_batch_size * sizeof(int))];
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    // reserved before receiving, so collecting the descriptors cannot fail
+    std::vector<int> fds;
+    fds.reserve(handoff_batch_size);
+
+    ssize_t rc;
+    do
+    {
+        rc = ::recvmsg(channel, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+    }
+    while ((0 > rc) && (EINTR == errno));
+
+    for (cmsghdr * cmsg = CMSG_FIRSTHDR(&message); nullptr != cmsg; cmsg = CMSG_NXTHDR(&message, cmsg))
+    {
+        if ((SOL_SOCKET == cmsg->cmsg_level) && (SCM_RIGHTS == cmsg->cmsg_type))
+        {
+            std::size_t const received = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            int const * data = reinterpret_cast<int const *>(CMSG_DATA(cmsg));
+            fds.insert(fds.end(), data, data + received);
+        }
+    }
+
+    if ((static_cast<ssize_t>(sizeof(header)) != rc) || (handoff_magic != header.magic)
+        || (header.count != fds.size()) || (0 != (message.msg_flags & MSG_CTRUNC)))
+    {
+        close_all(fds);
+        throw std::runtime_error("failed to receive sockets");
+    }
+
+    if (0 == header.count)
+    {
+        return false;
+    }
+
+    // the received descriptors are closed on any failure, including bad_alloc
+    std::size_t const first = sockets.size();
+    try
+    {
+        if (handoff_max_payload_size < header.payload_size)
+        {
+            throw std::runtime_error("invalid socket state");
+        }
+
+        std::string payload(static_cast<std::size_t>(header.payload_size), '\0');
+        read_all(channel, &payload[0], payload.size());
+
+        std::size_t const records_size = header.count * sizeof(socket_record);
+        if (records_size > payload.size())
+        {
+            throw std::runtime_error("invalid socket state");
+        }
+
+        std::size_t offset = records_size;
+        for (std::size_t i = 0; i < header.count; i++)
+        {
+            socket_record record;
+            memcpy(&record, payload.data() + (i * sizeof(socket_record)), sizeof(record));
+            if (record.output_size > (payload.size() - offset))
+            {
+                throw std::runtime_error("invalid socket state");
+            }
+
+            sockets.push_back({fds[i], record.events, (0 != (record.flags & flag_track_inactivity)),
+                payload.substr(offset, record.output_size)});
+            offset += record.output_size;
+        }
+    }
+    catch (...)
+    {
+        sockets.resize(first);
+        close_all(fds);
+        throw;
+    }
+
+    return true;
+}
+
+}
+
+void send_sockets(int channel, std::vector<socket_state> const & sockets)
+{
+    for (std::size_t i = 0; i < sockets.size(); i += handoff_batch_size)
+    {
+        std::size_t const remaining = sockets.size() - i;
+        send_batch(channel, &sockets[i], (remaining < handoff_batch_size) ? remaining : handoff_batch_size);
+    }
+
+    send_batch(channel, nullptr, 0);
+}
+
+std::vector<socket_state> receive_sockets(int channel)
+{
+    std::vector<socket_state> sockets;
+    try
+    {
+        while (receive_batch(channel, sockets))
+        {
+        }
+    }
+    catch (...)
+    {
+        for (auto const & state: sockets)
+        {
+            ::close(state.sock);
+        }
+        throw;
+    }
+
+    return sockets;
+}
+
+}
@@ -0,0 +1,138 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/trace.hpp"
+
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+namespace sockman
+{
+
+namespace
+{
+
+constexpr uint64_t const sub_bucket_bits = 3;
+static_assert((1u << sub_bucket_bits) == latency_histogram::sub_buckets, "sub_buckets must be 2^sub_bucket_bits");
+
+}
+
+constexpr std::size_t const latency_histogram::sub_buckets;
+constexpr std::size_t const latency_histogram::bucket_count;
+
+latency_histogram::latency_histogram()
+{
+    reset();
+}
+
+void latency_histogram::record(uint64_t value)
+{
+    auto & bucket = counts[index_of(value)];
+    if (bucket < std::numeric_limits<uint32_t>::max())
+    {
+        bucket++;
+    }
+
+    if ((0 == count_) || (value < min_))
+    {
+        min_ = value;
+    }
+    if (value > max_)
+    {
+        max_ = value;
+    }
+    count_++;
+}
+
+void latency_histogram::reset()
+{
+    memset(counts, 0, sizeof(counts));
+    count_ = 0;
+    min_ = 0;
+    max_ = 0;
+}
+
+uint64_t latency_histogram::count() const
+{
+    return count_;
+}
+
+uint64_t latency_histogram::min() const
+{
+    return min_;
+}
+
+uint64_t latency_histogram::max() const
+{
+    return max_;
+}
+
+uint64_t latency_histogram::percentile(double percentile) const
+{
+    if (0 == count_)
+    {
+        return 0;
+    }
+
+    if (percentile < 0.0)
+    {
+        percentile = 0.0;
+    }
+    else if (percentile > 100.0)
+    {
+        percentile = 100.0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(std::ceil((percentile / 100.0) * static_cast<double>(count_)));
+    if (0 == target)
+    {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; i++)
+    {
+        seen += counts[i];
+        if (seen >= target)
+        {
+            uint64_t const value = upper_bound_of(i);
+            return (value < max_) ? value : max_;
+        }
+    }
+
+    return max_;
+}
+
+std::size_t latency_histogram::index_of(uint64_t value)
+{
+    if (value < sub_buckets)
+    {
+        return static_cast<std::size_t>(value);
+    }
+
+    uint64_t const msb = 63 - static_cast<uint64_t>(__builtin_clzll(value));
+    uint64_t const shift = msb - sub_bucket_bits;
+    uint64_t const sub = (value >> shift) - sub_buckets;
+
+    return static_cast<std::size_t>(((shift + 1) * sub_buckets) + sub);
+}
+
+uint64_t latency_histogram::upper_bound_of(std::size_t index)
+{
+    if (index < sub_buckets)
+    {
+        return static_cast<uint64_t>(index);
+    }
+
+    uint64_t const shift = (index / sub_buckets) - 1;
+    uint64_t const sub = index % sub_buckets;
+    uint64_t const lower = (sub_buckets + sub) << shift;
+
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+}
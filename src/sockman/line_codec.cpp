@@ -0,0 +1,118 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/line_codec.hpp"
+#include "sockman/newline_scan.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef SOCKMAN_HAS_X86_SCAN
+#include <immintrin.h>
+#endif
+
+namespace sockman
+{
+
+std::size_t find_newline_generic(char const * data, std::size_t length)
+{
+    void const * found = memchr(data, '\n', length);
+    return (nullptr != found) ? static_cast<std::size_t>(reinterpret_cast<char const *>(found) - data) : length;
+}
+
+#ifdef SOCKMAN_HAS_X86_SCAN
+
+__attribute__((target("sse2")))
+std::size_t find_newline_sse2(char const * data, std::size_t length)
+{
+    __m128i const newline = _mm_set1_epi8('\n');
+
+    std::size_t position = 0;
+    for (; (position + 16) <= length; position += 16)
+    {
+        __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&data[position]));
+        unsigned int const mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        if (0 != mask)
+        {
+            return position + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+    }
+
+    return position + find_newline_generic(&data[position], length - position);
+}
+
+__attribute__((target("avx2")))
+std::size_t find_newline_avx2(char const * data, std::size_t length)
+{
+    __m256i const newline = _mm256_set1_epi8('\n');
+
+    std::size_t position = 0;
+    for (; (position + 64) <= length; position += 64)
+    {
+        __m256i const low = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&data[position]));
+        __m256i const high = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&data[position + 32]));
+        uint64_t const low_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline)));
+        uint64_t const high_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)));
+        uint64_t const mask = low_mask | (high_mask << 32);
+        if (0 != mask)
+        {
+            return position + static_cast<std::size_t>(__builtin_ctzll(mask));
+        }
+    }
+
+    for (; (position + 32) <= length; position += 32)
+    {
+        __m256i const block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&data[position]));
+        unsigned int const mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+        if (0 != mask)
+        {
+            return position + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+    }
+
+    return position + find_newline_sse2(&data[position], length - position);
+}
+
+bool has_avx2()
+{
+    __builtin_cpu_init();
+    return (0 != __builtin_cpu_supports("avx2"));
+}
+
+#endif
+
+namespace
+{
+
+using find_newline_function = std::size_t (*)(char const * data, std::size_t length);
+
+find_newline_function select_find_newline()
+{
+#ifdef SOCKMAN_HAS_X86_SCAN
+    if (has_avx2())
+    {
+        return &find_newline_avx2;
+    }
+
+    __builtin_cpu_init();
+    if (0 != __builtin_cpu_supports("sse2"))
+    {
+        return &find_newline_sse2;
+    }
+#endif
+
+    return &find_newline_generic;
+}
+
+}
+
+std::size_t find_newline(char const * data, std::size_t length)
+{
+    static find_newline_function const impl = select_find_newline();
+    return impl(data, length);
+}
+
+}
@@ -5,19 +5,113 @@
  */
 
 #include "sockman/sockman.hpp"
+#include "sockman/basic_manager.hpp"
+#include "sockman/backend.hpp"
 #include "sockman/socket_context.hpp"
+#include "sockman/context_pool.hpp"
+#include "sockman/affinity.hpp"
+#include "sockman/tracer.hpp"
+#include "sockman/timer_queue.hpp"
+#include "sockman/activity_list.hpp"
+#include "sockman/socket_tuning.hpp"
+#include "sockman/rate_shaper.hpp"
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
 
+#include <cerrno>
 #include <cstring>
+#include <ctime>
 
+#include <algorithm>
+#include <limits>
+#include <iterator>
+#include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <exception>
 #include <stdexcept>
 
 namespace sockman
 {
 
+namespace
+{
+
+constexpr int const batch_size = 64;
+
+}
+
+// Functions posted from other threads; shared with pending work, so
+// it outlives the manager.
+struct mailbox
+{
+    explicit mailbox(int fd)
+    : wake_fd(fd)
+    , pending(false)
+    , closed(false)
+    {
+    }
+
+    void post(std::function<void()> function)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!closed)
+        {
+            posted.push_back(std::move(function));
+            pending = true;
+
+            uint64_t const value = 1;
+            auto const count = ::write(wake_fd, &value, sizeof(value));
+            (void) count;
+        }
+    }
+
+    // puts functions, that were not run, in front of later posts
+    void requeue(std::vector<std::function<void()>> & functions, std::size_t first)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if ((!closed) && (first < functions.size()))
+        {
+            posted.insert(posted.begin(), std::make_move_iterator(functions.begin() + first),
+                std::make_move_iterator(functions.end()));
+            pending = true;
+
+            uint64_t const value = 1;
+            auto const count = ::write(wake_fd, &value, sizeof(value));
+            (void) count;
+        }
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        posted.clear();
+    }
+
+    std::mutex mutex;
+    std::vector<std::function<void()>> posted;
+    int wake_fd;
+    std::atomic<bool> pending;
+    bool closed;
+};
+
+struct listener_state
+{
+    listener_options options;
+    accept_callback callback;
+    double tokens;
+    std::chrono::steady_clock::time_point refilled;
+    timer_queue::timer_id resume_timer;
+    bool paused;
+};
+
 class manager::detail
 {
     detail(detail const &) = delete;
@@ -25,31 +119,178 @@ class manager::detail
     detail(detail &&) = delete;
     detail& operator=(detail &&) = delete;
 public:
-    detail(int epfd)
-    : fd(epfd)
+    /// Callback of the core; internal contexts have no owner.
+    ///
+    /// Contexts with an owner belong to the registration in the core, so
+    /// the core is the only index of managed sockets.
+    struct context_callback
+    {
+        detail * owner = nullptr;
+        socket_context * context = nullptr;
+
+        void operator()(int fd, socket_events events) const;
+    };
+
+    struct core_policy
     {
+        using backend_type = dynamic_backend;
+        using storage_type = growable_storage;
+        using callback_type = context_callback;
+        using threading = single_thread;
+        using instrumentation_type = no_instrumentation;
+    };
+
+    using core_type = basic_manager<core_policy>;
+
+    explicit detail(std::unique_ptr<backend> events_backend)
+    : core(std::move(events_backend))
+    , mail(std::make_shared<mailbox>(core.wakeup_handle()))
+    , signal_fd(-1)
+    , dispatch_depth(0)
+    , cork_depth(0)
+    , batch(0)
+    , socket_count(0)
+    , track_activity(false)
+    , alarm_deadline(std::chrono::steady_clock::time_point::max())
+    , inactivity_timeout(std::chrono::nanoseconds::zero())
+    , sweep_timer(0)
+    , next_rate_group(1)
+    {
+        sigemptyset(&signal_mask);
     }
 
     ~detail()
     {
-        ::close(fd);
+        core.for_each([this](int, context_callback & callback) {
+            if (nullptr != callback.owner)
+            {
+                contexts.destroy(callback.context);
+            }
+        });
+
+        if (0 <= signal_fd)
+        {
+            ::close(signal_fd);
+        }
+        mail->close();
     }
 
     void modify(int sock, uint32_t mask, bool enable);
+    socket_context * find_context(int sock);
+    socket_context & context_of(int sock);
+    void add_context(context_ptr & context);
+    void remove_context(int sock);
+    void discard_context(context_ptr context);
+    void add_internal(socket_context * context);
+    void dispatch(epoll_event const * events, int count);
+    void dispatch_event(socket_context & context, uint32_t events);
+    void dispatch_traced(socket_context & context, uint32_t events);
+    void end_dispatch();
+    uint32_t filter_output(socket_context & context, uint32_t events);
+    void send(int sock, void const * data, std::size_t length);
+    void send(int sock, buffer const & data);
+    void schedule_write(socket_context & context, bool blocked);
+    void flush(socket_context & context);
+    void write_pending(socket_context & context);
+    void flush_dirty();
+    void update_interest(socket_context & context);
+    void release(context_ptr context);
+    void deliver(socket_context & context, uint32_t received);
+    void dispatch_ready();
+    std::chrono::steady_clock::time_point effective(std::chrono::steady_clock::time_point deadline) const;
+    void run_posted();
+    void complete_offload(int sock, std::shared_ptr<offload_job> const & job, std::function<void()> completion);
+    void run_completions(int sock);
+    void drain_signals();
+    void run_until(std::chrono::steady_clock::time_point deadline);
+    void service(int timeout, std::size_t max_events);
+    int wait(epoll_event * events, int max_events, int timeout);
+    int wait(epoll_event * events, int max_events, std::chrono::nanoseconds timeout);
+    int wait_until(epoll_event * events, int max_events, std::chrono::steady_clock::time_point deadline);
+    timer_queue::timer_id schedule(std::chrono::steady_clock::time_point deadline, std::function<void()> callback);
+    void cancel(timer_queue::timer_id id);
+    void arm_alarm();
+    void expire_timers();
+    void accept_clients(int sock);
+    bool take_token(listener_state & listener, std::chrono::steady_clock::time_point now);
+    void pause_listener(int sock, listener_state & listener, std::chrono::steady_clock::time_point resume_at);
+    void resume_listener(int sock);
+    void resume_listeners();
+    void schedule_sweep();
+    void sweep_inactive();
+    void join_shaper(socket_context & context, std::shared_ptr<rate_shaper> shaper);
+    void leave_shaper(socket_context & context);
+    void take_receive(std::shared_ptr<rate_shaper> const & shaper, token_bucket & bucket, std::size_t count);
+    void take_send(socket_context & context, std::size_t count);
+    std::size_t send_budget(socket_context & context);
+    void throttle(rate_shaper & shaper, std::shared_ptr<rate_shaper> const & handle);
+    void resume_throttled(std::chrono::steady_clock::time_point slot);
+    void resume_ready(socket_context & context);
+    void track_output(socket_context & context, bool kernel_full);
+    socket_statistics snapshot(socket_context const & context, std::chrono::steady_clock::time_point now) const;
 
-    int fd;
-    std::unordered_map<int, std::unique_ptr<sockman::socket_context>> sockets;
+    core_type core;
+    std::shared_ptr<mailbox> mail;
+    int signal_fd;
+    unsigned int dispatch_depth;
+    unsigned int cork_depth;
+    uint64_t batch;
+    std::size_t socket_count;
+    bool track_activity;
+    sigset_t signal_mask;
+    buffer_pool buffers;
+    context_pool contexts;
+    std::vector<context_ptr> graveyard;
+    std::vector<int> dirty;
+    std::vector<int> dirty_batch;
+    std::vector<int> ready;
+    std::vector<int> ready_batch;
+    std::unique_ptr<socket_context> signal_context;
+    std::unique_ptr<socket_context> alarm_context;
+    timer_queue timers;
+    std::chrono::steady_clock::time_point alarm_deadline;
+    std::unordered_map<int, std::unique_ptr<listener_state>> listeners;
+    activity_list activity;
+    std::chrono::steady_clock::time_point loop_time;
+    std::chrono::nanoseconds inactivity_timeout;
+    inactivity_callback on_inactive;
+    timer_queue::timer_id sweep_timer;
+    std::unordered_map<int, signal_callback> signal_handlers;
+    std::vector<idle_callback> idle_handlers;
+    std::unique_ptr<tracer> tracing;
+    std::unordered_map<rate_group, std::shared_ptr<rate_shaper>> rate_groups;
+    rate_group next_rate_group;
+    std::map<std::chrono::steady_clock::time_point, std::vector<std::weak_ptr<rate_shaper>>> throttled;
 };
 
 manager::manager()
+: manager(std::unique_ptr<backend>(new epoll_backend()))
 {
-    int fd = epoll_create1(0);
-    if (0 > fd)
+
+}
+
+manager::manager(std::unique_ptr<backend> events_backend)
+{
+    if (nullptr == events_backend)
     {
-        throw std::runtime_error("failed to create epoll socket");
+        throw std::runtime_error("invalid backend");
     }
 
-    d = new detail(fd);
+    d = new detail(std::move(events_backend));
+
+    try
+    {
+        detail * const self = d;
+        d->alarm_context.reset(new socket_context(-1, EPOLLIN, [self](int, socket_events) {
+            self->expire_timers();
+        }));
+        d->core.on_alarm({nullptr, d->alarm_context.get()});
+    }
+    catch (...)
+    {
+        delete d;
+        throw;
+    }
 }
 
 manager::~manager()
@@ -80,31 +321,265 @@ manager& manager::operator=(manager && other)
 
 void manager::add(int sock, uint32_t events, socket_callback callback)
 {
-    remove(sock);
+    d->remove_context(sock);
+
+    auto context = d->contexts.create(sock, events, std::move(callback));
+    d->add_context(context);
+}
+
+void manager::add(int sock, uint32_t events, handler_dispatcher dispatcher, void * handler)
+{
+    d->remove_context(sock);
+
+    auto context = d->contexts.create(sock, events, nullptr);
+    context->dispatcher = dispatcher;
+    context->handler = handler;
+    d->add_context(context);
+}
+
+void manager::add_many(std::vector<registration> registrations)
+{
+    std::unordered_set<int> batch;
+    batch.reserve(registrations.size());
+    for (auto const & entry: registrations)
+    {
+        if (!batch.insert(entry.sock).second)
+        {
+            throw std::runtime_error("duplicate socket");
+        }
+    }
+
+    // All or nothing: new sockets are added first; managed sockets are
+    // switched to their new context in place, so the old context can
+    // be restored if a later registration fails.
+    std::vector<int> added;
+    std::vector<context_ptr> replaced;
+    added.reserve(registrations.size());
+    try
+    {
+        for (auto & entry: registrations)
+        {
+            auto context = d->contexts.create(entry.sock, entry.events, std::move(entry.callback));
+            socket_context * const old = d->find_context(entry.sock);
+            if (nullptr == old)
+            {
+                d->add_context(context);
+                added.push_back(entry.sock);
+            }
+            else
+            {
+                d->core.add(entry.sock, entry.events, {d, context.get()});
+                context->armed = entry.events;
+                replaced.emplace_back(old, context_deleter{&(d->contexts)});
+                context.release();
+            }
+        }
+    }
+    catch (...)
+    {
+        for (auto & old: replaced)
+        {
+            int const sock = old->fd;
+            socket_context * const current = d->find_context(sock);
+            d->core.add(sock, old->armed, {d, old.get()});
+            old.release();
+            d->release(context_ptr(current, context_deleter{&(d->contexts)}));
+        }
+        for (int sock: added)
+        {
+            d->remove_context(sock);
+        }
+        throw;
+    }
+
+    for (auto & old: replaced)
+    {
+        d->discard_context(std::move(old));
+    }
+}
+
+void manager::connect(int sock, sockaddr const * address, socklen_t length, connect_callback callback)
+{
+    int const flags = fcntl(sock, F_GETFL);
+    if (0 > flags)
+    {
+        throw std::runtime_error("invalid socket");
+    }
+
+    if ((0 == (flags & O_NONBLOCK)) && (0 != fcntl(sock, F_SETFL, flags | O_NONBLOCK)))
+    {
+        throw std::runtime_error("invalid socket");
+    }
+
+    int error = 0;
+    int const rc = ::connect(sock, address, length);
+    if ((0 != rc) && (EINPROGRESS != errno))
+    {
+        // reported asynchronously to provide a uniform interface
+        error = errno;
+    }
+
+    detail * const self = d;
+    auto const on_connected = [self, flags, error, callback](int fd, socket_events) {
+        int result = error;
+        if (0 == result)
+        {
+            socklen_t result_length = sizeof(result);
+            if (0 != getsockopt(fd, SOL_SOCKET, SO_ERROR, &result, &result_length))
+            {
+                result = errno;
+            }
+        }
+
+        self->remove_context(fd);
+        fcntl(fd, F_SETFL, flags);
+        callback(fd, result);
+    };
 
-    auto context = std::unique_ptr<socket_context>(new socket_context({sock, events, callback}));
+    try
+    {
+        add(sock, writable, on_connected);
+    }
+    catch (...)
+    {
+        fcntl(sock, F_SETFL, flags);
+        throw;
+    }
+}
 
-    epoll_event event;
-    memset(&event, 0, sizeof(event));
-    event.data.ptr = reinterpret_cast<void*>(context.get());
-    event.events = events;
+void manager::add_listener(int sock, listener_options const & options, accept_callback callback)
+{
+    apply_inherited_options(sock, options.socket);
 
-    int const rc = epoll_ctl(d->fd, EPOLL_CTL_ADD, sock, &event);
-    if (0 != rc)
+    int const flags = fcntl(sock, F_GETFL);
+    if ((0 > flags) || (0 != fcntl(sock, F_SETFL, flags | O_NONBLOCK)))
     {
-        throw std::runtime_error("epoll_ctl: failed to add socket");
+        throw std::runtime_error("failed to add listener");
     }
 
-    d->sockets.insert({sock, std::move(context)});
+    std::unique_ptr<listener_state> listener(new listener_state{options, std::move(callback),
+        static_cast<double>(options.accept_burst), d->core.now(), 0, false});
+
+    detail * const self = d;
+    add(sock, readable, [self](int fd, socket_events) {
+        self->accept_clients(fd);
+    });
+    d->listeners[sock] = std::move(listener);
 }
 
 void manager::remove(int sock)
 {
-    auto it = d->sockets.find(sock);
-    if (it != d->sockets.end())
+    d->remove_context(sock);
+}
+
+socket_state manager::detach(int sock)
+{
+    auto & context = d->context_of(sock);
+    socket_state state{sock, context.events, context.activity_tracked, context.output.contents()};
+    context.output.clear();
+
+    d->remove_context(sock);
+    return state;
+}
+
+void manager::attach(socket_state const & state, socket_callback callback)
+{
+    add(state.sock, state.events, std::move(callback));
+    if (state.track_inactivity)
+    {
+        track_inactivity(state.sock);
+    }
+
+    if (!state.pending_output.empty())
+    {
+        send(state.sock, state.pending_output.data(), state.pending_output.size());
+    }
+}
+
+void manager::remove_many(std::vector<int> const & socks)
+{
+    if (0 < d->dispatch_depth)
+    {
+        d->graveyard.reserve(d->graveyard.size() + socks.size());
+    }
+
+    for (int sock: socks)
+    {
+        d->remove_context(sock);
+    }
+}
+
+ssize_t manager::read(int sock, void * buffer, std::size_t length)
+{
+    ssize_t const rc = ::read(sock, buffer, length);
+    socket_context * const managed = d->find_context(sock);
+    if (nullptr == managed)
+    {
+        return rc;
+    }
+
+    auto & context = *managed;
+    context.stats.reads++;
+    if (0 < rc)
+    {
+        context.stats.bytes_received += static_cast<uint64_t>(rc);
+        if (nullptr != context.shaper)
+        {
+            d->take_receive(context.shaper, context.shaper->receive_bytes, static_cast<std::size_t>(rc));
+        }
+    }
+    else if ((0 == rc) || (EINTR != errno))
+    {
+        context.drained = true;
+        if ((0 > rc) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+        {
+            context.stats.would_block++;
+        }
+    }
+
+    return rc;
+}
+
+void manager::send(int sock, void const * data, std::size_t length)
+{
+    d->send(sock, data, length);
+}
+
+void manager::send(int sock, buffer const & data)
+{
+    d->send(sock, data);
+}
+
+void manager::flush(int sock)
+{
+    d->flush(d->context_of(sock));
+}
+
+buffer_pool & manager::buffers()
+{
+    return d->buffers;
+}
+
+std::size_t manager::pending_output(int sock) const
+{
+    socket_context * const context = d->find_context(sock);
+    return (nullptr != context) ? context->output.size() : 0;
+}
+
+void manager::cork()
+{
+    d->cork_depth++;
+}
+
+void manager::uncork()
+{
+    if (0 < d->cork_depth)
     {
-        epoll_ctl(d->fd, EPOLL_CTL_DEL, sock, nullptr);
-        d->sockets.erase(it);
+        d->cork_depth--;
+        if (0 == d->cork_depth)
+        {
+            d->flush_dirty();
+        }
     }
 }
 
@@ -120,46 +595,1386 @@ void manager::notify_on_writable(int sock, bool enable)
 
 void manager::service(int timeout)
 {
-    epoll_event event;
-    int const rc = epoll_wait(d->fd, &event, 1, timeout);
-    if (1 == rc)
+    epoll_event events[batch_size];
+    int const rc = d->wait(events, batch_size, timeout);
+    d->dispatch(events, rc);
+}
+
+void manager::service(int timeout, std::size_t max_events)
+{
+    d->service(timeout, max_events);
+}
+
+void manager::service(std::chrono::nanoseconds timeout)
+{
+    epoll_event events[batch_size];
+    int const rc = d->wait(events, batch_size, timeout);
+    d->dispatch(events, rc);
+}
+
+void manager::service_until(std::chrono::steady_clock::time_point deadline)
+{
+    epoll_event events[batch_size];
+    int const rc = d->wait_until(events, batch_size, deadline);
+    d->dispatch(events, rc);
+}
+
+void manager::set_inactivity_timeout(std::chrono::nanoseconds timeout, inactivity_callback callback)
+{
+    d->cancel(d->sweep_timer);
+    d->sweep_timer = 0;
+    d->inactivity_timeout = timeout;
+    d->on_inactive = std::move(callback);
+    d->schedule_sweep();
+}
+
+void manager::track_inactivity(int sock, bool enable)
+{
+    auto & context = d->context_of(sock);
+    if (enable)
     {
-        auto * const context = reinterpret_cast<socket_context*>(event.data.ptr);
-        context->callback(context->fd, socket_events(event.events));
+        d->activity.touch(context, d->core.now());
+    }
+    else
+    {
+        d->activity.unlink(context);
     }
 }
 
-void manager::detail::modify(int sock, uint32_t mask, bool enable)
+void manager::set_rate_limit(int sock, shaping_options const & options)
+{
+    auto & context = d->context_of(sock);
+    std::shared_ptr<rate_shaper> shaper = std::make_shared<rate_shaper>();
+    shaper->configure(options, d->core.now());
+    d->join_shaper(context, std::move(shaper));
+}
+
+void manager::clear_rate_limit(int sock)
+{
+    d->leave_shaper(d->context_of(sock));
+}
+
+rate_group manager::add_rate_group(shaping_options const & options)
+{
+    std::shared_ptr<rate_shaper> shaper = std::make_shared<rate_shaper>();
+    shaper->configure(options, d->core.now());
+
+    rate_group const group = d->next_rate_group++;
+    d->rate_groups[group] = std::move(shaper);
+    return group;
+}
+
+void manager::join_rate_group(int sock, rate_group group)
+{
+    auto & context = d->context_of(sock);
+    auto it = d->rate_groups.find(group);
+    if (it == d->rate_groups.end())
+    {
+        throw std::runtime_error("rate group not found");
+    }
+
+    d->join_shaper(context, it->second);
+}
+
+void manager::remove_rate_group(rate_group group)
 {
-    auto it = sockets.find(sock);
-    if (it != sockets.end())
+    auto it = d->rate_groups.find(group);
+    if (it != d->rate_groups.end())
     {
-        epoll_event event;
-        memset(&event, 0, sizeof(event));
-        event.data.ptr = reinterpret_cast<void*>(it->second.get());
-        if (enable)
+        auto shaper = std::move(it->second);
+        d->rate_groups.erase(it);
+
+        std::vector<int> const members(shaper->members.begin(), shaper->members.end());
+        for (int sock: members)
         {
-            event.events = it->second->events | mask;
+            d->leave_shaper(d->context_of(sock));
         }
-        else
+    }
+}
+
+int manager::native_handle() const
+{
+    return d->core.native_handle();
+}
+
+void manager::add(manager & child, std::size_t budget)
+{
+    if ((this == &child) || (nullptr == child.d) || (0 > child.native_handle()))
+    {
+        throw std::runtime_error("invalid child manager");
+    }
+
+    if (0 == budget)
+    {
+        // the child would stay readable without being serviced
+        throw std::runtime_error("invalid budget");
+    }
+
+    detail * const child_detail = child.d;
+    add(child.native_handle(), readable, [child_detail, budget](int, socket_events) {
+        child_detail->service(0, budget);
+    });
+}
+
+void manager::run()
+{
+    d->run_until(std::chrono::steady_clock::time_point::max());
+}
+
+void manager::run_for(std::chrono::nanoseconds duration)
+{
+    d->run_until(d->core.now() + duration);
+}
+
+void manager::run_until(std::chrono::steady_clock::time_point deadline)
+{
+    d->run_until(deadline);
+}
+
+void manager::stop()
+{
+    d->core.stop();
+}
+
+void manager::post(std::function<void()> function)
+{
+    d->mail->post(std::move(function));
+}
+
+std::chrono::steady_clock::time_point manager::now() const
+{
+    return d->core.now();
+}
+
+timer_id manager::schedule(std::chrono::steady_clock::time_point deadline, std::function<void()> function)
+{
+    return d->schedule(deadline, std::move(function));
+}
+
+void manager::cancel(timer_id id)
+{
+    d->cancel(id);
+}
+
+void manager::submit_offload(worker_pool & pool, int sock, std::function<std::function<void()>()> work)
+{
+    auto & context = d->context_of(sock);
+    auto job = std::make_shared<offload_job>();
+    context.offloads.push_back(job);
+    d->update_interest(context);
+
+    detail * const self = d;
+    std::shared_ptr<mailbox> mail = d->mail;
+    pool.submit([self, mail, sock, job, work]() {
+        std::function<void()> completion;
+        try
         {
-            event.events = it->second->events & (~mask);
+            completion = work();
         }
-
-        if (event.events != it->second->events)
+        catch (...)
         {
-            it->second->events = event.events;
-            int const rc = epoll_ctl(fd, EPOLL_CTL_MOD, sock, &event);
-            if (0 != rc)
-            {
-                throw std::runtime_error("epoll_ctl: failed to modify socket");
-            }
+            auto const error = std::current_exception();
+            completion = [error]() {
+                std::rethrow_exception(error);
+            };
         }
+
+        // only run while the manager is alive, so self is valid
+        mail->post([self, sock, job, completion]() {
+            self->complete_offload(sock, job, completion);
+        });
+    });
+}
+
+std::size_t manager::pending_offloads(int sock) const
+{
+    socket_context * const context = d->find_context(sock);
+    return (nullptr != context) ? context->offloads.size() : 0;
+}
+
+void manager::on_signal(int signal_number, signal_callback callback)
+{
+    sigset_t mask = d->signal_mask;
+    if (0 != sigaddset(&mask, signal_number))
+    {
+        throw std::runtime_error("invalid signal number");
     }
-    else
+
+    int const sfd = signalfd(d->signal_fd, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (0 > sfd)
     {
-        throw std::runtime_error("socket not found");
+        throw std::runtime_error("failed to create signalfd");
     }
+
+    if (0 > d->signal_fd)
+    {
+        d->signal_fd = sfd;
+
+        detail * const self = d;
+        d->signal_context.reset(new socket_context(sfd, EPOLLIN, [self](int, socket_events) {
+            self->drain_signals();
+        }));
+        d->add_internal(d->signal_context.get());
+    }
+
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    d->signal_mask = mask;
+    d->signal_handlers[signal_number] = std::move(callback);
+}
+
+void manager::remove_signal(int signal_number)
+{
+    if (0 == d->signal_handlers.erase(signal_number))
+    {
+        return;
+    }
+
+    // the signal stays blocked, so it is left pending instead of
+    // being delivered with its default action
+    sigset_t mask = d->signal_mask;
+    sigdelset(&mask, signal_number);
+    if (0 <= signalfd(d->signal_fd, &mask, SFD_NONBLOCK | SFD_CLOEXEC))
+    {
+        d->signal_mask = mask;
+    }
+}
+
+void manager::on_idle(idle_callback callback)
+{
+    d->idle_handlers.push_back(std::move(callback));
+}
+
+void manager::set_cpu_affinity(int cpu)
+{
+    pin_thread_to_cpu(cpu);
+    int const node = numa_node_of_cpu(cpu);
+    d->contexts.set_numa_node(node);
+    d->buffers.set_numa_node(node);
+}
+
+void manager::enable_tracing(std::size_t ring_capacity, std::chrono::nanoseconds slow_threshold, trace_callback on_slow)
+{
+    d->tracing.reset(new tracer(ring_capacity, slow_threshold, on_slow));
+}
+
+void manager::disable_tracing()
+{
+    d->tracing.reset();
+    d->core.for_each([](int, detail::context_callback & callback) {
+        if (nullptr != callback.owner)
+        {
+            callback.context->latency.reset();
+        }
+    });
+}
+
+latency_histogram manager::callback_latency(int sock) const
+{
+    auto const & latency = d->context_of(sock).latency;
+    return (nullptr != latency) ? *latency : latency_histogram();
+}
+
+std::vector<trace_record> manager::dump_trace() const
+{
+    return (nullptr != d->tracing) ? d->tracing->dump() : std::vector<trace_record>();
+}
+
+socket_statistics manager::statistics(int sock) const
+{
+    return d->snapshot(d->context_of(sock), d->core.now());
+}
+
+void manager::statistics(std::vector<socket_statistics> & snapshot) const
+{
+    snapshot.clear();
+    snapshot.reserve(d->socket_count);
+
+    auto const now = d->core.now();
+    d->core.for_each([this, &snapshot, now](int, detail::context_callback & callback) {
+        if (nullptr != callback.owner)
+        {
+            snapshot.push_back(d->snapshot(*(callback.context), now));
+        }
+    });
+}
+
+socket_context * manager::detail::find_context(int sock)
+{
+    context_callback * const callback = core.find(sock);
+    return ((nullptr != callback) && (nullptr != callback->owner)) ? callback->context : nullptr;
+}
+
+socket_context & manager::detail::context_of(int sock)
+{
+    socket_context * const context = find_context(sock);
+    if (nullptr == context)
+    {
+        throw std::runtime_error("socket not found");
+    }
+
+    return *context;
+}
+
+void manager::detail::add_context(context_ptr & context)
+{
+    core.add(context->fd, context->events, {this, context.get()});
+    context->armed = context->events;
+    context.release();
+    socket_count++;
+}
+
+void manager::detail::remove_context(int sock)
+{
+    socket_context * const context = find_context(sock);
+    if (nullptr != context)
+    {
+        core.remove(sock);
+        socket_count--;
+        discard_context(context_ptr(context, context_deleter{&contexts}));
+    }
+}
+
+void manager::detail::discard_context(context_ptr context)
+{
+    int const sock = context->fd;
+    if (!context->output.empty())
+    {
+        // best effort, the socket is not watched for writable anymore
+        write_pending(*context);
+    }
+
+    activity.unlink(*context);
+    if (nullptr != context->shaper)
+    {
+        context->shaper->members.erase(sock);
+        context->shaper.reset();
+    }
+    for (auto & job: context->offloads)
+    {
+        job->cancelled = true;
+    }
+    release(std::move(context));
+
+    auto listener = listeners.find(sock);
+    if (listener != listeners.end())
+    {
+        cancel(listener->second->resume_timer);
+        listeners.erase(listener);
+    }
+
+    resume_listeners();
+}
+
+void manager::detail::add_internal(socket_context * context)
+{
+    core.add(context->fd, context->events, {nullptr, context});
+}
+
+void manager::detail::context_callback::operator()(int, socket_events events) const
+{
+    if (nullptr != owner)
+    {
+        owner->dispatch_event(*context, events);
+    }
+    else
+    {
+        context->invoke(events);
+    }
+}
+
+void manager::detail::dispatch(epoll_event const * events, int count)
+{
+    // Contexts removed by a callback are kept alive until the
+    // whole batch is dispatched, since the running callback may
+    // still refer to them. Output queued by callbacks is flushed
+    // once at the end of the batch.
+    dispatch_depth++;
+    cork_depth++;
+    batch++;
+    track_activity = (nullptr != activity.front());
+    if (track_activity)
+    {
+        // a single, coarse timestamp per batch
+        loop_time = core.now();
+    }
+
+    try
+    {
+        if (mail->pending)
+        {
+            run_posted();
+        }
+
+        if (!ready.empty())
+        {
+            dispatch_ready();
+        }
+
+        core.dispatch(events, count);
+    }
+    catch (...)
+    {
+        cork_depth--;
+        end_dispatch();
+        throw;
+    }
+
+    cork_depth--;
+    if (0 == cork_depth)
+    {
+        flush_dirty();
+    }
+    end_dispatch();
+}
+
+void manager::detail::dispatch_event(socket_context & context, uint32_t events)
+{
+    if (context.removed)
+    {
+        return;
+    }
+
+    if (!context.offloads.empty())
+    {
+        // disarmed one-shot while work is outstanding; the
+        // descriptor is disabled until it is rearmed
+        context.armed = 0;
+        if ((0 != (events & EPOLLOUT)) && (!context.output.empty()))
+        {
+            write_pending(context);
+            if (!context.output.empty())
+            {
+                update_interest(context);
+            }
+        }
+        return;
+    }
+
+    uint32_t received = filter_output(context, events);
+    if (context.ready_batch == batch)
+    {
+        // readable was already delivered from the ready list
+        received &= ~static_cast<uint32_t>(EPOLLIN);
+    }
+
+    if (0 == received)
+    {
+        return;
+    }
+
+    if ((track_activity) && (activity.contains(context)))
+    {
+        activity.touch(context, loop_time);
+    }
+
+    deliver(context, received);
+}
+
+void manager::detail::deliver(socket_context & context, uint32_t received)
+{
+    // kept alive, since the callback may remove the socket
+    std::shared_ptr<rate_shaper> shaper;
+    if ((nullptr != context.shaper) && (0 != (received & EPOLLIN)))
+    {
+        shaper = context.shaper;
+        if (shaper->receive_blocked)
+        {
+            // pending from a batch dispatched before the bucket ran dry
+            received &= ~static_cast<uint32_t>(EPOLLIN);
+            if (0 == received)
+            {
+                return;
+            }
+            shaper.reset();
+        }
+    }
+
+    bool const edge = (0 != (context.events & EPOLLET)) && (0 != (received & EPOLLIN));
+    if (edge)
+    {
+        // cleared by read on EAGAIN
+        context.drained = false;
+    }
+
+    if (nullptr == tracing)
+    {
+        context.invoke(received);
+    }
+    else
+    {
+        dispatch_traced(context, received);
+    }
+
+    if ((edge) && (!context.drained) && (!context.removed) && (!context.queued_ready))
+    {
+        context.queued_ready = true;
+        ready.push_back(context.fd);
+    }
+
+    if (nullptr != shaper)
+    {
+        take_receive(shaper, shaper->receive_events, 1);
+    }
+}
+
+void manager::detail::dispatch_ready()
+{
+    // sockets left over from the previous batch; sockets that are still
+    // not drained are queued again for the next batch
+    ready_batch.clear();
+    ready_batch.swap(ready);
+    for (int const sock: ready_batch)
+    {
+        socket_context * const managed = find_context(sock);
+        if (nullptr == managed)
+        {
+            continue;
+        }
+
+        auto & context = *managed;
+        context.queued_ready = false;
+        bool const armed = (0 != (context.events & EPOLLET)) && (0 != (context.events & EPOLLIN));
+        bool const blocked = (nullptr != context.shaper) && (context.shaper->receive_blocked);
+        if ((context.removed) || (context.drained) || (!armed) || (!context.offloads.empty()) || (blocked))
+        {
+            // blocked sockets are queued again when they are resumed
+            continue;
+        }
+
+        if (activity.contains(context))
+        {
+            activity.touch(context, loop_time);
+        }
+
+        context.ready_batch = batch;
+        deliver(context, EPOLLIN);
+    }
+}
+
+std::chrono::steady_clock::time_point manager::detail::effective(std::chrono::steady_clock::time_point deadline) const
+{
+    return ready.empty() ? deadline : std::chrono::steady_clock::time_point::min();
+}
+
+void manager::detail::end_dispatch()
+{
+    dispatch_depth--;
+    if (0 == dispatch_depth)
+    {
+        graveyard.clear();
+
+        // the ready list is invisible to pollers of the native handle,
+        // e.g. a parent manager, since the kernel reported the edge already
+        if (!ready.empty())
+        {
+            core.wakeup();
+        }
+    }
+}
+
+uint32_t manager::detail::filter_output(socket_context & context, uint32_t events)
+{
+    if ((0 != (events & EPOLLOUT)) && (!context.output.empty()))
+    {
+        flush(context);
+    }
+
+    // writable events armed only to flush pending output are not reported
+    if (0 == (context.events & EPOLLOUT))
+    {
+        events &= ~static_cast<uint32_t>(EPOLLOUT);
+    }
+
+    return events;
+}
+
+void manager::detail::send(int sock, void const * data, std::size_t length)
+{
+    auto & context = context_of(sock);
+    bool const blocked = (!context.output.empty()) && (0 != (context.armed & EPOLLOUT));
+    context.output.append(buffers, data, length);
+    if (context.output.size() > context.stats.peak_output)
+    {
+        context.stats.peak_output = context.output.size();
+    }
+    schedule_write(context, blocked);
+}
+
+void manager::detail::send(int sock, buffer const & data)
+{
+    auto & context = context_of(sock);
+    bool const blocked = (!context.output.empty()) && (0 != (context.armed & EPOLLOUT));
+    context.output.append(data);
+    if (context.output.size() > context.stats.peak_output)
+    {
+        context.stats.peak_output = context.output.size();
+    }
+    schedule_write(context, blocked);
+}
+
+void manager::detail::schedule_write(socket_context & context, bool blocked)
+{
+    if (blocked)
+    {
+        // flushed as soon as the socket becomes writable
+    }
+    else if (0 < cork_depth)
+    {
+        if (!context.dirty)
+        {
+            context.dirty = true;
+            dirty.push_back(context.fd);
+        }
+    }
+    else
+    {
+        flush(context);
+    }
+}
+
+void manager::detail::flush(socket_context & context)
+{
+    write_pending(context);
+    update_interest(context);
+}
+
+void manager::detail::write_pending(socket_context & context)
+{
+    constexpr int const max_iov = 64;
+    iovec iov[max_iov];
+
+    context.dirty = false;
+    bool kernel_full = false;
+    while (!context.output.empty())
+    {
+        std::size_t const budget = send_budget(context);
+        if (0 == budget)
+        {
+            // resumed when the send bucket is refilled
+            break;
+        }
+
+        int count = context.output.prepare(iov, max_iov);
+        std::size_t total = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (budget - total <= iov[i].iov_len)
+            {
+                iov[i].iov_len = budget - total;
+                count = i + 1;
+            }
+            total += iov[i].iov_len;
+        }
+
+        ssize_t rc;
+        if (context.is_socket)
+        {
+            msghdr message;
+            memset(&message, 0, sizeof(message));
+            message.msg_iov = iov;
+            message.msg_iovlen = static_cast<size_t>(count);
+            rc = ::sendmsg(context.fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if ((0 > rc) && (ENOTSOCK == errno))
+            {
+                context.is_socket = false;
+                continue;
+            }
+        }
+        else
+        {
+            rc = ::writev(context.fd, iov, count);
+        }
+
+        context.stats.writes++;
+        if (0 < rc)
+        {
+            context.output.consume(static_cast<std::size_t>(rc));
+            context.stats.bytes_sent += static_cast<uint64_t>(rc);
+            take_send(context, static_cast<std::size_t>(rc));
+            if (static_cast<std::size_t>(rc) < total)
+            {
+                kernel_full = true;
+                break;
+            }
+        }
+        else if ((0 > rc) && (EINTR == errno))
+        {
+            continue;
+        }
+        else if ((0 > rc) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+        {
+            context.stats.would_block++;
+            kernel_full = true;
+            break;
+        }
+        else
+        {
+            // the error is reported to the callback via error or hungup events
+            context.output.clear();
+        }
+    }
+
+    track_output(context, kernel_full);
+}
+
+void manager::detail::track_output(socket_context & context, bool kernel_full)
+{
+    // the clock is only read when the socket starts or stops being blocked
+    if (context.output.empty())
+    {
+        if (context.write_blocked)
+        {
+            context.stats.write_blocked += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                core.now() - context.blocked_since);
+            context.write_blocked = false;
+        }
+    }
+    else if ((kernel_full) && (!context.write_blocked))
+    {
+        context.blocked_since = core.now();
+        context.write_blocked = true;
+    }
+}
+
+socket_statistics manager::detail::snapshot(socket_context const & context, std::chrono::steady_clock::time_point now) const
+{
+    socket_statistics result = context.stats;
+    result.sock = context.fd;
+    if (context.write_blocked)
+    {
+        result.write_blocked += std::chrono::duration_cast<std::chrono::nanoseconds>(now - context.blocked_since);
+    }
+
+    return result;
+}
+
+void manager::detail::flush_dirty()
+{
+    // both buffers keep their capacity, so steady state does not allocate
+    dirty_batch.clear();
+    dirty_batch.swap(dirty);
+    for (int sock: dirty_batch)
+    {
+        socket_context * const context = find_context(sock);
+        if ((nullptr != context) && (context->dirty))
+        {
+            flush(*context);
+        }
+    }
+}
+
+void manager::detail::update_interest(socket_context & context)
+{
+    uint32_t interest = context.offloads.empty() ? context.events : static_cast<uint32_t>(EPOLLONESHOT);
+    bool const send_blocked = (nullptr != context.shaper) && (context.shaper->send_blocked);
+    if ((nullptr != context.shaper) && (context.shaper->receive_blocked))
+    {
+        interest &= ~static_cast<uint32_t>(EPOLLIN);
+    }
+    uint32_t const mask = ((context.output.empty()) || (send_blocked)) ? interest : (interest | EPOLLOUT);
+    if (mask != context.armed)
+    {
+        core.set_events(context.fd, mask);
+        context.armed = mask;
+    }
+}
+
+void manager::detail::dispatch_traced(socket_context & context, uint32_t events)
+{
+    auto const start = std::chrono::steady_clock::now();
+    context.invoke(events);
+    auto const duration = std::chrono::steady_clock::now() - start;
+
+    // tracing may be disabled by the callback itself
+    if (nullptr == tracing)
+    {
+        return;
+    }
+
+    if (nullptr == context.latency)
+    {
+        context.latency.reset(new latency_histogram());
+    }
+
+    trace_record record;
+    record.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count());
+    record.fd = context.fd;
+    record.events = events;
+    record.duration = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+
+    context.latency->record(record.duration);
+    tracing->add(record);
+}
+
+void manager::detail::release(context_ptr context)
+{
+    if (0 < dispatch_depth)
+    {
+        context->removed = true;
+        graveyard.push_back(std::move(context));
+    }
+}
+
+void manager::detail::run_posted()
+{
+    std::vector<std::function<void()>> functions;
+    {
+        std::lock_guard<std::mutex> lock(mail->mutex);
+        functions.swap(mail->posted);
+        mail->pending = false;
+    }
+
+    for (std::size_t i = 0; i < functions.size(); i++)
+    {
+        try
+        {
+            functions[i]();
+        }
+        catch (...)
+        {
+            mail->requeue(functions, i + 1);
+            throw;
+        }
+    }
+}
+
+void manager::detail::complete_offload(int sock, std::shared_ptr<offload_job> const & job, std::function<void()> completion)
+{
+    if (job->cancelled)
+    {
+        return;
+    }
+
+    job->completion = std::move(completion);
+    job->finished = true;
+    run_completions(sock);
+}
+
+void manager::detail::run_completions(int sock)
+{
+    socket_context * const managed = find_context(sock);
+    if (nullptr == managed)
+    {
+        return;
+    }
+
+    auto & context = *managed;
+    while ((!context.offloads.empty()) && (context.offloads.front()->finished))
+    {
+        auto next = std::move(context.offloads.front());
+        context.offloads.pop_front();
+
+        try
+        {
+            next->completion();
+        }
+        catch (...)
+        {
+            // a throwing completion must not leave the socket disarmed;
+            // completions already finished are run by a later dispatch
+            if (!context.removed)
+            {
+                update_interest(context);
+                if ((!context.offloads.empty()) && (context.offloads.front()->finished))
+                {
+                    detail * const self = this;
+                    mail->post([self, sock]() {
+                        self->run_completions(sock);
+                    });
+                }
+            }
+            throw;
+        }
+
+        if (context.removed)
+        {
+            return;
+        }
+    }
+
+    update_interest(context);
+}
+
+void manager::detail::drain_signals()
+{
+    signalfd_siginfo infos[16];
+    ssize_t count = ::read(signal_fd, infos, sizeof(infos));
+    while (0 < count)
+    {
+        size_t const received = static_cast<size_t>(count) / sizeof(signalfd_siginfo);
+        for (size_t i = 0; i < received; i++)
+        {
+            auto it = signal_handlers.find(static_cast<int>(infos[i].ssi_signo));
+            if (it != signal_handlers.end())
+            {
+                it->second(infos[i]);
+            }
+        }
+
+        count = ::read(signal_fd, infos, sizeof(infos));
+    }
+}
+
+void manager::detail::run_until(std::chrono::steady_clock::time_point deadline)
+{
+    epoll_event events[batch_size];
+    while (!core.stop_requested())
+    {
+        int const rc = wait_until(events, batch_size, deadline);
+        dispatch(events, rc);
+
+        for (auto & handler: idle_handlers)
+        {
+            handler();
+        }
+
+        if ((std::chrono::steady_clock::time_point::max() != deadline)
+            && (core.now() >= deadline))
+        {
+            break;
+        }
+    }
+
+    core.clear_stop();
+}
+
+void manager::detail::service(int timeout, std::size_t max_events)
+{
+    epoll_event events[batch_size];
+    std::size_t remaining = max_events;
+    while (0 < remaining)
+    {
+        int const count = (remaining < static_cast<std::size_t>(batch_size)) ? static_cast<int>(remaining) : batch_size;
+        int const rc = wait(events, count, timeout);
+        dispatch(events, rc);
+
+        if (rc < count)
+        {
+            break;
+        }
+
+        remaining -= static_cast<std::size_t>(rc);
+        timeout = 0;
+    }
+}
+
+int manager::detail::wait(epoll_event * events, int max_events, int timeout)
+{
+    if (0 > timeout)
+    {
+        return core.wait(events, max_events, effective(std::chrono::steady_clock::time_point::max()));
+    }
+
+    return wait(events, max_events, std::chrono::milliseconds(timeout));
+}
+
+int manager::detail::wait(epoll_event * events, int max_events, std::chrono::nanoseconds timeout)
+{
+    if ((std::chrono::nanoseconds::zero() >= timeout) || (!ready.empty()))
+    {
+        return core.wait(events, max_events, std::chrono::steady_clock::time_point::min());
+    }
+
+    auto const now = core.now();
+    auto const deadline = (timeout < (std::chrono::steady_clock::time_point::max() - now))
+        ? now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout)
+        : std::chrono::steady_clock::time_point::max();
+    return core.wait(events, max_events, deadline);
+}
+
+int manager::detail::wait_until(epoll_event * events, int max_events, std::chrono::steady_clock::time_point deadline)
+{
+    return core.wait(events, max_events, effective(deadline));
+}
+
+timer_queue::timer_id manager::detail::schedule(std::chrono::steady_clock::time_point deadline, std::function<void()> callback)
+{
+    auto const id = timers.schedule(deadline, std::move(callback));
+    arm_alarm();
+    return id;
+}
+
+void manager::detail::cancel(timer_queue::timer_id id)
+{
+    // a stale alarm just finds no expired timer
+    timers.cancel(id);
+}
+
+void manager::detail::arm_alarm()
+{
+    auto const deadline = timers.next_deadline();
+    if (deadline >= alarm_deadline)
+    {
+        return;
+    }
+
+    core.set_alarm(deadline);
+    alarm_deadline = deadline;
+}
+
+void manager::detail::expire_timers()
+{
+    timers.expire(core.now());
+
+    // re-arming also clears the expiration
+    alarm_deadline = timers.next_deadline();
+    core.set_alarm(alarm_deadline);
+}
+
+void manager::detail::accept_clients(int sock)
+{
+    constexpr auto const fd_exhausted_delay = std::chrono::milliseconds(100);
+
+    for (int i = 0; i < batch_size; i++)
+    {
+        // the callback may remove the listener
+        auto it = listeners.find(sock);
+        if ((it == listeners.end()) || (it->second->paused))
+        {
+            return;
+        }
+
+        auto & listener = *(it->second);
+        auto const now = core.now();
+        if ((0 != listener.options.max_sockets) && (socket_count >= listener.options.max_sockets))
+        {
+            // resumed when a socket is removed
+            pause_listener(sock, listener, std::chrono::steady_clock::time_point::max());
+            return;
+        }
+
+        if (!take_token(listener, now))
+        {
+            auto const wait = std::chrono::duration<double>((1.0 - listener.tokens) / listener.options.accept_rate);
+            pause_listener(sock, listener, now + std::chrono::duration_cast<std::chrono::nanoseconds>(wait));
+            return;
+        }
+
+        int const client = ::accept4(sock, nullptr, nullptr, listener.options.accept_flags);
+        if (0 > client)
+        {
+            int const error = errno;
+            listener.tokens += 1.0;
+            if ((EMFILE == error) || (ENFILE == error) || (ENOBUFS == error) || (ENOMEM == error))
+            {
+                pause_listener(sock, listener, now + fd_exhausted_delay);
+                return;
+            }
+            else if ((ECONNABORTED == error) || (EINTR == error))
+            {
+                continue;
+            }
+
+            return;
+        }
+
+        if (has_accepted_options(listener.options.socket))
+        {
+            // best effort; the connection is usable anyway
+            static_cast<void>(apply_accepted_options(client, listener.options.socket));
+        }
+
+        listener.callback(client);
+    }
+}
+
+bool manager::detail::take_token(listener_state & listener, std::chrono::steady_clock::time_point now)
+{
+    if (0.0 >= listener.options.accept_rate)
+    {
+        return true;
+    }
+
+    double const elapsed = std::chrono::duration<double>(now - listener.refilled).count();
+    double const burst = static_cast<double>((0 < listener.options.accept_burst) ? listener.options.accept_burst : 1);
+    listener.tokens = std::min(burst, listener.tokens + (elapsed * listener.options.accept_rate));
+    listener.refilled = now;
+
+    if (1.0 > listener.tokens)
+    {
+        return false;
+    }
+
+    listener.tokens -= 1.0;
+    return true;
+}
+
+void manager::detail::pause_listener(int sock, listener_state & listener, std::chrono::steady_clock::time_point resume_at)
+{
+    if (!listener.paused)
+    {
+        listener.paused = true;
+        modify(sock, EPOLLIN, false);
+    }
+
+    if (std::chrono::steady_clock::time_point::max() != resume_at)
+    {
+        cancel(listener.resume_timer);
+        detail * const self = this;
+        listener.resume_timer = schedule(resume_at, [self, sock]() {
+            self->resume_listener(sock);
+        });
+    }
+}
+
+void manager::detail::resume_listener(int sock)
+{
+    auto it = listeners.find(sock);
+    if ((it != listeners.end()) && (it->second->paused))
+    {
+        it->second->paused = false;
+        it->second->resume_timer = 0;
+        modify(sock, EPOLLIN, true);
+    }
+}
+
+void manager::detail::resume_listeners()
+{
+    for (auto & entry: listeners)
+    {
+        auto & listener = *(entry.second);
+        bool const waits_for_capacity = (listener.paused) && (0 == listener.resume_timer);
+        if ((waits_for_capacity) && (socket_count < listener.options.max_sockets))
+        {
+            listener.paused = false;
+            modify(entry.first, EPOLLIN, true);
+        }
+    }
+}
+
+void manager::detail::schedule_sweep()
+{
+    if (std::chrono::nanoseconds::zero() >= inactivity_timeout)
+    {
+        return;
+    }
+
+    constexpr auto const min_interval = std::chrono::milliseconds(10);
+    auto const interval = std::max<std::chrono::nanoseconds>(inactivity_timeout / 4, min_interval);
+
+    detail * const self = this;
+    sweep_timer = schedule(core.now() + interval, [self]() {
+        self->sweep_inactive();
+    });
+}
+
+void manager::detail::sweep_inactive()
+{
+    // the list is ordered by activity, so only expired contexts are visited
+    auto const now = core.now();
+    auto const expired = now - inactivity_timeout;
+    std::vector<socket_context *> inactive;
+    for (auto * context = activity.front(); (nullptr != context) && (context->last_activity <= expired); context = activity.front())
+    {
+        activity.unlink(*context);
+        inactive.push_back(context);
+    }
+
+    // contexts removed by the callback are kept alive until the end of dispatch
+    for (auto * context: inactive)
+    {
+        if (!context->removed)
+        {
+            on_inactive(context->fd);
+        }
+
+        if ((!context->removed) && (find_context(context->fd) == context))
+        {
+            activity.touch(*context, now);
+        }
+    }
+
+    schedule_sweep();
+}
+
+void manager::detail::join_shaper(socket_context & context, std::shared_ptr<rate_shaper> shaper)
+{
+    leave_shaper(context);
+
+    shaper->members.insert(context.fd);
+    context.shaper = std::move(shaper);
+    update_interest(context);
+}
+
+void manager::detail::leave_shaper(socket_context & context)
+{
+    if (nullptr == context.shaper)
+    {
+        return;
+    }
+
+    bool const blocked = (context.shaper->receive_blocked) || (context.shaper->send_blocked);
+    context.shaper->members.erase(context.fd);
+    context.shaper.reset();
+
+    if (blocked)
+    {
+        flush(context);
+        resume_ready(context);
+    }
+}
+
+void manager::detail::take_receive(std::shared_ptr<rate_shaper> const & shaper, token_bucket & bucket, std::size_t count)
+{
+    if (!bucket.limited())
+    {
+        return;
+    }
+
+    auto const now = core.now();
+    bucket.take(count, now);
+    if ((0 == bucket.available(now)) && (!shaper->receive_blocked))
+    {
+        shaper->receive_blocked = true;
+        for (int sock: shaper->members)
+        {
+            update_interest(context_of(sock));
+        }
+        throttle(*shaper, shaper);
+    }
+}
+
+void manager::detail::take_send(socket_context & context, std::size_t count)
+{
+    if (nullptr == context.shaper)
+    {
+        return;
+    }
+
+    auto & shaper = *(context.shaper);
+    auto const now = core.now();
+    shaper.send_bytes.take(count, now);
+    if ((0 == shaper.send_bytes.available(now)) && (!shaper.send_blocked))
+    {
+        // interest of the members is updated when their writes end
+        shaper.send_blocked = true;
+        throttle(shaper, context.shaper);
+    }
+}
+
+std::size_t manager::detail::send_budget(socket_context & context)
+{
+    if ((nullptr == context.shaper) || (!context.shaper->send_bytes.limited()))
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    return context.shaper->send_blocked ? 0 : context.shaper->send_bytes.available(core.now());
+}
+
+void manager::detail::throttle(rate_shaper & shaper, std::shared_ptr<rate_shaper> const & handle)
+{
+    constexpr auto const resolution = std::chrono::milliseconds(10);
+
+    if (shaper.scheduled)
+    {
+        return;
+    }
+
+    auto const now = core.now();
+    auto resume_at = std::chrono::steady_clock::time_point::max();
+    if (shaper.receive_blocked)
+    {
+        resume_at = std::min(resume_at, std::max(shaper.receive_bytes.refilled_at(now), shaper.receive_events.refilled_at(now)));
+    }
+    if (shaper.send_blocked)
+    {
+        resume_at = std::min(resume_at, shaper.send_bytes.refilled_at(now));
+    }
+
+    // shapers resuming within the same slot share a single timer
+    auto const since_epoch = resume_at.time_since_epoch();
+    auto const slot_count = (since_epoch + resolution - std::chrono::nanoseconds(1)) / resolution;
+    auto const slot = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(slot_count * resolution));
+
+    auto & waiting = throttled[slot];
+    if (waiting.empty())
+    {
+        detail * const self = this;
+        schedule(slot, [self, slot]() {
+            self->resume_throttled(slot);
+        });
+    }
+
+    waiting.push_back(handle);
+    shaper.scheduled = true;
+}
+
+void manager::detail::resume_throttled(std::chrono::steady_clock::time_point slot)
+{
+    auto it = throttled.find(slot);
+    if (it == throttled.end())
+    {
+        return;
+    }
+
+    auto waiting = std::move(it->second);
+    throttled.erase(it);
+
+    auto const now = core.now();
+    for (auto & entry: waiting)
+    {
+        auto shaper = entry.lock();
+        if (nullptr == shaper)
+        {
+            continue;
+        }
+
+        shaper->scheduled = false;
+        std::vector<int> const members(shaper->members.begin(), shaper->members.end());
+        if ((shaper->send_blocked) && (0 < shaper->send_bytes.available(now)))
+        {
+            shaper->send_blocked = false;
+            for (int sock: members)
+            {
+                socket_context * const member = find_context(sock);
+                if ((nullptr != member) && (member->shaper == shaper))
+                {
+                    flush(*member);
+                }
+            }
+        }
+
+        bool const receive_refilled = (0 < shaper->receive_bytes.available(now)) && (0 < shaper->receive_events.available(now));
+        if ((shaper->receive_blocked) && (receive_refilled))
+        {
+            shaper->receive_blocked = false;
+            for (int sock: members)
+            {
+                socket_context * const member = find_context(sock);
+                if ((nullptr != member) && (member->shaper == shaper))
+                {
+                    update_interest(*member);
+                    resume_ready(*member);
+                }
+            }
+        }
+
+        if ((shaper->receive_blocked) || (shaper->send_blocked))
+        {
+            throttle(*shaper, shaper);
+        }
+    }
+}
+
+void manager::detail::resume_ready(socket_context & context)
+{
+    update_interest(context);
+
+    // edge-triggered sockets are not reported again by the kernel
+    bool const edge = (0 != (context.events & EPOLLET)) && (0 != (context.events & EPOLLIN));
+    if ((edge) && (!context.drained) && (!context.queued_ready))
+    {
+        context.queued_ready = true;
+        ready.push_back(context.fd);
+    }
+}
+
+void manager::detail::modify(int sock, uint32_t mask, bool enable)
+{
+    auto & context = context_of(sock);
+    context.events = enable ? (context.events | mask) : (context.events & (~mask));
+    update_interest(context);
 }
 
 
@@ -0,0 +1,29 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_NEWLINE_SCAN_HPP
+#define SOCKMAN_NEWLINE_SCAN_HPP
+
+#include <cstddef>
+
+namespace sockman
+{
+
+// Implementations of find_newline, exposed for testing.
+// Each returns the position of the first '\n' or length.
+
+std::size_t find_newline_generic(char const * data, std::size_t length);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SOCKMAN_HAS_X86_SCAN 1
+std::size_t find_newline_sse2(char const * data, std::size_t length);
+std::size_t find_newline_avx2(char const * data, std::size_t length);
+bool has_avx2();
+#endif
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/numa.hpp"
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace sockman
+{
+
+namespace
+{
+
+// see set_mempolicy(2); defined here to avoid a dependency to libnuma
+constexpr int const mpol_preferred = 1;
+
+}
+
+void bind_to_numa_node(void * address, std::size_t size, int node)
+{
+#ifdef SYS_mbind
+    unsigned long mask[4] = {0, 0, 0, 0};
+    constexpr int const bits_per_mask = 8 * sizeof(unsigned long);
+    if ((0 <= node) && (node < (4 * bits_per_mask)))
+    {
+        mask[node / bits_per_mask] = 1ul << (node % bits_per_mask);
+        ::syscall(SYS_mbind, address, size, mpol_preferred, mask, 4 * bits_per_mask + 1, 0);
+    }
+#else
+    (void) address;
+    (void) size;
+    (void) node;
+#endif
+}
+
+}
@@ -0,0 +1,21 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_NUMA_HPP
+#define SOCKMAN_NUMA_HPP
+
+#include <cstddef>
+
+namespace sockman
+{
+
+/// Sets the preferred NUMA node of a memory range.
+/// Failures are ignored, e.g. when the kernel does not support NUMA.
+void bind_to_numa_node(void * address, std::size_t size, int node);
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/rate_shaper.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace sockman
+{
+
+token_bucket::token_bucket()
+: rate(0.0)
+, burst(0.0)
+, tokens(0.0)
+{
+
+}
+
+void token_bucket::configure(rate_limit const & limit, clock::time_point now)
+{
+    rate = std::max(0.0, limit.rate);
+    burst = (0 < limit.burst) ? static_cast<double>(limit.burst) : std::max(1.0, rate);
+    tokens = burst;
+    refilled = now;
+}
+
+bool token_bucket::limited() const
+{
+    return (0.0 < rate);
+}
+
+std::size_t token_bucket::available(clock::time_point now)
+{
+    if (!limited())
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    refill(now);
+    return (1.0 <= tokens) ? static_cast<std::size_t>(tokens) : 0;
+}
+
+void token_bucket::take(std::size_t count, clock::time_point now)
+{
+    if (!limited())
+    {
+        return;
+    }
+
+    refill(now);
+    tokens -= static_cast<double>(count);
+}
+
+token_bucket::clock::time_point token_bucket::refilled_at(clock::time_point now)
+{
+    refill(now);
+    if ((!limited()) || (1.0 <= tokens))
+    {
+        return now;
+    }
+
+    auto const wait = std::chrono::duration<double>((1.0 - tokens) / rate);
+    return now + std::chrono::duration_cast<clock::duration>(wait);
+}
+
+void token_bucket::refill(clock::time_point now)
+{
+    if (now > refilled)
+    {
+        double const elapsed = std::chrono::duration<double>(now - refilled).count();
+        tokens = std::min(burst, tokens + (elapsed * rate));
+        refilled = now;
+    }
+}
+
+void rate_shaper::configure(shaping_options const & options, token_bucket::clock::time_point now)
+{
+    receive_bytes.configure(options.receive_bytes, now);
+    receive_events.configure(options.receive_events, now);
+    send_bytes.configure(options.send_bytes, now);
+}
+
+}
@@ -0,0 +1,67 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_RATE_SHAPER_HPP
+#define SOCKMAN_RATE_SHAPER_HPP
+
+#include "sockman/sockman.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <unordered_set>
+
+namespace sockman
+{
+
+/// Token bucket, which is refilled lazily when tokens are taken,
+/// so idle buckets cost nothing.
+class token_bucket
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    token_bucket();
+
+    void configure(rate_limit const & limit, clock::time_point now);
+
+    bool limited() const;
+
+    /// Returns the number of whole tokens available at now.
+    std::size_t available(clock::time_point now);
+
+    /// Takes tokens; the bucket may run into debt, which is
+    /// paid back before tokens are available again.
+    void take(std::size_t count, clock::time_point now);
+
+    /// Returns the time at which at least one token is available.
+    clock::time_point refilled_at(clock::time_point now);
+
+private:
+    void refill(clock::time_point now);
+
+    double rate;
+    double burst;
+    double tokens;
+    clock::time_point refilled;
+};
+
+/// Buckets shared by the sockets of a group (or owned by a single socket).
+struct rate_shaper
+{
+    token_bucket receive_bytes;
+    token_bucket receive_events;
+    token_bucket send_bytes;
+    std::unordered_set<int> members;
+    bool receive_blocked = false;
+    bool send_blocked = false;
+    bool scheduled = false;
+
+    void configure(shaping_options const & options, token_bucket::clock::time_point now);
+};
+
+}
+
+#endif
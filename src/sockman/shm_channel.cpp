@@ -0,0 +1,412 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/shm_channel.hpp"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace sockman
+{
+
+namespace
+{
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "lock-free 64 bit atomics required for shared memory");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "lock-free atomics required for shared memory");
+
+// Positions grow monotonically and are masked by capacity - 1.
+// Producer and consumer positions live on separate cache lines.
+struct ring_header
+{
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> reader_waiting;
+    std::atomic<uint32_t> writer_waiting;
+    std::atomic<uint32_t> reader_closed;
+    std::atomic<uint32_t> writer_closed;
+    uint64_t capacity;
+};
+
+constexpr std::size_t const header_size = 4096;
+constexpr std::size_t const min_capacity = 4096;
+
+static_assert(sizeof(ring_header) <= header_size, "ring header too large");
+
+std::size_t ring_size(std::size_t capacity)
+{
+    return header_size + capacity;
+}
+
+void notify(int fd)
+{
+    uint64_t const value = 1;
+    ssize_t const rc = ::write(fd, &value, sizeof(value));
+    (void) rc;
+}
+
+void copy_in(char * data, std::size_t capacity, uint64_t position, char const * source, std::size_t length)
+{
+    std::size_t const offset = static_cast<std::size_t>(position & (capacity - 1));
+    std::size_t const first = std::min(length, capacity - offset);
+    memcpy(&(data[offset]), source, first);
+    memcpy(data, &(source[first]), length - first);
+}
+
+void copy_out(char const * data, std::size_t capacity, uint64_t position, char * target, std::size_t length)
+{
+    std::size_t const offset = static_cast<std::size_t>(position & (capacity - 1));
+    std::size_t const first = std::min(length, capacity - offset);
+    memcpy(target, &(data[offset]), first);
+    memcpy(&(target[first]), data, length - first);
+}
+
+}
+
+class shm_channel::detail
+{
+public:
+    detail(manager & owner_)
+    : owner(owner_)
+    , local_fd(-1)
+    , remote_fd(-1)
+    , memory(MAP_FAILED)
+    , mapped(0)
+    , capacity(0)
+    , tx(nullptr)
+    , tx_data(nullptr)
+    , rx(nullptr)
+    , rx_data(nullptr)
+    , write_blocked(false)
+    , closed(false)
+    {
+
+    }
+
+    ~detail()
+    {
+        if (MAP_FAILED != memory)
+        {
+            ::munmap(memory, mapped);
+        }
+        if (0 <= remote_fd)
+        {
+            ::close(remote_fd);
+        }
+        if (0 <= local_fd)
+        {
+            ::close(local_fd);
+        }
+    }
+
+    bool readable() const
+    {
+        return (rx->tail.load(std::memory_order_acquire) != rx->head.load(std::memory_order_relaxed))
+            || (0 != rx->writer_closed.load(std::memory_order_acquire));
+    }
+
+    std::size_t space() const
+    {
+        uint64_t const used = tx->tail.load(std::memory_order_relaxed) - tx->head.load(std::memory_order_acquire);
+        return capacity - static_cast<std::size_t>(used);
+    }
+
+    void handle();
+    void rearm();
+
+    manager & owner;
+    int local_fd;
+    int remote_fd;
+    void * memory;
+    std::size_t mapped;
+    std::size_t capacity;
+    ring_header * tx;
+    char * tx_data;
+    ring_header * rx;
+    char * rx_data;
+    socket_callback callback;
+    bool write_blocked;
+    bool closed;
+};
+
+void shm_channel::detail::handle()
+{
+    bool const peer_closed = (0 != rx->writer_closed.load(std::memory_order_acquire))
+        || (0 != tx->reader_closed.load(std::memory_order_acquire));
+
+    uint32_t events = 0;
+    if (readable())
+    {
+        events |= EPOLLIN;
+    }
+    if ((write_blocked) && ((0 < space()) || (peer_closed)))
+    {
+        write_blocked = false;
+        events |= EPOLLOUT;
+    }
+    if (peer_closed)
+    {
+        events |= EPOLLHUP;
+    }
+
+    if (0 != events)
+    {
+        // the callback may destroy the channel; this stays alive
+        // until the end of the batch
+        callback(local_fd, socket_events(events));
+    }
+
+    if (!closed)
+    {
+        rearm();
+    }
+}
+
+void shm_channel::detail::rearm()
+{
+    if (readable())
+    {
+        // the eventfd is not drained, so the manager reports
+        // the channel again, as for a level-triggered socket
+        return;
+    }
+
+    uint64_t value;
+    ssize_t const rc = ::read(local_fd, &value, sizeof(value));
+    (void) rc;
+
+    // announce waiting before checking the ring again; pairs with the
+    // fence of the producer, so either the producer sees the flag or
+    // this side sees the data
+    rx->reader_waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (readable())
+    {
+        notify(local_fd);
+    }
+}
+
+shm_descriptors create_shm_channel(std::size_t capacity)
+{
+    std::size_t size = min_capacity;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    shm_descriptors descriptors{-1, {-1, -1}};
+    descriptors.memory = memfd_create("sockman_shm", MFD_CLOEXEC);
+    descriptors.notify[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    descriptors.notify[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    std::size_t const total = 2 * ring_size(size);
+    void * memory = MAP_FAILED;
+    if ((0 <= descriptors.memory) && (0 <= descriptors.notify[0]) && (0 <= descriptors.notify[1])
+        && (0 == ftruncate(descriptors.memory, static_cast<off_t>(total))))
+    {
+        memory = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, descriptors.memory, 0);
+    }
+
+    if (MAP_FAILED == memory)
+    {
+        close_shm_descriptors(descriptors);
+        throw std::runtime_error("failed to create shared memory channel");
+    }
+
+    for (std::size_t i = 0; i < 2; i++)
+    {
+        auto * header = new (reinterpret_cast<char*>(memory) + (i * ring_size(size))) ring_header();
+        header->head.store(0);
+        header->tail.store(0);
+        header->reader_waiting.store(1);
+        header->writer_waiting.store(0);
+        header->reader_closed.store(0);
+        header->writer_closed.store(0);
+        header->capacity = size;
+    }
+
+    ::munmap(memory, total);
+    return descriptors;
+}
+
+void close_shm_descriptors(shm_descriptors const & descriptors)
+{
+    int const fds[] = {descriptors.memory, descriptors.notify[0], descriptors.notify[1]};
+    for (int fd: fds)
+    {
+        if (0 <= fd)
+        {
+            ::close(fd);
+        }
+    }
+}
+
+shm_channel::shm_channel(manager & manager, shm_descriptors const & descriptors, shm_side side, socket_callback callback)
+: d(std::make_shared<detail>(manager))
+{
+    std::size_t const local = (shm_side::first == side) ? 0 : 1;
+    std::size_t const remote = 1 - local;
+
+    struct stat info;
+    if (0 != ::fstat(descriptors.memory, &info))
+    {
+        throw std::runtime_error("invalid shared memory channel");
+    }
+
+    d->mapped = static_cast<std::size_t>(info.st_size);
+    d->memory = ::mmap(nullptr, d->mapped, PROT_READ | PROT_WRITE, MAP_SHARED, descriptors.memory, 0);
+    if (MAP_FAILED == d->memory)
+    {
+        throw std::runtime_error("failed to map shared memory channel");
+    }
+
+    char * const base = reinterpret_cast<char*>(d->memory);
+    auto * const first = reinterpret_cast<ring_header*>(base);
+    d->capacity = static_cast<std::size_t>(first->capacity);
+    bool const valid = (min_capacity <= d->capacity) && (0 == (d->capacity & (d->capacity - 1)))
+        && (d->mapped == 2 * ring_size(d->capacity));
+    if (!valid)
+    {
+        throw std::runtime_error("invalid shared memory channel");
+    }
+
+    // the first side writes to ring 0 and reads from ring 1
+    char * const rings[2] = {base, base + ring_size(d->capacity)};
+    d->tx = reinterpret_cast<ring_header*>(rings[local]);
+    d->tx_data = rings[local] + header_size;
+    d->rx = reinterpret_cast<ring_header*>(rings[remote]);
+    d->rx_data = rings[remote] + header_size;
+
+    d->local_fd = fcntl(descriptors.notify[local], F_DUPFD_CLOEXEC, 0);
+    d->remote_fd = fcntl(descriptors.notify[remote], F_DUPFD_CLOEXEC, 0);
+    if ((0 > d->local_fd) || (0 > d->remote_fd))
+    {
+        throw std::runtime_error("failed to duplicate descriptors");
+    }
+
+    d->callback = std::move(callback);
+    std::shared_ptr<detail> self = d;
+    manager.add(d->local_fd, readable, [self](int, socket_events) {
+        self->handle();
+    });
+
+    // data may have been written before this side was attached
+    if (d->readable())
+    {
+        notify(d->local_fd);
+    }
+}
+
+shm_channel::~shm_channel()
+{
+    d->closed = true;
+    d->owner.remove(d->local_fd);
+
+    d->tx->writer_closed.store(1, std::memory_order_release);
+    d->rx->reader_closed.store(1, std::memory_order_release);
+    notify(d->remote_fd);
+}
+
+int shm_channel::native_handle() const
+{
+    return d->local_fd;
+}
+
+ssize_t shm_channel::read(void * buffer, std::size_t length)
+{
+    auto & rx = *(d->rx);
+    uint64_t const head = rx.head.load(std::memory_order_relaxed);
+    uint64_t tail = rx.tail.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+        if (0 != rx.writer_closed.load(std::memory_order_acquire))
+        {
+            // data written before closing is visible now
+            tail = rx.tail.load(std::memory_order_acquire);
+        }
+
+        if (head == tail)
+        {
+            if (0 != rx.writer_closed.load(std::memory_order_relaxed))
+            {
+                return 0;
+            }
+
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+
+    std::size_t const count = std::min(length, static_cast<std::size_t>(tail - head));
+    copy_out(d->rx_data, d->capacity, head, reinterpret_cast<char*>(buffer), count);
+    rx.head.store(head + count, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if ((0 != rx.writer_waiting.load(std::memory_order_relaxed)) && (0 != rx.writer_waiting.exchange(0)))
+    {
+        notify(d->remote_fd);
+    }
+
+    return static_cast<ssize_t>(count);
+}
+
+ssize_t shm_channel::write(void const * data, std::size_t length)
+{
+    auto & tx = *(d->tx);
+    if (0 != tx.reader_closed.load(std::memory_order_acquire))
+    {
+        errno = EPIPE;
+        return -1;
+    }
+
+    if (0 == length)
+    {
+        return 0;
+    }
+
+    std::size_t space = d->space();
+    if (0 == space)
+    {
+        // same protocol as the reader, see rearm
+        tx.writer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        space = d->space();
+        if (0 == space)
+        {
+            d->write_blocked = true;
+            errno = EAGAIN;
+            return -1;
+        }
+        tx.writer_waiting.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t const tail = tx.tail.load(std::memory_order_relaxed);
+    std::size_t const count = std::min(length, space);
+    copy_in(d->tx_data, d->capacity, tail, reinterpret_cast<char const*>(data), count);
+    tx.tail.store(tail + count, std::memory_order_release);
+
+    // notify only if the peer announced that it waits for data
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if ((0 != tx.reader_waiting.load(std::memory_order_relaxed)) && (0 != tx.reader_waiting.exchange(0)))
+    {
+        notify(d->remote_fd);
+    }
+
+    return static_cast<ssize_t>(count);
+}
+
+}
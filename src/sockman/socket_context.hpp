@@ -8,16 +8,69 @@
 #define SOCKMAN_SOCKETCONTEXT_HPP
 
 #include "sockman/sockman.hpp"
+#include "sockman/trace.hpp"
+#include "sockman/write_queue.hpp"
+#include "sockman/rate_shaper.hpp"
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <memory>
 
 namespace sockman
 {
 
+/// Work of a socket running on a worker_pool; only accessed by the loop thread.
+struct offload_job
+{
+    std::function<void()> completion;
+    bool finished = false;
+    bool cancelled = false;
+};
+
 struct socket_context
 {
+    socket_context(int fd_, uint32_t events_, socket_callback callback_)
+    : fd(fd_)
+    , events(events_)
+    , callback(std::move(callback_))
+    {
+    }
+
     int fd;
     uint32_t events;
     socket_callback callback;
+    bool removed = false;
+    std::unique_ptr<latency_histogram> latency = nullptr;
+    write_queue output;
+    uint32_t armed = 0;
+    bool dirty = false;
+    bool is_socket = true;
+    bool activity_tracked = false;
+    socket_context * activity_prev = nullptr;
+    socket_context * activity_next = nullptr;
+    std::chrono::steady_clock::time_point last_activity = {};
+    handler_dispatcher dispatcher = nullptr;
+    void * handler = nullptr;
+    std::deque<std::shared_ptr<offload_job>> offloads;
+    bool drained = true;
+    bool queued_ready = false;
+    uint64_t ready_batch = 0;
+    std::shared_ptr<rate_shaper> shaper = nullptr;
+    socket_statistics stats = {};
+    bool write_blocked = false;
+    std::chrono::steady_clock::time_point blocked_since = {};
+
+    void invoke(uint32_t received)
+    {
+        if (nullptr != dispatcher)
+        {
+            dispatcher(handler, fd, received, removed);
+        }
+        else
+        {
+            callback(fd, socket_events(received));
+        }
+    }
 };
 
 }
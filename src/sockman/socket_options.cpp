@@ -0,0 +1,76 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/socket_options.hpp"
+#include "sockman/socket_tuning.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <stdexcept>
+
+namespace sockman
+{
+
+namespace
+{
+
+bool set_option(int sock, int level, int name, int value)
+{
+    if (option_unset == value)
+    {
+        return true;
+    }
+
+    return (0 == ::setsockopt(sock, level, name, &value, sizeof(value)));
+}
+
+}
+
+void apply_inherited_options(int listener, socket_options const & options)
+{
+    // Linux clones the listening socket for each accepted connection, so
+    // these options are set once instead of once per connection.
+    bool const success =
+           set_option(listener, IPPROTO_TCP, TCP_NODELAY, options.no_delay)
+        && set_option(listener, SOL_SOCKET, SO_RCVBUF, options.receive_buffer)
+        && set_option(listener, SOL_SOCKET, SO_SNDBUF, options.send_buffer)
+        && set_option(listener, SOL_SOCKET, SO_RCVLOWAT, options.receive_lowat)
+        && set_option(listener, IPPROTO_TCP, TCP_NOTSENT_LOWAT, options.notsent_lowat)
+        && set_option(listener, SOL_SOCKET, SO_KEEPALIVE, options.keepalive)
+        && set_option(listener, IPPROTO_TCP, TCP_KEEPIDLE, options.keepalive_idle)
+        && set_option(listener, IPPROTO_TCP, TCP_KEEPINTVL, options.keepalive_interval)
+        && set_option(listener, IPPROTO_TCP, TCP_KEEPCNT, options.keepalive_count)
+        && set_option(listener, SOL_SOCKET, SO_BUSY_POLL, options.busy_poll);
+
+    if (!success)
+    {
+        throw std::runtime_error("failed to set socket option");
+    }
+}
+
+bool apply_accepted_options(int sock, socket_options const & options)
+{
+    // quick ack mode is reset by the kernel for each connection
+    return set_option(sock, IPPROTO_TCP, TCP_QUICKACK, options.quick_ack);
+}
+
+bool has_accepted_options(socket_options const & options)
+{
+    return (option_unset != options.quick_ack);
+}
+
+void apply_socket_options(int sock, socket_options const & options)
+{
+    apply_inherited_options(sock, options);
+    if (!apply_accepted_options(sock, options))
+    {
+        throw std::runtime_error("failed to set socket option");
+    }
+}
+
+}
@@ -0,0 +1,27 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_SOCKET_TUNING_HPP
+#define SOCKMAN_SOCKET_TUNING_HPP
+
+#include "sockman/socket_options.hpp"
+
+namespace sockman
+{
+
+/// Sets the options, which accepted sockets inherit from the listener.
+/// Throws on failure.
+void apply_inherited_options(int listener, socket_options const & options);
+
+/// Sets the options, which are not inherited. Returns false on failure.
+bool apply_accepted_options(int sock, socket_options const & options);
+
+/// Returns true if any option is not inherited from the listener.
+bool has_accepted_options(socket_options const & options);
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/timer_queue.hpp"
+
+namespace sockman
+{
+
+timer_queue::timer_queue()
+: next_id(1)
+{
+
+}
+
+timer_queue::timer_id timer_queue::schedule(clock::time_point deadline, std::function<void()> callback)
+{
+    timer_id const id = next_id++;
+    auto it = timers.emplace(deadline, entry(id, std::move(callback)));
+    index.emplace(id, it);
+    return id;
+}
+
+void timer_queue::cancel(timer_id id)
+{
+    auto it = index.find(id);
+    if (it != index.end())
+    {
+        timers.erase(it->second);
+        index.erase(it);
+    }
+}
+
+timer_queue::clock::time_point timer_queue::next_deadline() const
+{
+    return timers.empty() ? clock::time_point::max() : timers.begin()->first;
+}
+
+void timer_queue::expire(clock::time_point now)
+{
+    while ((!timers.empty()) && (timers.begin()->first <= now))
+    {
+        auto it = timers.begin();
+        auto callback = std::move(it->second.second);
+        index.erase(it->second.first);
+        timers.erase(it);
+
+        callback();
+    }
+}
+
+bool timer_queue::empty() const
+{
+    return timers.empty();
+}
+
+}
@@ -0,0 +1,59 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_TIMER_QUEUE_HPP
+#define SOCKMAN_TIMER_QUEUE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace sockman
+{
+
+/// Deadline ordered queue of internal one-shot timers.
+///
+/// The queue does not wait by itself; the owner arms a timerfd
+/// to the next deadline and calls expire when it fires.
+class timer_queue
+{
+    timer_queue(timer_queue const &) = delete;
+    timer_queue& operator=(timer_queue const &) = delete;
+public:
+    using clock = std::chrono::steady_clock;
+    using timer_id = uint64_t;
+
+    timer_queue();
+
+    timer_id schedule(clock::time_point deadline, std::function<void()> callback);
+
+    /// Cancels a pending timer; unknown ids are ignored.
+    void cancel(timer_id id);
+
+    /// Returns the earliest deadline or time_point::max if empty.
+    clock::time_point next_deadline() const;
+
+    /// Invokes and removes all timers due at now.
+    /// Callbacks may schedule or cancel timers.
+    void expire(clock::time_point now);
+
+    bool empty() const;
+
+private:
+    using entry = std::pair<timer_id, std::function<void()>>;
+    using timer_map = std::multimap<clock::time_point, entry>;
+
+    timer_map timers;
+    std::unordered_map<timer_id, timer_map::iterator> index;
+    timer_id next_id;
+};
+
+}
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_TIMESPEC_HPP
+#define SOCKMAN_TIMESPEC_HPP
+
+#include <ctime>
+#include <chrono>
+
+namespace sockman
+{
+
+inline timespec to_timespec(std::chrono::nanoseconds value)
+{
+    auto const seconds = std::chrono::duration_cast<std::chrono::seconds>(value);
+
+    timespec result;
+    result.tv_sec = static_cast<time_t>(seconds.count());
+    result.tv_nsec = static_cast<long>((value - seconds).count());
+    return result;
+}
+
+}
+
+#endif
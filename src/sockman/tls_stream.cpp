@@ -0,0 +1,340 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/tls_stream.hpp"
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/bio.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+
+namespace sockman
+{
+
+class tls_stream::detail
+{
+public:
+    detail(tls_stream & stream, manager & owner, int sock, tls_callback callback);
+    ~detail();
+
+    void handle(socket_events events);
+    void handshake();
+    void update_interest();
+    ssize_t fail(int rc, bool writing);
+
+    tls_stream & stream;
+    manager & owner;
+    int sock;
+    SSL * ssl;
+    tls_callback callback;
+    bool established;
+    bool handshake_wants_write;
+    bool read_wants_write;
+    bool write_wants_read;
+    bool write_blocked;
+    bool watching_writable;
+};
+
+tls_stream::detail::detail(tls_stream & stream_, manager & owner_, int sock_, tls_callback callback_)
+: stream(stream_)
+, owner(owner_)
+, sock(sock_)
+, ssl(nullptr)
+, callback(std::move(callback_))
+, established(false)
+, handshake_wants_write(false)
+, read_wants_write(false)
+, write_wants_read(false)
+, write_blocked(false)
+, watching_writable(false)
+{
+
+}
+
+tls_stream::detail::~detail()
+{
+    SSL_free(ssl);
+}
+
+void tls_stream::detail::handle(socket_events events)
+{
+    if (!established)
+    {
+        handshake();
+        return;
+    }
+
+    uint32_t deliver = events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP);
+    if (events.readable())
+    {
+        deliver |= EPOLLIN;
+        if (write_wants_read)
+        {
+            write_wants_read = false;
+            deliver |= EPOLLOUT;
+        }
+    }
+
+    if (events.writable())
+    {
+        if (read_wants_write)
+        {
+            read_wants_write = false;
+            deliver |= EPOLLIN;
+        }
+        if (write_blocked)
+        {
+            write_blocked = false;
+            deliver |= EPOLLOUT;
+        }
+    }
+
+    update_interest();
+    if (0 != deliver)
+    {
+        // the callback may destroy the stream
+        callback(stream, socket_events(deliver));
+    }
+}
+
+void tls_stream::detail::handshake()
+{
+    int const rc = SSL_do_handshake(ssl);
+    if (1 == rc)
+    {
+        established = true;
+        handshake_wants_write = false;
+        update_interest();
+
+        // records received along with the handshake are not reported by the socket
+        uint32_t const events = EPOLLOUT | ((0 < SSL_pending(ssl)) ? static_cast<uint32_t>(EPOLLIN) : 0u);
+        callback(stream, socket_events(events));
+        return;
+    }
+
+    int const error = SSL_get_error(ssl, rc);
+    if (SSL_ERROR_WANT_READ == error)
+    {
+        handshake_wants_write = false;
+        update_interest();
+    }
+    else if (SSL_ERROR_WANT_WRITE == error)
+    {
+        handshake_wants_write = true;
+        update_interest();
+    }
+    else
+    {
+        ERR_clear_error();
+        handshake_wants_write = false;
+        update_interest();
+        callback(stream, socket_events(EPOLLERR));
+    }
+}
+
+void tls_stream::detail::update_interest()
+{
+    bool const writable = handshake_wants_write || read_wants_write || write_blocked;
+    if (writable != watching_writable)
+    {
+        owner.notify_on_writable(sock, writable);
+        watching_writable = writable;
+    }
+}
+
+ssize_t tls_stream::detail::fail(int rc, bool writing)
+{
+    int const error = SSL_get_error(ssl, rc);
+    switch (error)
+    {
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;
+        case SSL_ERROR_WANT_READ:
+            if (writing)
+            {
+                write_wants_read = true;
+            }
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_WANT_WRITE:
+            if (writing)
+            {
+                write_blocked = true;
+            }
+            else
+            {
+                read_wants_write = true;
+            }
+            update_interest();
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_SYSCALL:
+            ERR_clear_error();
+            if (0 == errno)
+            {
+                errno = ECONNRESET;
+            }
+            return -1;
+        default:
+            ERR_clear_error();
+            errno = EPROTO;
+            return -1;
+    }
+}
+
+tls_stream::tls_stream(manager & manager, int sock, ssl_ctx_st * context, tls_role role, tls_callback callback)
+: d(new detail(*this, manager, sock, std::move(callback)))
+{
+    int const flags = fcntl(sock, F_GETFL);
+    if ((nullptr == context) || (0 > flags) || (0 != fcntl(sock, F_SETFL, flags | O_NONBLOCK)))
+    {
+        delete d;
+        throw std::runtime_error("failed to create tls stream");
+    }
+
+    d->ssl = SSL_new(context);
+    if ((nullptr == d->ssl) || (1 != SSL_set_fd(d->ssl, sock)))
+    {
+        ERR_clear_error();
+        delete d;
+        throw std::runtime_error("failed to create tls stream");
+    }
+
+    // kernel TLS is enabled after the handshake, if supported
+    SSL_set_options(d->ssl, SSL_OP_ENABLE_KTLS);
+    SSL_set_mode(d->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+    if (tls_role::client == role)
+    {
+        // the client speaks first, once the socket is connected
+        SSL_set_connect_state(d->ssl);
+        d->handshake_wants_write = true;
+        d->watching_writable = true;
+    }
+    else
+    {
+        SSL_set_accept_state(d->ssl);
+    }
+
+    detail * const self = d;
+    try
+    {
+        manager.add(sock, d->watching_writable ? (readable | writable) : readable, [self](int, socket_events events) {
+            self->handle(events);
+        });
+    }
+    catch (...)
+    {
+        delete d;
+        throw;
+    }
+}
+
+tls_stream::~tls_stream()
+{
+    d->owner.remove(d->sock);
+    delete d;
+}
+
+int tls_stream::native_handle() const
+{
+    return d->sock;
+}
+
+bool tls_stream::established() const
+{
+    return d->established;
+}
+
+bool tls_stream::kernel_send() const
+{
+    return (0 != BIO_get_ktls_send(SSL_get_wbio(d->ssl)));
+}
+
+bool tls_stream::kernel_receive() const
+{
+    return (0 != BIO_get_ktls_recv(SSL_get_rbio(d->ssl)));
+}
+
+ssize_t tls_stream::read(void * buffer, std::size_t length)
+{
+    if (!d->established)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    int const rc = SSL_read(d->ssl, buffer, (length < INT_MAX) ? static_cast<int>(length) : INT_MAX);
+    if (0 < rc)
+    {
+        return rc;
+    }
+
+    return d->fail(rc, false);
+}
+
+ssize_t tls_stream::write(void const * data, std::size_t length)
+{
+    if (!d->established)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    int const rc = SSL_write(d->ssl, data, (length < INT_MAX) ? static_cast<int>(length) : INT_MAX);
+    if (0 < rc)
+    {
+        return rc;
+    }
+
+    return d->fail(rc, true);
+}
+
+ssize_t tls_stream::sendfile(int file, off_t offset, std::size_t size)
+{
+    if (!d->established)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    if (kernel_send())
+    {
+        ossl_ssize_t const rc = SSL_sendfile(d->ssl, file, offset, size, 0);
+        if (0 <= rc)
+        {
+            return rc;
+        }
+
+        return d->fail(static_cast<int>(rc), true);
+    }
+
+    char buffer[16 * 1024];
+    ssize_t const count = ::pread(file, buffer, (size < sizeof(buffer)) ? size : sizeof(buffer), offset);
+    if (0 >= count)
+    {
+        return count;
+    }
+
+    return write(buffer, static_cast<std::size_t>(count));
+}
+
+void tls_stream::shutdown()
+{
+    if (d->established)
+    {
+        SSL_shutdown(d->ssl);
+        ERR_clear_error();
+    }
+}
+
+}
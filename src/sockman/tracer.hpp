@@ -0,0 +1,74 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_TRACER_HPP
+#define SOCKMAN_TRACER_HPP
+
+#include "sockman/trace.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace sockman
+{
+
+class tracer
+{
+    tracer(tracer const &) = delete;
+    tracer& operator=(tracer const &) = delete;
+public:
+    tracer(std::size_t capacity, std::chrono::nanoseconds threshold, trace_callback callback)
+    : records(capacity)
+    , next(0)
+    , wrapped(false)
+    , slow_threshold(static_cast<uint64_t>(threshold.count()))
+    , on_slow(callback)
+    {
+    }
+
+    void add(trace_record const & record)
+    {
+        if (!records.empty())
+        {
+            records[next] = record;
+            next++;
+            if (next == records.size())
+            {
+                next = 0;
+                wrapped = true;
+            }
+        }
+
+        if ((record.duration >= slow_threshold) && (on_slow))
+        {
+            on_slow(record);
+        }
+    }
+
+    std::vector<trace_record> dump() const
+    {
+        std::vector<trace_record> result;
+        if (wrapped)
+        {
+            result.reserve(records.size());
+            result.insert(result.end(), records.begin() + next, records.end());
+        }
+        result.insert(result.end(), records.begin(), records.begin() + next);
+
+        return result;
+    }
+
+private:
+    std::vector<trace_record> records;
+    std::size_t next;
+    bool wrapped;
+    uint64_t slow_threshold;
+    trace_callback on_slow;
+};
+
+}
+
+#endif
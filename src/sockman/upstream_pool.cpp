@@ -0,0 +1,214 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/upstream_pool.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace sockman
+{
+
+upstream_pool::upstream_pool(manager & manager, upstream_pool_options const & options)
+: manager_(manager)
+, options_(options)
+, alive(std::make_shared<bool>(true))
+{
+
+}
+
+upstream_pool::~upstream_pool()
+{
+    // drops failures posted, but not yet reported
+    *alive = false;
+
+    for (auto & entry: upstreams)
+    {
+        for (auto const & connection: entry.second.idle)
+        {
+            manager_.cancel(connection.timer);
+            manager_.remove(connection.fd);
+            ::close(connection.fd);
+        }
+    }
+
+    for (int fd: connecting)
+    {
+        manager_.remove(fd);
+        ::close(fd);
+    }
+}
+
+void upstream_pool::add_upstream(std::string const & key, sockaddr const * address, socklen_t length)
+{
+    if (sizeof(sockaddr_storage) < length)
+    {
+        throw std::runtime_error("address too long");
+    }
+
+    auto & entry = upstreams[key];
+    memset(&entry.address, 0, sizeof(entry.address));
+    memcpy(&entry.address, address, length);
+    entry.length = length;
+}
+
+void upstream_pool::acquire(std::string const & key, connect_callback callback)
+{
+    auto it = upstreams.find(key);
+    if (it == upstreams.end())
+    {
+        throw std::runtime_error("unknown upstream");
+    }
+
+    auto & idle = it->second.idle;
+    if (!idle.empty())
+    {
+        auto const connection = idle.back();
+        idle.pop_back();
+        idle_keys.erase(connection.fd);
+        manager_.cancel(connection.timer);
+        manager_.remove(connection.fd);
+
+        callback(connection.fd, 0);
+        return;
+    }
+
+    if (connecting.size() < options_.max_concurrent_connects)
+    {
+        start_connect(key, std::move(callback));
+    }
+    else
+    {
+        queue.push_back({key, std::move(callback)});
+    }
+}
+
+void upstream_pool::release(std::string const & key, int fd, bool reusable)
+{
+    auto it = upstreams.find(key);
+    if ((!reusable) || (it == upstreams.end()) || (it->second.idle.size() >= options_.max_idle_per_upstream))
+    {
+        ::close(fd);
+        return;
+    }
+
+    manager_.add(fd, readable, [this](int sock, socket_events) {
+        // idle connections are not expected to receive anything
+        evict(sock);
+    });
+
+    timer_id timer = 0;
+    if (std::chrono::nanoseconds::zero() < options_.idle_timeout)
+    {
+        timer = manager_.schedule(manager_.now() + options_.idle_timeout, [this, fd]() {
+            evict(fd);
+        });
+    }
+
+    it->second.idle.push_back({fd, timer});
+    idle_keys[fd] = key;
+}
+
+std::size_t upstream_pool::idle_count(std::string const & key) const
+{
+    auto it = upstreams.find(key);
+    return (it != upstreams.end()) ? it->second.idle.size() : 0;
+}
+
+std::size_t upstream_pool::pending_connects() const
+{
+    return connecting.size();
+}
+
+void upstream_pool::start_connect(std::string const & key, connect_callback callback)
+{
+    auto const & entry = upstreams.at(key);
+
+    int const fd = ::socket(entry.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (0 > fd)
+    {
+        fail(std::move(callback), errno);
+        return;
+    }
+
+    try
+    {
+        manager_.connect(fd, reinterpret_cast<sockaddr const *>(&entry.address), entry.length,
+            [this, callback](int sock, int error) {
+                on_connected(sock, error, callback);
+            });
+    }
+    catch (...)
+    {
+        ::close(fd);
+        fail(std::move(callback), EINVAL);
+        return;
+    }
+
+    connecting.push_back(fd);
+}
+
+void upstream_pool::on_connected(int fd, int error, connect_callback const & callback)
+{
+    connecting.erase(std::remove(connecting.begin(), connecting.end(), fd), connecting.end());
+
+    if (0 != error)
+    {
+        ::close(fd);
+        callback(-1, error);
+    }
+    else
+    {
+        callback(fd, 0);
+    }
+
+    while ((!queue.empty()) && (connecting.size() < options_.max_concurrent_connects))
+    {
+        auto next = std::move(queue.front());
+        queue.pop_front();
+        acquire(next.key, std::move(next.callback));
+    }
+}
+
+void upstream_pool::evict(int fd)
+{
+    auto it = idle_keys.find(fd);
+    if (it != idle_keys.end())
+    {
+        auto & idle = upstreams[it->second].idle;
+        auto const connection = std::find_if(idle.begin(), idle.end(), [fd](idle_connection const & entry) {
+            return entry.fd == fd;
+        });
+        if (connection != idle.end())
+        {
+            manager_.cancel(connection->timer);
+            idle.erase(connection);
+        }
+        idle_keys.erase(it);
+    }
+
+    manager_.remove(fd);
+    ::close(fd);
+}
+
+void upstream_pool::fail(connect_callback callback, int error)
+{
+    // like manager::connect, failures are never reported synchronously
+    std::weak_ptr<bool> const token = alive;
+    manager_.post([token, callback, error]() {
+        auto const pool = token.lock();
+        if ((pool) && (*pool))
+        {
+            callback(-1, error);
+        }
+    });
+}
+
+}
@@ -0,0 +1,135 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/worker_pool.hpp"
+
+namespace sockman
+{
+
+namespace
+{
+
+// identifies the pool and queue of the calling worker thread
+thread_local worker_pool const * current_pool = nullptr;
+thread_local std::size_t current_index = 0;
+
+}
+
+worker_pool::worker_pool(std::size_t threads)
+: pending(0)
+, next(0)
+, stopping(false)
+{
+    if (0 == threads)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (0 == threads)
+    {
+        threads = 1;
+    }
+
+    for (std::size_t i = 0; i < threads; i++)
+    {
+        queues.emplace_back(new task_queue());
+    }
+
+    for (std::size_t i = 0; i < threads; i++)
+    {
+        workers.emplace_back([this, i]() { run(i); });
+    }
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+
+    for (auto & worker: workers)
+    {
+        worker.join();
+    }
+}
+
+void worker_pool::submit(std::function<void()> task)
+{
+    {
+        // counted first, so pending never drops below the number of queued tasks;
+        // the lock avoids a lost wakeup of a worker about to sleep
+        std::lock_guard<std::mutex> lock(mutex);
+        pending++;
+    }
+
+    std::size_t const index = (this == current_pool) ? current_index : (next++ % queues.size());
+    {
+        auto & queue = *(queues[index]);
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    wakeup.notify_one();
+}
+
+std::size_t worker_pool::size() const
+{
+    return workers.size();
+}
+
+void worker_pool::run(std::size_t index)
+{
+    current_pool = this;
+    current_index = index;
+
+    while (true)
+    {
+        std::function<void()> task;
+        if (take(index, task))
+        {
+            pending--;
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this]() { return (0 < pending) || stopping; });
+        if ((stopping) && (0 == pending))
+        {
+            break;
+        }
+    }
+}
+
+bool worker_pool::take(std::size_t index, std::function<void()> & task)
+{
+    {
+        auto & own = *(queues[index]);
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (std::size_t i = 1; i < queues.size(); i++)
+    {
+        auto & victim = *(queues[(index + i) % queues.size()]);
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
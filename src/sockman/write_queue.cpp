@@ -0,0 +1,155 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/write_queue.hpp"
+
+#include <cstring>
+
+namespace sockman
+{
+
+namespace
+{
+
+// consumed segments are compacted once this many are at the front
+constexpr std::size_t const compact_threshold = 32;
+
+}
+
+constexpr std::size_t const write_queue::coalesce_limit;
+
+write_queue::write_queue()
+: head(0)
+, offset(0)
+, size_(0)
+{
+
+}
+
+bool write_queue::empty() const
+{
+    return (0 == size_);
+}
+
+std::size_t write_queue::size() const
+{
+    return size_;
+}
+
+void write_queue::append(buffer_pool & pool, void const * data, std::size_t length)
+{
+    if (0 == length)
+    {
+        return;
+    }
+
+    // the last segment may only be extended if it is not shared
+    bool const extend = (head < segments.size())
+        && (1 == segments.back().use_count())
+        && ((segments.back().size() + length) <= segments.back().capacity())
+        && ((segments.back().size() + length) <= coalesce_limit);
+
+    if (extend)
+    {
+        buffer & last = segments.back();
+        std::size_t const used = last.size();
+        last.resize(used + length);
+        std::memcpy(last.data() + used, data, length);
+    }
+    else
+    {
+        buffer segment = pool.allocate((length < coalesce_limit) ? coalesce_limit : length);
+        std::memcpy(segment.data(), data, length);
+        segment.resize(length);
+        segments.push_back(std::move(segment));
+    }
+
+    size_ += length;
+}
+
+void write_queue::append(buffer const & data)
+{
+    if (0 == data.size())
+    {
+        return;
+    }
+
+    segments.push_back(data);
+    size_ += data.size();
+}
+
+int write_queue::prepare(iovec * iov, int max_count) const
+{
+    int count = 0;
+    std::size_t skip = offset;
+    for (std::size_t i = head; (i < segments.size()) && (count < max_count); i++)
+    {
+        iov[count].iov_base = const_cast<char *>(segments[i].data() + skip);
+        iov[count].iov_len = segments[i].size() - skip;
+        skip = 0;
+        count++;
+    }
+
+    return count;
+}
+
+void write_queue::consume(std::size_t length)
+{
+    if (length >= size_)
+    {
+        clear();
+        return;
+    }
+
+    size_ -= length;
+    while (0 < length)
+    {
+        std::size_t const available = segments[head].size() - offset;
+        if (length < available)
+        {
+            offset += length;
+            length = 0;
+        }
+        else
+        {
+            length -= available;
+            offset = 0;
+            segments[head] = buffer();
+            head++;
+        }
+    }
+
+    if (head >= compact_threshold)
+    {
+        segments.erase(segments.begin(), segments.begin() + head);
+        head = 0;
+    }
+}
+
+void write_queue::clear()
+{
+    segments.clear();
+    head = 0;
+    offset = 0;
+    size_ = 0;
+}
+
+std::string write_queue::contents() const
+{
+    std::string result;
+    result.reserve(size_);
+
+    std::size_t skip = offset;
+    for (std::size_t i = head; i < segments.size(); i++)
+    {
+        result.append(segments[i].data() + skip, segments[i].size() - skip);
+        skip = 0;
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_WRITE_QUEUE_HPP
+#define SOCKMAN_WRITE_QUEUE_HPP
+
+#include "sockman/buffer.hpp"
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sockman
+{
+
+/// Queue of pending output of a single socket.
+///
+/// Segments are pooled buffers. Small writes are copied into the
+/// spare capacity of the last segment, so a flush needs only a few
+/// iovec entries; buffers are queued by reference without copying.
+class write_queue
+{
+public:
+    static constexpr std::size_t const coalesce_limit = 4096;
+
+    write_queue();
+
+    bool empty() const;
+    std::size_t size() const;
+
+    /// Copies data into the queue, using buffers of pool.
+    void append(buffer_pool & pool, void const * data, std::size_t length);
+
+    /// Queues a buffer without copying.
+    void append(buffer const & data);
+
+    /// Fills iov with the pending segments.
+    /// Returns the number of used entries.
+    int prepare(iovec * iov, int max_count) const;
+
+    /// Removes length bytes from the front.
+    void consume(std::size_t length);
+
+    void clear();
+
+    /// Returns a copy of the pending data.
+    std::string contents() const;
+
+private:
+    std::vector<buffer> segments;
+    std::size_t head;
+    std::size_t offset;
+    std::size_t size_;
+};
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/affinity.hpp"
+#include "sockman/sockman.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sched.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <stdexcept>
+
+namespace
+{
+
+int first_allowed_cpu()
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    sched_getaffinity(0, sizeof(cpus), &cpus);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &cpus))
+        {
+            return cpu;
+        }
+    }
+
+    throw std::runtime_error("no cpu allowed");
+}
+
+class tcp_socket
+{
+public:
+    tcp_socket()
+    : fd(::socket(AF_INET, SOCK_STREAM, 0))
+    {
+        if (0 > fd)
+        {
+            throw std::runtime_error("failed to create socket");
+        }
+    }
+
+    ~tcp_socket()
+    {
+        ::close(fd);
+    }
+
+    int fd;
+};
+
+}
+
+TEST(affinity, pin_thread_to_cpu)
+{
+    cpu_set_t original;
+    sched_getaffinity(0, sizeof(original), &original);
+
+    int const cpu = first_allowed_cpu();
+    sockman::pin_thread_to_cpu(cpu);
+    ASSERT_EQ(cpu, sched_getcpu());
+
+    sched_setaffinity(0, sizeof(original), &original);
+}
+
+TEST(affinity, pin_thread_to_invalid_cpu_fails)
+{
+    ASSERT_THROW({
+        sockman::pin_thread_to_cpu(-1);
+    }, std::exception);
+}
+
+TEST(affinity, numa_node_of_invalid_cpu)
+{
+    ASSERT_EQ(-1, sockman::numa_node_of_cpu(-1));
+}
+
+TEST(affinity, set_incoming_cpu)
+{
+    tcp_socket sock;
+    sockman::set_incoming_cpu(sock.fd, first_allowed_cpu());
+
+    int cpu = -1;
+    socklen_t length = sizeof(cpu);
+    getsockopt(sock.fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &length);
+    ASSERT_EQ(first_allowed_cpu(), cpu);
+}
+
+TEST(affinity, steer_reuseport_by_cpu)
+{
+    tcp_socket sock;
+    int const enable = 1;
+    setsockopt(sock.fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, ::bind(sock.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+
+    sockman::steer_reuseport_by_cpu(sock.fd, 2);
+}
+
+TEST(affinity, steer_reuseport_by_cpu_fails_with_empty_group)
+{
+    tcp_socket sock;
+
+    ASSERT_THROW({
+        sockman::steer_reuseport_by_cpu(sock.fd, 0);
+    }, std::exception);
+}
+
+TEST(affinity, manager_set_cpu_affinity)
+{
+    cpu_set_t original;
+    sched_getaffinity(0, sizeof(original), &original);
+
+    sockman::manager manager;
+    manager.set_cpu_affinity(first_allowed_cpu());
+    int fds[2];
+    ASSERT_EQ(0, ::socketpair(AF_LOCAL, SOCK_STREAM, 0, fds));
+    manager.add(fds[0], 0, [](int, sockman::socket_events){});
+    manager.remove(fds[0]);
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+    sched_setaffinity(0, sizeof(original), &original);
+}
@@ -0,0 +1,291 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/basic_manager.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using sockman_test::socket_pair;
+
+namespace
+{
+
+int calls = 0;
+
+void count_call(int fd, sockman::socket_events events)
+{
+    (void) fd;
+    (void) events;
+    calls++;
+}
+
+struct simulated_policy
+{
+    using backend_type = sockman::dynamic_backend;
+    using storage_type = sockman::fixed_storage<64>;
+    using callback_type = void (*)(int, sockman::socket_events);
+    using threading = sockman::single_thread;
+    using instrumentation_type = sockman::counting_instrumentation;
+};
+
+using simulated_manager = sockman::basic_manager<simulated_policy>;
+
+struct simulation: public sockman_test::basic_simulation<simulated_manager>
+{
+    simulation()
+    {
+        calls = 0;
+    }
+};
+
+simulated_manager * current = nullptr;
+
+void replace_second(int fd, sockman::socket_events events)
+{
+    (void) fd;
+    (void) events;
+    current->remove(2);
+    current->add(2, sockman::readable, &count_call);
+    calls += 10;
+}
+
+struct synchronized_policy: public sockman::default_policy
+{
+    using threading = sockman::synchronized;
+};
+
+struct simulated_function_policy: public sockman::default_policy
+{
+    using backend_type = sockman::dynamic_backend;
+};
+
+using simulated_function_manager = sockman::basic_manager<simulated_function_policy>;
+
+}
+
+TEST(basic_manager, dispatch_with_simulated_backend)
+{
+    simulation sim;
+
+    sim.manager.add(42, sockman::readable, &count_call);
+    sim.backend->trigger(42, EPOLLIN);
+    sim.manager.service(0);
+    ASSERT_EQ(1, calls);
+    ASSERT_EQ(1, sim.manager.instrumentation().events);
+    ASSERT_EQ(1, sim.manager.instrumentation().waits);
+
+    sim.manager.notify_on_readable(42, false);
+    sim.backend->set_ready(42, EPOLLIN);
+    sim.manager.service(0);
+    ASSERT_EQ(1, calls);
+
+    sim.manager.remove(42);
+    ASSERT_EQ(0, sim.backend->interest(42));
+    ASSERT_THROW(sim.manager.notify_on_readable(42), std::runtime_error);
+}
+
+TEST(basic_manager, fail_to_add_socket_beyond_fixed_capacity)
+{
+    simulation sim;
+    ASSERT_THROW(sim.manager.add(64, sockman::readable, &count_call), std::runtime_error);
+    ASSERT_THROW(sim.manager.add(-1, sockman::readable, &count_call), std::runtime_error);
+}
+
+TEST(basic_manager, find_and_enumerate_sockets)
+{
+    simulation sim;
+
+    // the eventfd is registered with the backend, but is not a socket
+    int const wake_fd = sim.manager.wakeup_handle();
+    sim.manager.add(41, sockman::readable, &count_call);
+    sim.manager.add(42, sockman::readable, &replace_second);
+    sim.manager.add(43, sockman::readable, &count_call);
+    sim.manager.remove(43);
+
+    ASSERT_NE(nullptr, sim.manager.find(41));
+    ASSERT_EQ(&replace_second, *(sim.manager.find(42)));
+    ASSERT_EQ(nullptr, sim.manager.find(43));
+    ASSERT_EQ(nullptr, sim.manager.find(64));
+
+    std::vector<int> sockets;
+    sim.manager.for_each([&sockets](int fd, simulated_policy::callback_type &) {
+        sockets.push_back(fd);
+    });
+    ASSERT_EQ((std::vector<int>{41, 42}), sockets);
+    ASSERT_EQ(nullptr, sim.manager.find(wake_fd));
+}
+
+TEST(basic_manager, drop_events_of_removed_socket)
+{
+    simulation sim;
+    current = &sim.manager;
+
+    // both are reported in the same batch; the first replaces the second
+    sim.manager.add(1, sockman::readable, &replace_second);
+    sim.manager.add(2, sockman::readable, &count_call);
+    sim.backend->trigger(1, EPOLLIN);
+    sim.backend->trigger(2, EPOLLIN);
+
+    sim.manager.service(0);
+    ASSERT_EQ(10, calls);
+}
+
+TEST(basic_manager, remove_and_replace_running_callback)
+{
+    sockman::default_manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    std::vector<std::string> log;
+    std::shared_ptr<int> token = std::make_shared<int>(0);
+
+    manager.add(pair.fds[0], sockman::readable, [&, token](int fd, auto) {
+        char c;
+        ASSERT_EQ(1, ::read(fd, &c, 1));
+        manager.remove(fd);
+        manager.add(fd, sockman::readable, [&](int fd, auto) {
+            char c;
+            ASSERT_EQ(1, ::read(fd, &c, 1));
+            log.push_back("second");
+        });
+        // captures are still alive while the callback runs
+        ASSERT_EQ(0, *token);
+        log.push_back("first");
+    });
+
+    char const data[2] = {'a', 'b'};
+    ASSERT_EQ(1, ::write(pair.fds[1], &data[0], 1));
+    manager.service(0);
+    ASSERT_EQ(1, token.use_count());
+
+    ASSERT_EQ(1, ::write(pair.fds[1], &data[1], 1));
+    manager.service(0);
+    ASSERT_EQ((std::vector<std::string>{"first", "second"}), log);
+}
+
+TEST(basic_manager, remove_running_callback)
+{
+    sockman::default_manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    std::shared_ptr<int> token = std::make_shared<int>(0);
+
+    manager.add(pair.fds[0], sockman::readable, [&manager, token](int fd, auto) {
+        manager.remove(fd);
+        ASSERT_EQ(0, *token);
+    });
+
+    char const c = 'x';
+    ASSERT_EQ(1, ::write(pair.fds[1], &c, 1));
+    manager.service(0);
+    ASSERT_EQ(1, token.use_count());
+}
+
+TEST(basic_manager, stop_from_other_thread)
+{
+    sockman::basic_manager<synchronized_policy> manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    bool received = false;
+
+    std::thread thread([&]() {
+        manager.add(pair.fds[0], sockman::readable, [&](int fd, auto) {
+            char c;
+            ASSERT_EQ(1, ::read(fd, &c, 1));
+            received = true;
+            manager.stop();
+        });
+
+        char const c = 'x';
+        ASSERT_EQ(1, ::write(pair.fds[1], &c, 1));
+    });
+
+    manager.run();
+    thread.join();
+    ASSERT_TRUE(received);
+}
+
+TEST(basic_manager, replace_running_callback_from_nested_dispatch)
+{
+    sockman_test::basic_simulation<simulated_function_manager> sim;
+    std::vector<std::string> log;
+    std::shared_ptr<int> token = std::make_shared<int>(0);
+
+    sim.manager.add(1, sockman::readable, [&, token](int, auto) {
+        sim.backend->trigger(2, EPOLLIN);
+        sim.manager.service(0);
+
+        // captures are still alive after the nested dispatch replaced the callback
+        ASSERT_EQ(0, *token);
+        log.push_back("first");
+    });
+    sim.manager.add(2, sockman::readable, [&](int, auto) {
+        sim.manager.add(1, sockman::readable, [&](int, auto) { log.push_back("replaced"); });
+        log.push_back("second");
+    });
+
+    sim.backend->trigger(1, EPOLLIN);
+    sim.manager.service(0);
+    ASSERT_EQ(1, token.use_count());
+
+    sim.backend->trigger(1, EPOLLIN);
+    sim.manager.service(0);
+    ASSERT_EQ((std::vector<std::string>{"second", "first", "replaced"}), log);
+}
+
+TEST(basic_manager, nested_dispatch_keeps_replacements_apart)
+{
+    sockman_test::basic_simulation<simulated_function_manager> sim;
+    std::vector<std::string> log;
+
+    sim.manager.add(1, sockman::readable, [&](int, auto) {
+        sim.manager.add(1, sockman::readable, [&](int, auto) { log.push_back("replaced 1"); });
+        sim.backend->trigger(2, EPOLLIN);
+        sim.manager.service(0);
+    });
+    sim.manager.add(2, sockman::readable, [&](int, auto) {
+        log.push_back("2");
+    });
+
+    sim.backend->trigger(1, EPOLLIN);
+    sim.manager.service(0);
+
+    sim.backend->trigger(2, EPOLLIN);
+    sim.manager.service(0);
+    sim.backend->trigger(1, EPOLLIN);
+    sim.manager.service(0);
+    ASSERT_EQ((std::vector<std::string>{"2", "2", "replaced 1"}), log);
+}
+
+TEST(basic_manager, add_reused_descriptor)
+{
+    sockman::default_manager manager;
+    socket_pair first(SOCK_NONBLOCK);
+    socket_pair second(SOCK_NONBLOCK);
+    int const fd = first.fds[0];
+    bool received = false;
+
+    manager.add(fd, sockman::readable, [](int, auto) { });
+
+    // closed without being removed, so epoll forgot the descriptor
+    first.close(0);
+    ASSERT_EQ(fd, ::dup2(second.fds[0], fd));
+
+    manager.add(fd, sockman::readable, [&](int, auto) { received = true; });
+    char const c = 'x';
+    ASSERT_EQ(1, ::write(second.fds[1], &c, 1));
+    manager.service(0);
+    ASSERT_TRUE(received);
+
+    manager.remove(fd);
+    ::close(fd);
+}
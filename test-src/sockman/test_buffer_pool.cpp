@@ -0,0 +1,210 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+
+using sockman_test::socket_pair;
+
+namespace
+{
+
+// counting is limited to the scope of an allocation_counter, so other
+// tests in the binary are not affected
+std::atomic<bool> counting(false);
+std::atomic<std::size_t> allocations(0);
+
+class allocation_counter
+{
+    allocation_counter(allocation_counter const &) = delete;
+    allocation_counter& operator=(allocation_counter const &) = delete;
+public:
+    allocation_counter()
+    {
+        allocations = 0;
+        counting = true;
+    }
+
+    ~allocation_counter()
+    {
+        counting = false;
+    }
+
+    std::size_t count() const
+    {
+        return allocations;
+    }
+};
+
+}
+
+void * operator new(std::size_t size)
+{
+    if (counting)
+    {
+        allocations++;
+    }
+    void * const memory = std::malloc((0 < size) ? size : 1);
+    if (nullptr == memory)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(void * memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void * memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+TEST(buffer_pool, allocate)
+{
+    sockman::buffer_pool pool;
+
+    auto buffer = pool.allocate(42);
+    ASSERT_TRUE(static_cast<bool>(buffer));
+    ASSERT_EQ(42, buffer.size());
+    ASSERT_EQ(64, buffer.capacity());
+    ASSERT_EQ(1, buffer.use_count());
+    ASSERT_EQ(1, pool.chunk_count());
+}
+
+TEST(buffer_pool, rounds_up_to_power_of_two)
+{
+    sockman::buffer_pool pool;
+
+    ASSERT_EQ(64, pool.allocate(0).capacity());
+    ASSERT_EQ(128, pool.allocate(65).capacity());
+    ASSERT_EQ(4096, pool.allocate(4096).capacity());
+    ASSERT_EQ(8192, pool.allocate(4097).capacity());
+}
+
+TEST(buffer_pool, recycles_released_buffers)
+{
+    sockman::buffer_pool pool;
+
+    char const * first = pool.allocate(100).data();
+    auto second = pool.allocate(100);
+
+    ASSERT_EQ(first, second.data());
+}
+
+TEST(buffer_pool, copies_share_memory)
+{
+    sockman::buffer_pool pool;
+
+    auto buffer = pool.allocate(3);
+    std::memcpy(buffer.data(), "foo", 3);
+    {
+        auto copy = buffer;
+        ASSERT_EQ(buffer.data(), copy.data());
+        ASSERT_EQ(2, buffer.use_count());
+    }
+    ASSERT_EQ(1, buffer.use_count());
+
+    auto moved = std::move(buffer);
+    ASSERT_FALSE(static_cast<bool>(buffer));
+    ASSERT_EQ(1, moved.use_count());
+    ASSERT_EQ("foo", std::string(moved.data(), moved.size()));
+}
+
+TEST(buffer_pool, large_buffers_are_not_pooled)
+{
+    sockman::buffer_pool pool;
+
+    auto buffer = pool.allocate(sockman::buffer_pool::max_size + 1);
+    ASSERT_EQ(sockman::buffer_pool::max_size + 1, buffer.capacity());
+    ASSERT_EQ(0, pool.chunk_count());
+}
+
+TEST(buffer_pool, buffers_may_outlive_pool)
+{
+    sockman::buffer buffer;
+    {
+        sockman::buffer_pool pool;
+        buffer = pool.allocate(10);
+    }
+
+    std::memset(buffer.data(), 0, buffer.size());
+}
+
+TEST(buffer_pool, numa_node_preference)
+{
+    sockman::buffer_pool pool;
+    pool.set_numa_node(0);
+
+    auto buffer = pool.allocate(10);
+    ASSERT_EQ(10, buffer.size());
+}
+
+TEST(buffer_pool, steady_state_does_not_allocate)
+{
+    socket_pair pair;
+
+    sockman::manager manager;
+    bool corked = false;
+    manager.add(pair.fds[0], sockman::writable, [&](int sock, sockman::socket_events) {
+        // output of callbacks is gathered and written at the end of dispatch
+        auto message = manager.buffers().allocate(5);
+        std::memcpy(message.data(), "hello", 5);
+        manager.send(sock, message);
+        manager.send(sock, " world", 6);
+        manager.notify_on_writable(sock, false);
+        corked = true;
+    });
+
+    char received[11];
+    auto exchange = [&]() {
+        manager.notify_on_writable(pair.fds[0], true);
+        manager.service(0);
+        if (11 != ::read(pair.fds[1], received, 11))
+        {
+            corked = false;
+        }
+    };
+
+    for (int i = 0; i < 10; i++)
+    {
+        exchange();
+    }
+    ASSERT_TRUE(corked);
+    std::size_t const chunks = manager.buffers().chunk_count();
+    std::size_t const cached = manager.buffers().free_count();
+
+    std::size_t allocated = 0;
+    {
+        allocation_counter counter;
+        for (int i = 0; i < 1000; i++)
+        {
+            exchange();
+        }
+        allocated = counter.count();
+    }
+
+    ASSERT_TRUE(corked);
+    ASSERT_EQ(0, allocated);
+    ASSERT_EQ(chunks, manager.buffers().chunk_count());
+    ASSERT_EQ(cached, manager.buffers().free_count());
+
+    manager.remove(pair.fds[0]);
+}
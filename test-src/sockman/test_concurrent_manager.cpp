@@ -0,0 +1,298 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/concurrent_manager.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using sockman_test::socket_pair;
+
+namespace
+{
+
+constexpr std::size_t const thread_count = 4;
+
+class thread_pool
+{
+public:
+    explicit thread_pool(sockman::concurrent_manager & manager)
+    : started(0)
+    {
+        for (std::size_t i = 0; i < thread_count; i++)
+        {
+            threads.emplace_back([this, &manager]() {
+                started++;
+                manager.run();
+            });
+        }
+    }
+
+    ~thread_pool()
+    {
+        for (auto & thread: threads)
+        {
+            thread.join();
+        }
+    }
+
+    // a stop issued before a thread entered run is consumed by the
+    // first thread returning, so give all threads time to enter
+    void wait_started()
+    {
+        while (thread_count != started)
+        {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+private:
+    std::atomic<std::size_t> started;
+    std::vector<std::thread> threads;
+};
+
+template <typename Predicate>
+bool wait_for(Predicate predicate)
+{
+    for (int i = 0; i < 5000; i++)
+    {
+        if (predicate())
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return predicate();
+}
+
+}
+
+TEST(concurrent_manager, dispatch_sockets_on_multiple_threads)
+{
+    constexpr std::size_t const socket_count = 32;
+    constexpr std::size_t const messages = 100;
+
+    sockman::concurrent_manager manager;
+    std::vector<std::unique_ptr<socket_pair>> pairs;
+    std::unique_ptr<std::atomic<bool>[]> busy(new std::atomic<bool>[socket_count]);
+    std::atomic<std::size_t> received(0);
+    std::atomic<bool> overlapped(false);
+
+    for (std::size_t i = 0; i < socket_count; i++)
+    {
+        pairs.emplace_back(new socket_pair(SOCK_NONBLOCK));
+        busy[i] = false;
+        manager.add(pairs[i]->fds[0], sockman::readable, [&, i](int fd, auto) {
+            if (busy[i].exchange(true))
+            {
+                overlapped = true;
+            }
+
+            // read a single byte, so the socket stays readable
+            char c;
+            if (1 == ::read(fd, &c, 1))
+            {
+                received++;
+            }
+            std::this_thread::yield();
+            busy[i] = false;
+        });
+    }
+
+    {
+        thread_pool pool(manager);
+        for (std::size_t n = 0; n < messages; n++)
+        {
+            for (auto & pair: pairs)
+            {
+                char const c = 'x';
+                ASSERT_EQ(1, ::write(pair->fds[1], &c, 1));
+            }
+        }
+
+        ASSERT_TRUE(wait_for([&]() { return (socket_count * messages) == received; }));
+        pool.wait_started();
+        manager.stop();
+    }
+
+    ASSERT_FALSE(overlapped);
+    for (auto & pair: pairs)
+    {
+        manager.remove(pair->fds[0]);
+    }
+}
+
+TEST(concurrent_manager, reclaim_after_running_callback)
+{
+    sockman::concurrent_manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    std::promise<void> entered;
+    std::promise<void> release;
+    std::shared_future<void> released(release.get_future());
+
+    manager.add(pair.fds[0], sockman::readable, [&](int fd, auto) {
+        char c;
+        ASSERT_EQ(1, ::read(fd, &c, 1));
+        entered.set_value();
+        released.wait();
+    });
+
+    std::thread worker([&manager]() { manager.service(-1); });
+
+    char const c = 'x';
+    ASSERT_EQ(1, ::write(pair.fds[1], &c, 1));
+    entered.get_future().wait();
+
+    manager.remove(pair.fds[0]);
+    ASSERT_EQ(1, manager.pending_reclamation());
+
+    release.set_value();
+    worker.join();
+    ASSERT_EQ(0, manager.pending_reclamation());
+}
+
+TEST(concurrent_manager, enable_writable_from_callback)
+{
+    sockman::concurrent_manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    std::atomic<int> writable(0);
+
+    manager.add(pair.fds[0], sockman::readable, [&](int fd, auto events) {
+        if (events.readable())
+        {
+            char c;
+            ASSERT_EQ(1, ::read(fd, &c, 1));
+            manager.notify_on_writable(fd);
+        }
+        if (events.writable())
+        {
+            writable++;
+            manager.notify_on_writable(fd, false);
+        }
+    });
+
+    char const c = 'x';
+    ASSERT_EQ(1, ::write(pair.fds[1], &c, 1));
+    manager.service(0);
+    manager.service(0);
+    manager.service(0);
+
+    ASSERT_EQ(1, writable);
+}
+
+TEST(concurrent_manager, throwing_callback_does_not_stall_batch)
+{
+    sockman::concurrent_manager manager;
+    socket_pair first(SOCK_NONBLOCK);
+    socket_pair second(SOCK_NONBLOCK);
+    bool thrown = false;
+    int calls[2] = {0, 0};
+
+    // the data is never read, so both sockets stay readable
+    auto const callback = [&](int index) {
+        return [&, index](int, auto) {
+            if (!thrown)
+            {
+                thrown = true;
+                throw std::runtime_error("fail");
+            }
+            calls[index]++;
+        };
+    };
+    manager.add(first.fds[0], sockman::readable, callback(0));
+    manager.add(second.fds[0], sockman::readable, callback(1));
+
+    char const c = 'x';
+    ASSERT_EQ(1, ::write(first.fds[1], &c, 1));
+    ASSERT_EQ(1, ::write(second.fds[1], &c, 1));
+    ASSERT_THROW(manager.service(0), std::runtime_error);
+
+    manager.service(0);
+    manager.service(0);
+
+    ASSERT_LT(0, calls[0]);
+    ASSERT_LT(0, calls[1]);
+}
+
+TEST(concurrent_manager, stop_wakes_all_threads)
+{
+    sockman::concurrent_manager manager;
+    {
+        thread_pool pool(manager);
+        pool.wait_started();
+        manager.stop();
+    }
+
+    // the manager can be run again
+    {
+        thread_pool pool(manager);
+        pool.wait_started();
+        manager.stop();
+    }
+}
+
+TEST(concurrent_manager, add_and_remove_while_running)
+{
+    constexpr std::size_t const socket_count = 16;
+    constexpr std::size_t const rounds = 200;
+
+    sockman::concurrent_manager manager;
+    std::vector<std::unique_ptr<socket_pair>> pairs;
+    for (std::size_t i = 0; i < socket_count; i++)
+    {
+        pairs.emplace_back(new socket_pair(SOCK_NONBLOCK));
+    }
+
+    std::atomic<std::size_t> calls(0);
+    {
+        thread_pool pool(manager);
+        for (std::size_t round = 0; round < rounds; round++)
+        {
+            for (auto & pair: pairs)
+            {
+                manager.add(pair->fds[0], sockman::readable, [&calls](int fd, auto) {
+                    char buffer[16];
+                    while (0 < ::read(fd, buffer, sizeof(buffer)))
+                    {
+                    }
+                    calls++;
+                });
+
+                char const c = 'x';
+                ASSERT_EQ(1, ::write(pair->fds[1], &c, 1));
+            }
+
+            for (auto & pair: pairs)
+            {
+                manager.remove(pair->fds[0]);
+            }
+        }
+        pool.wait_started();
+        manager.stop();
+    }
+
+    manager.service(0);
+    ASSERT_EQ(0, manager.pending_reclamation());
+}
+
+TEST(concurrent_manager, fail_to_modify_unknown_socket)
+{
+    sockman::concurrent_manager manager;
+    ASSERT_THROW(manager.notify_on_readable(42), std::runtime_error);
+    ASSERT_THROW(manager.notify_on_writable(42, false), std::runtime_error);
+    ASSERT_NO_THROW(manager.remove(42));
+}
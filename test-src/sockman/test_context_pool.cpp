@@ -0,0 +1,56 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/context_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(context_pool, create)
+{
+    sockman::context_pool pool;
+
+    auto context = pool.create(42, EPOLLIN, [](int, sockman::socket_events){});
+    ASSERT_EQ(42, context->fd);
+    ASSERT_EQ(EPOLLIN, context->events);
+    ASSERT_FALSE(context->removed);
+    ASSERT_EQ(1, pool.chunk_count());
+}
+
+TEST(context_pool, reuses_released_contexts)
+{
+    sockman::context_pool pool;
+
+    {
+        auto * first = pool.create(1, 0, nullptr).get();
+        auto second = pool.create(2, 0, nullptr);
+
+        ASSERT_EQ(first, second.get());
+    }
+}
+
+TEST(context_pool, grows_by_chunks)
+{
+    sockman::context_pool pool;
+    std::vector<sockman::context_ptr> contexts;
+
+    for (std::size_t i = 0; i <= sockman::context_pool::contexts_per_chunk; i++)
+    {
+        contexts.push_back(pool.create(static_cast<int>(i), 0, nullptr));
+    }
+
+    ASSERT_EQ(2, pool.chunk_count());
+}
+
+TEST(context_pool, numa_node_preference)
+{
+    sockman::context_pool pool;
+    pool.set_numa_node(0);
+
+    auto context = pool.create(42, 0, nullptr);
+    ASSERT_EQ(42, context->fd);
+}
@@ -0,0 +1,188 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+class reader: public sockman::event_handler<reader>
+{
+public:
+    explicit reader(sockman::manager & manager)
+    : manager_(manager)
+    {
+    }
+
+    void on_readable(int fd)
+    {
+        char buffer[16];
+        auto const count = ::read(fd, buffer, sizeof(buffer));
+        if (0 < count)
+        {
+            received.append(buffer, static_cast<std::size_t>(count));
+        }
+    }
+
+    void on_close(int fd)
+    {
+        closed = true;
+        manager_.remove(fd);
+    }
+
+    sockman::manager & manager_;
+    std::string received;
+    bool closed = false;
+};
+
+class writer: public sockman::event_handler<writer>
+{
+public:
+    void on_writable(int)
+    {
+        writable++;
+    }
+
+    int writable = 0;
+};
+
+class closing_reader: public sockman::event_handler<closing_reader>
+{
+public:
+    explicit closing_reader(sockman::manager & manager)
+    : manager_(manager)
+    {
+    }
+
+    void on_readable(int fd)
+    {
+        readable++;
+        manager_.remove(fd);
+    }
+
+    void on_close(int)
+    {
+        closed++;
+    }
+
+    sockman::manager & manager_;
+    int readable = 0;
+    int closed = 0;
+};
+
+class error_handler: public sockman::event_handler<error_handler>
+{
+public:
+    void on_close(int)
+    {
+        closed++;
+    }
+
+    void on_error(int)
+    {
+        errors++;
+    }
+
+    int closed = 0;
+    int errors = 0;
+};
+
+// far above the descriptor limit, so no real descriptor is hit
+constexpr int const simulated_fd = 1000000;
+
+}
+
+TEST(event_handler, traits)
+{
+    using reader_traits = sockman::handler_traits<reader>;
+    static_assert(reader_traits::has_readable, "");
+    static_assert(!reader_traits::has_writable, "");
+    static_assert(reader_traits::has_close, "");
+    static_assert(!reader_traits::has_error, "");
+    ASSERT_EQ(EPOLLIN | EPOLLRDHUP, reader_traits::events);
+
+    ASSERT_EQ(0, sockman::handler_traits<writer>::events);
+}
+
+TEST(event_handler, read_and_close)
+{
+    int fds[2];
+    ASSERT_EQ(0, ::socketpair(AF_LOCAL, SOCK_STREAM, 0, fds));
+
+    sockman::manager manager;
+    reader handler(manager);
+    manager.add(fds[0], handler);
+
+    ASSERT_EQ(3, ::write(fds[1], "foo", 3));
+    manager.service(0);
+    ASSERT_EQ("foo", handler.received);
+    ASSERT_FALSE(handler.closed);
+
+    ::shutdown(fds[1], SHUT_WR);
+    manager.service(0);
+    ASSERT_TRUE(handler.closed);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST(event_handler, writable)
+{
+    auto * backend = new sockman::simulated_backend();
+    sockman::manager manager{std::unique_ptr<sockman::backend>(backend)};
+    writer handler;
+
+    manager.add(simulated_fd, handler);
+    ASSERT_EQ(0, backend->interest(simulated_fd));
+
+    backend->set_ready(simulated_fd, EPOLLOUT);
+    manager.service(0);
+    ASSERT_EQ(0, handler.writable);
+
+    manager.notify_on_writable(simulated_fd, true);
+    manager.service(0);
+    ASSERT_EQ(1, handler.writable);
+}
+
+TEST(event_handler, no_handler_after_remove)
+{
+    auto * backend = new sockman::simulated_backend();
+    sockman::manager manager{std::unique_ptr<sockman::backend>(backend)};
+    closing_reader handler(manager);
+
+    manager.add(simulated_fd, handler);
+    backend->trigger(simulated_fd, EPOLLIN | EPOLLRDHUP);
+    manager.service(0);
+
+    ASSERT_EQ(1, handler.readable);
+    ASSERT_EQ(0, handler.closed);
+}
+
+TEST(event_handler, error_replaces_close)
+{
+    auto * backend = new sockman::simulated_backend();
+    sockman::manager manager{std::unique_ptr<sockman::backend>(backend)};
+    error_handler handler;
+
+    manager.add(simulated_fd, handler);
+    backend->trigger(simulated_fd, EPOLLERR | EPOLLHUP);
+    manager.service(0);
+    ASSERT_EQ(1, handler.errors);
+    ASSERT_EQ(0, handler.closed);
+
+    backend->trigger(simulated_fd, EPOLLHUP);
+    manager.service(0);
+    ASSERT_EQ(1, handler.closed);
+}
@@ -0,0 +1,261 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/event_source.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <csignal>
+#include <string>
+#include <system_error>
+#include <thread>
+
+TEST(timer_source, one_shot)
+{
+    sockman::manager manager;
+
+    uint64_t expirations = 0;
+    sockman::timer_source timer(manager, [&manager, &expirations](uint64_t value) {
+        expirations += value;
+        manager.stop();
+    });
+    timer.start(std::chrono::microseconds(100));
+
+    manager.run_for(std::chrono::seconds(5));
+    ASSERT_EQ(1, expirations);
+}
+
+TEST(timer_source, fail_to_start_with_negative_timeout)
+{
+    sockman::manager manager;
+    sockman::timer_source timer(manager, [](uint64_t) {});
+
+    ASSERT_THROW(timer.start(std::chrono::milliseconds(-1)), std::exception);
+    ASSERT_THROW(timer.start(std::chrono::milliseconds(1), std::chrono::milliseconds(-1)), std::exception);
+    ASSERT_THROW(timer.start_at(std::chrono::steady_clock::now(), std::chrono::milliseconds(-1)), std::exception);
+}
+
+TEST(timer_source, counts_missed_expirations)
+{
+    sockman::manager manager;
+
+    uint64_t expirations = 0;
+    sockman::timer_source timer(manager, [&expirations](uint64_t value) {
+        expirations += value;
+    });
+    timer.start(std::chrono::milliseconds(1), std::chrono::milliseconds(1));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    manager.service(0);
+
+    ASSERT_LE(5, expirations);
+}
+
+TEST(timer_source, start_at_deadline)
+{
+    sockman::manager manager;
+
+    bool expired = false;
+    sockman::timer_source timer(manager, [&manager, &expired](uint64_t) {
+        expired = true;
+        manager.stop();
+    });
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(200);
+    timer.start_at(deadline);
+    manager.run_for(std::chrono::seconds(5));
+
+    ASSERT_TRUE(expired);
+    ASSERT_GE(std::chrono::steady_clock::now(), deadline);
+}
+
+TEST(timer_source, stop)
+{
+    sockman::manager manager;
+
+    sockman::timer_source timer(manager, [](uint64_t) { FAIL(); });
+    timer.start(std::chrono::microseconds(100));
+    timer.stop();
+
+    manager.run_for(std::chrono::milliseconds(2));
+}
+
+TEST(eventfd_source, notify)
+{
+    sockman::manager manager;
+
+    uint64_t received = 0;
+    sockman::eventfd_source source(manager, [&received](uint64_t value) {
+        received = value;
+    });
+    source.notify(2);
+    source.notify(3);
+
+    manager.service(0);
+    ASSERT_EQ(5, received);
+}
+
+TEST(eventfd_source, notify_from_other_thread)
+{
+    sockman::manager manager;
+
+    sockman::eventfd_source source(manager, [&manager](uint64_t) {
+        manager.stop();
+    });
+    std::thread notifier([&source]() {
+        source.notify();
+    });
+
+    manager.run_for(std::chrono::seconds(5));
+    notifier.join();
+}
+
+TEST(signal_source, drains_all_signals)
+{
+    sockman::manager manager;
+
+    int usr1 = 0;
+    int usr2 = 0;
+    sockman::signal_source source(manager, {SIGUSR1, SIGUSR2}, [&usr1, &usr2](signalfd_siginfo const & info) {
+        if (SIGUSR1 == info.ssi_signo) { usr1++; }
+        if (SIGUSR2 == info.ssi_signo) { usr2++; }
+    });
+
+    ::raise(SIGUSR1);
+    ::raise(SIGUSR2);
+    manager.service(0);
+
+    ASSERT_EQ(1, usr1);
+    ASSERT_EQ(1, usr2);
+}
+
+TEST(signal_source, shares_signalfd_with_manager)
+{
+    sockman::manager manager;
+
+    int usr1 = 0;
+    int usr2 = 0;
+    manager.on_signal(SIGUSR1, [&usr1](signalfd_siginfo const &) {
+        usr1++;
+    });
+
+    {
+        sockman::signal_source source(manager, {SIGUSR2}, [&usr2](signalfd_siginfo const &) {
+            usr2++;
+        });
+
+        ::raise(SIGUSR1);
+        ::raise(SIGUSR2);
+        manager.service(0);
+        ASSERT_EQ(1, usr1);
+        ASSERT_EQ(1, usr2);
+    }
+
+    // the handler of the manager is kept
+    ::raise(SIGUSR1);
+    manager.service(0);
+    ASSERT_EQ(2, usr1);
+    ASSERT_EQ(1, usr2);
+}
+
+TEST(signal_source, invalid_signal)
+{
+    sockman::manager manager;
+
+    ASSERT_THROW({
+        sockman::signal_source source(manager, {-1}, [](signalfd_siginfo const &) {});
+    }, std::exception);
+}
+
+TEST(inotify_source, batch)
+{
+    char path[] = "/tmp/sockman_inotify_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(path));
+    std::string const dir = path;
+
+    sockman::manager manager;
+    std::vector<sockman::inotify_record> records;
+    sockman::inotify_source source(manager, [&records](std::vector<sockman::inotify_record> const & batch) {
+        records.insert(records.end(), batch.begin(), batch.end());
+    });
+    int const wd = source.add_watch(dir, IN_CREATE);
+
+    for (auto const & name: {"a", "b"})
+    {
+        int fd = ::open((dir + "/" + name).c_str(), O_CREAT | O_WRONLY, 0644);
+        ::close(fd);
+    }
+
+    manager.service(0);
+    source.remove_watch(wd);
+
+    ::unlink((dir + "/a").c_str());
+    ::unlink((dir + "/b").c_str());
+    ::rmdir(path);
+
+    ASSERT_EQ(2, records.size());
+    ASSERT_EQ(wd, records[0].wd);
+    ASSERT_NE(0, records[0].mask & IN_CREATE);
+    ASSERT_EQ("a", records[0].name);
+    ASSERT_EQ("b", records[1].name);
+}
+
+TEST(inotify_source, add_watch_fails_with_invalid_path)
+{
+    sockman::manager manager;
+    sockman::inotify_source source(manager, [](std::vector<sockman::inotify_record> const &) {});
+
+    ASSERT_THROW({
+        source.add_watch("/non/existing/path", IN_CREATE);
+    }, std::exception);
+}
+
+TEST(process_source, exit_status_of_child)
+{
+    pid_t const pid = fork();
+    if (0 == pid)
+    {
+        _exit(42);
+    }
+
+    sockman::manager manager;
+    int status = -1;
+    int calls = 0;
+    sockman::process_source source(manager, pid, [&manager, &status, &calls](siginfo_t const & info) {
+        status = info.si_status;
+        calls++;
+        manager.stop();
+    });
+
+    manager.run_for(std::chrono::seconds(5));
+    manager.service(0);
+
+    ASSERT_EQ(1, calls);
+    ASSERT_EQ(42, status);
+}
+
+TEST(process_source, fails_for_invalid_process)
+{
+    sockman::manager manager;
+
+    try
+    {
+        sockman::process_source source(manager, -1, [](siginfo_t const &) {});
+        FAIL();
+    }
+    catch (std::system_error const & error)
+    {
+        ASSERT_EQ(EINVAL, error.code().value());
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/handoff.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using sockman_test::socket_pair;
+
+namespace
+{
+
+std::string read_string(int fd, std::size_t length)
+{
+    std::string result(length, '\0');
+    auto const count = ::recv(fd, &result[0], length, MSG_DONTWAIT);
+    result.resize((0 < count) ? static_cast<std::size_t>(count) : 0);
+    return result;
+}
+
+std::size_t open_descriptors()
+{
+    std::size_t count = 0;
+    for (int fd = 0; fd < 1024; fd++)
+    {
+        if (0 <= ::fcntl(fd, F_GETFD))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+}
+
+TEST(handoff, detach_and_attach)
+{
+    sockman::manager first;
+    sockman::manager second;
+    socket_pair sockets;
+    int received = 0;
+
+    first.add(sockets.fds[0], sockman::readable, [](int, sockman::socket_events) {});
+    first.track_inactivity(sockets.fds[0]);
+    first.cork();
+    first.send(sockets.fds[0], "foo", 3);
+
+    auto const state = first.detach(sockets.fds[0]);
+    first.uncork();
+    ASSERT_EQ(sockets.fds[0], state.sock);
+    ASSERT_EQ(sockman::readable, state.events);
+    ASSERT_TRUE(state.track_inactivity);
+    ASSERT_EQ("foo", state.pending_output);
+    ASSERT_EQ("", read_string(sockets.fds[1], 16));
+
+    // events while detached are not lost
+    ASSERT_EQ(1, ::write(sockets.fds[1], "x", 1));
+
+    second.attach(state, [&received](int, sockman::socket_events events) {
+        if (events.readable())
+        {
+            received++;
+        }
+    });
+    ASSERT_EQ("foo", read_string(sockets.fds[1], 16));
+
+    second.service(0);
+    ASSERT_EQ(1, received);
+
+    second.remove(sockets.fds[0]);
+}
+
+TEST(handoff, detach_fails_with_unmanaged_socket)
+{
+    sockman::manager manager;
+
+    ASSERT_THROW(manager.detach(42), std::exception);
+}
+
+TEST(handoff, transfer_sockets)
+{
+    constexpr std::size_t const count = sockman::handoff_batch_size + 10;
+    socket_pair channel;
+    std::vector<socket_pair> connections(count);
+
+    std::vector<sockman::socket_state> sent;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        sent.push_back({connections[i].fds[0], sockman::readable, (0 == (i % 2)), std::string(i % 7, 'a')});
+    }
+
+    std::vector<sockman::socket_state> received;
+    std::thread receiver([&]() {
+        received = sockman::receive_sockets(channel.fds[1]);
+    });
+    sockman::send_sockets(channel.fds[0], sent);
+    receiver.join();
+
+    ASSERT_EQ(count, received.size());
+    for (std::size_t i = 0; i < count; i++)
+    {
+        ASSERT_NE(sent[i].sock, received[i].sock);
+        ASSERT_EQ(sent[i].events, received[i].events);
+        ASSERT_EQ(sent[i].track_inactivity, received[i].track_inactivity);
+        ASSERT_EQ(sent[i].pending_output, received[i].pending_output);
+    }
+
+    // the received descriptor refers to the same connection
+    connections[3].close(0);
+    ASSERT_EQ(1, ::write(connections[3].fds[1], "z", 1));
+    ASSERT_EQ("z", read_string(received[3].sock, 1));
+
+    for (auto const & state: received)
+    {
+        ::close(state.sock);
+    }
+}
+
+TEST(handoff, transfer_nothing)
+{
+    socket_pair channel;
+
+    sockman::send_sockets(channel.fds[0], {});
+    auto const received = sockman::receive_sockets(channel.fds[1]);
+    ASSERT_TRUE(received.empty());
+}
+
+TEST(handoff, rejects_oversized_payload)
+{
+    socket_pair channel;
+    socket_pair connection;
+
+    // header of a batch with one socket and an oversized payload
+    struct
+    {
+        uint32_t magic;
+        uint32_t count;
+        uint64_t payload_size;
+    } header = {0x534b4d48, 1, sockman::handoff_max_payload_size + 1};
+
+    iovec iov;
+    iov.iov_base = reinterpret_cast<void*>(&header);
+    iov.iov_len = sizeof(header);
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr * cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &connection.fds[0], sizeof(int));
+
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(header)), ::sendmsg(channel.fds[0], &message, 0));
+
+    std::size_t const before = open_descriptors();
+    ASSERT_THROW(sockman::receive_sockets(channel.fds[1]), std::exception);
+    ASSERT_EQ(before, open_descriptors());
+}
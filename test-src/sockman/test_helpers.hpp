@@ -0,0 +1,102 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SOCKMAN_TEST_HELPERS_HPP
+#define SOCKMAN_TEST_HELPERS_HPP
+
+#include <sockman/sockman.hpp>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+namespace sockman_test
+{
+
+/// @brief connected pair of local stream sockets, closed on destruction
+class socket_pair
+{
+    socket_pair(socket_pair const &) = delete;
+    socket_pair& operator=(socket_pair const &) = delete;
+public:
+    /// @param flags additional socket type flags, e.g. SOCK_NONBLOCK
+    explicit socket_pair(int flags = 0)
+    {
+        if (0 != ::socketpair(AF_LOCAL, SOCK_STREAM | flags, 0, fds))
+        {
+            throw std::runtime_error("failed to create socket pair");
+        }
+    }
+
+    ~socket_pair()
+    {
+        close(0);
+        close(1);
+    }
+
+    int get0() const
+    {
+        return fds[0];
+    }
+
+    int get1() const
+    {
+        return fds[1];
+    }
+
+    /// @brief closes one side of the pair early
+    void close(int index)
+    {
+        if (0 <= fds[index])
+        {
+            ::close(fds[index]);
+            fds[index] = -1;
+        }
+    }
+
+    /// @brief reads everything available from the second socket
+    /// @note the socket must be non-blocking
+    std::size_t drain()
+    {
+        char buffer[4096];
+        std::size_t total = 0;
+        ssize_t count = ::read(fds[1], buffer, sizeof(buffer));
+        while (0 < count)
+        {
+            total += static_cast<std::size_t>(count);
+            count = ::read(fds[1], buffer, sizeof(buffer));
+        }
+        return total;
+    }
+
+    int fds[2];
+};
+
+/// @brief manager driven by a simulated backend in virtual time
+template <typename Manager>
+struct basic_simulation
+{
+    basic_simulation()
+    : backend(new sockman::simulated_backend())
+    , manager(std::unique_ptr<sockman::backend>(backend))
+    {
+    }
+
+    sockman::simulated_backend * backend;
+    Manager manager;
+};
+
+using simulation = basic_simulation<sockman::manager>;
+
+// far above the descriptor limit, so no real descriptor is hit
+constexpr int const first_fd = 1000000;
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+using sockman_test::socket_pair;
+
+namespace
+{
+
+void run_for(sockman::manager & manager, std::chrono::milliseconds duration)
+{
+    auto const deadline = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        manager.service(std::chrono::milliseconds(5));
+    }
+}
+
+}
+
+TEST(inactivity, reports_inactive_sockets)
+{
+    sockman::manager manager;
+    socket_pair quiet;
+    socket_pair active;
+    std::vector<int> inactive;
+
+    auto drain = [](int fd, sockman::socket_events) {
+        char buffer[16];
+        auto const count = ::read(fd, buffer, sizeof(buffer));
+        (void) count;
+    };
+    manager.add(quiet.fds[0], sockman::readable, drain);
+    manager.add(active.fds[0], sockman::readable, drain);
+    manager.track_inactivity(quiet.fds[0]);
+    manager.track_inactivity(active.fds[0]);
+
+    manager.set_inactivity_timeout(std::chrono::milliseconds(60), [&](int sock) {
+        inactive.push_back(sock);
+        manager.remove(sock);
+    });
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        ASSERT_EQ(1, ::write(active.fds[1], "x", 1));
+        run_for(manager, std::chrono::milliseconds(10));
+    }
+
+    ASSERT_EQ(std::vector<int>{quiet.fds[0]}, inactive);
+    manager.remove(active.fds[0]);
+}
+
+TEST(inactivity, untracked_sockets_are_ignored)
+{
+    sockman::manager manager;
+    socket_pair sockets;
+    int count = 0;
+
+    manager.add(sockets.fds[0], sockman::readable, [](int, sockman::socket_events){});
+    manager.track_inactivity(sockets.fds[0]);
+    manager.track_inactivity(sockets.fds[0], false);
+    manager.set_inactivity_timeout(std::chrono::milliseconds(20), [&](int) { count++; });
+
+    run_for(manager, std::chrono::milliseconds(80));
+    ASSERT_EQ(0, count);
+
+    manager.remove(sockets.fds[0]);
+}
+
+TEST(inactivity, socket_kept_by_callback_is_reported_again)
+{
+    sockman::manager manager;
+    socket_pair sockets;
+    int count = 0;
+
+    manager.add(sockets.fds[0], sockman::readable, [](int, sockman::socket_events){});
+    manager.track_inactivity(sockets.fds[0]);
+    manager.set_inactivity_timeout(std::chrono::milliseconds(20), [&](int) { count++; });
+
+    run_for(manager, std::chrono::milliseconds(150));
+    ASSERT_LE(2, count);
+
+    manager.remove(sockets.fds[0]);
+}
+
+TEST(inactivity, track_fails_with_unmanaged_socket)
+{
+    sockman::manager manager;
+
+    ASSERT_THROW(manager.track_inactivity(42), std::exception);
+}
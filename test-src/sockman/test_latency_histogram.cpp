@@ -0,0 +1,77 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/trace.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(latency_histogram, empty)
+{
+    sockman::latency_histogram histogram;
+
+    ASSERT_EQ(0, histogram.count());
+    ASSERT_EQ(0, histogram.min());
+    ASSERT_EQ(0, histogram.max());
+    ASSERT_EQ(0, histogram.percentile(50.0));
+}
+
+TEST(latency_histogram, small_values_are_exact)
+{
+    sockman::latency_histogram histogram;
+    for (uint64_t i = 0; i < 8; i++)
+    {
+        histogram.record(i);
+    }
+
+    ASSERT_EQ(8, histogram.count());
+    ASSERT_EQ(0, histogram.min());
+    ASSERT_EQ(7, histogram.max());
+    ASSERT_EQ(3, histogram.percentile(50.0));
+    ASSERT_EQ(7, histogram.percentile(100.0));
+}
+
+TEST(latency_histogram, relative_error_is_bounded)
+{
+    uint64_t const values[] = {9, 100, 1000, 12345, 1000000, 987654321, 1ull << 62};
+    for (auto value: values)
+    {
+        sockman::latency_histogram histogram;
+        histogram.record(0);
+        histogram.record(value);
+        histogram.record(~0ull);
+
+        uint64_t const median = histogram.percentile(50.0);
+        ASSERT_GE(median, value);
+        ASSERT_LE(median - value, value / sockman::latency_histogram::sub_buckets);
+    }
+}
+
+TEST(latency_histogram, percentile)
+{
+    sockman::latency_histogram histogram;
+    for (uint64_t i = 1; i <= 100; i++)
+    {
+        histogram.record(i * 1000);
+    }
+
+    ASSERT_EQ(100, histogram.count());
+    ASSERT_EQ(1000, histogram.min());
+    ASSERT_EQ(100000, histogram.max());
+
+    uint64_t const p99 = histogram.percentile(99.0);
+    ASSERT_GE(p99, 99000);
+    ASSERT_LE(p99, 100000);
+}
+
+TEST(latency_histogram, reset)
+{
+    sockman::latency_histogram histogram;
+    histogram.record(42);
+    histogram.reset();
+
+    ASSERT_EQ(0, histogram.count());
+    ASSERT_EQ(0, histogram.percentile(100.0));
+}
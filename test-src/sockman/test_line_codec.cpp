@@ -0,0 +1,146 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/line_codec.hpp"
+#include "sockman/newline_scan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::vector<std::string> feed(sockman::line_codec & codec, std::string const & data, bool * result = nullptr)
+{
+    std::vector<std::string> lines;
+    bool const ok = codec.feed(data.data(), data.size(), [&lines](sockman::line_view line) {
+        lines.push_back(line.str());
+    });
+
+    if (nullptr != result)
+    {
+        *result = ok;
+    }
+
+    return lines;
+}
+
+}
+
+TEST(find_newline, not_found)
+{
+    std::string const data(100, 'x');
+    ASSERT_EQ(data.size(), sockman::find_newline(data.data(), data.size()));
+    ASSERT_EQ(0, sockman::find_newline(data.data(), 0));
+}
+
+TEST(find_newline, all_positions)
+{
+    for (std::size_t length = 1; length < 200; length++)
+    {
+        for (std::size_t position = 0; position < length; position++)
+        {
+            std::string data(length, 'x');
+            data[position] = '\n';
+
+            ASSERT_EQ(position, sockman::find_newline(data.data(), data.size()));
+            ASSERT_EQ(position, sockman::find_newline_generic(data.data(), data.size()));
+#ifdef SOCKMAN_HAS_X86_SCAN
+            ASSERT_EQ(position, sockman::find_newline_sse2(data.data(), data.size()));
+            if (sockman::has_avx2())
+            {
+                ASSERT_EQ(position, sockman::find_newline_avx2(data.data(), data.size()));
+            }
+#endif
+        }
+    }
+}
+
+TEST(find_newline, first_of_many)
+{
+    std::string data(150, 'x');
+    data[70] = '\n';
+    data[40] = '\n';
+    data[100] = '\n';
+
+    ASSERT_EQ(40, sockman::find_newline(data.data(), data.size()));
+    ASSERT_EQ(30, sockman::find_newline(&data[41], data.size() - 41) + 1);
+}
+
+TEST(line_codec, emits_all_lines_of_one_read)
+{
+    sockman::line_codec codec;
+
+    auto const lines = feed(codec, "foo\nbar\r\n\nbaz\n");
+
+    ASSERT_EQ((std::vector<std::string>{"foo", "bar", "", "baz"}), lines);
+    ASSERT_EQ(0, codec.buffered());
+}
+
+TEST(line_codec, lines_are_views_into_received_data)
+{
+    sockman::line_codec codec;
+    std::string const data = "foo\nbar\n";
+
+    std::vector<char const *> starts;
+    codec.feed(data.data(), data.size(), [&starts](sockman::line_view line) {
+        starts.push_back(line.data);
+    });
+
+    ASSERT_EQ(2, starts.size());
+    ASSERT_EQ(&data[0], starts[0]);
+    ASSERT_EQ(&data[4], starts[1]);
+}
+
+TEST(line_codec, buffers_incomplete_line)
+{
+    sockman::line_codec codec;
+
+    ASSERT_TRUE(feed(codec, "fo").empty());
+    ASSERT_EQ(2, codec.buffered());
+    ASSERT_TRUE(feed(codec, "o\r").empty());
+
+    auto const lines = feed(codec, "\nbar\nba");
+    ASSERT_EQ((std::vector<std::string>{"foo", "bar"}), lines);
+    ASSERT_EQ(2, codec.buffered());
+}
+
+TEST(line_codec, rejects_too_long_line)
+{
+    sockman::line_codec codec(4);
+
+    bool ok = true;
+    feed(codec, "12345", &ok);
+    ASSERT_FALSE(ok);
+    ASSERT_EQ(0, codec.buffered());
+
+    ok = false;
+    auto const lines = feed(codec, "1234\r\n", &ok);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ((std::vector<std::string>{"1234"}), lines);
+}
+
+TEST(line_codec, reset)
+{
+    sockman::line_codec codec;
+    feed(codec, "foo");
+    codec.reset();
+
+    auto const lines = feed(codec, "bar\n");
+    ASSERT_EQ((std::vector<std::string>{"bar"}), lines);
+}
+
+TEST(line_codec, rejects_too_long_complete_line)
+{
+    sockman::line_codec codec(4);
+
+    bool ok = true;
+    auto const lines = feed(codec, "1234\n12345\n", &ok);
+    ASSERT_FALSE(ok);
+    ASSERT_EQ((std::vector<std::string>{"1234"}), lines);
+}
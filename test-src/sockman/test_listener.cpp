@@ -0,0 +1,182 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+class unix_server
+{
+public:
+    unix_server()
+    {
+        char dir[] = "/tmp/sockman_listener_XXXXXX";
+        if (nullptr == mkdtemp(dir))
+        {
+            throw std::runtime_error("failed to create temp dir");
+        }
+        path = std::string(dir) + "/server.sock";
+
+        fd = ::socket(AF_LOCAL, SOCK_STREAM, 0);
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_LOCAL;
+        strcpy(address.sun_path, path.c_str());
+
+        if ((0 != ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))) || (0 != ::listen(fd, 16)))
+        {
+            throw std::runtime_error("failed to listen");
+        }
+    }
+
+    ~unix_server()
+    {
+        for (int client: clients)
+        {
+            ::close(client);
+        }
+        ::close(fd);
+        ::unlink(path.c_str());
+        ::rmdir(path.substr(0, path.rfind('/')).c_str());
+    }
+
+    void connect_clients(int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            int const client = ::socket(AF_LOCAL, SOCK_STREAM, 0);
+            if (0 != ::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+            {
+                ::close(client);
+                throw std::runtime_error("failed to connect");
+            }
+            clients.push_back(client);
+        }
+    }
+
+    int fd;
+    std::string path;
+    sockaddr_un address;
+    std::vector<int> clients;
+};
+
+}
+
+TEST(listener, accepts_connections)
+{
+    sockman::manager manager;
+    unix_server server;
+    std::vector<int> accepted;
+
+    manager.add_listener(server.fd, sockman::listener_options(), [&](int client) {
+        accepted.push_back(client);
+    });
+
+    server.connect_clients(3);
+    manager.service(0);
+    ASSERT_EQ(3, accepted.size());
+
+    manager.remove(server.fd);
+    for (int client: accepted)
+    {
+        ::close(client);
+    }
+}
+
+TEST(listener, max_sockets)
+{
+    sockman::manager manager;
+    unix_server server;
+    std::vector<int> accepted;
+
+    sockman::listener_options options;
+    options.max_sockets = 2;
+    manager.add_listener(server.fd, options, [&](int client) {
+        manager.add(client, 0, [](int, sockman::socket_events){});
+        accepted.push_back(client);
+    });
+
+    server.connect_clients(3);
+    manager.service(0);
+    manager.service(0);
+    ASSERT_EQ(1, accepted.size());
+
+    manager.remove(accepted[0]);
+    manager.service(0);
+    ASSERT_EQ(2, accepted.size());
+
+    manager.remove(server.fd);
+    for (int client: accepted)
+    {
+        manager.remove(client);
+        ::close(client);
+    }
+}
+
+TEST(listener, accept_rate)
+{
+    sockman::manager manager;
+    unix_server server;
+    std::vector<int> accepted;
+
+    sockman::listener_options options;
+    options.accept_rate = 20.0;
+    options.accept_burst = 1;
+    manager.add_listener(server.fd, options, [&](int client) {
+        accepted.push_back(client);
+    });
+
+    server.connect_clients(3);
+    manager.service(0);
+    ASSERT_EQ(1, accepted.size());
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((accepted.size() < 3) && (std::chrono::steady_clock::now() < deadline))
+    {
+        manager.service(100);
+    }
+    ASSERT_EQ(3, accepted.size());
+
+    manager.remove(server.fd);
+    for (int client: accepted)
+    {
+        ::close(client);
+    }
+}
+
+TEST(listener, remove_from_callback)
+{
+    sockman::manager manager;
+    unix_server server;
+    std::vector<int> accepted;
+
+    manager.add_listener(server.fd, sockman::listener_options(), [&](int client) {
+        accepted.push_back(client);
+        manager.remove(server.fd);
+    });
+
+    server.connect_clients(2);
+    manager.service(0);
+    ASSERT_EQ(1, accepted.size());
+
+    for (int client: accepted)
+    {
+        ::close(client);
+    }
+}
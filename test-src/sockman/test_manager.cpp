@@ -14,6 +14,12 @@
 #include <sys/un.h>
 
 #include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <vector>
+#include <memory>
+#include <string>
 
 using ::testing::_;
 
@@ -141,4 +147,523 @@ TEST(socketmanager, move_assign)
     sockman::manager second;
 
     first = std::move(second);
-}
\ No newline at end of file
+}
+TEST(socketmanager, service_with_nanosecond_timeout)
+{
+    sockman::manager manager;
+
+    auto const start = std::chrono::steady_clock::now();
+    manager.service(std::chrono::microseconds(500));
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_GE(elapsed, std::chrono::microseconds(500));
+    ASSERT_LT(elapsed, std::chrono::milliseconds(100));
+}
+
+TEST(socketmanager, service_with_nanosecond_timeout_callback_on_readable)
+{
+    sockman::manager manager;
+    mock_handler handler;
+    EXPECT_CALL(handler, handle(_, EPOLLIN)).Times(1);
+
+    paired_sockets sockets;
+    manager.add(sockets.get0(), EPOLLIN, [&handler](int fd, uint32_t event){handler.handle(fd, event);});
+    char c = 42;
+    ::write(sockets.get1(), &c, 1);
+
+    manager.service(std::chrono::milliseconds(100));
+}
+
+TEST(socketmanager, service_until_deadline)
+{
+    sockman::manager manager;
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(250);
+    manager.service_until(deadline);
+
+    ASSERT_GE(std::chrono::steady_clock::now(), deadline);
+}
+
+TEST(socketmanager, service_until_past_deadline_polls)
+{
+    sockman::manager manager;
+    mock_handler handler;
+    EXPECT_CALL(handler, handle(_, EPOLLOUT)).Times(1);
+
+    paired_sockets sockets;
+    manager.add(sockets.get0(), EPOLLOUT, [&handler](int fd, uint32_t event){handler.handle(fd, event);});
+
+    manager.service_until(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+}
+
+TEST(socketmanager, run_until_stop)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    int calls = 0;
+    manager.add(sockets.get0(), EPOLLOUT, [&manager, &calls](int, uint32_t){
+        calls++;
+        if (calls == 3)
+        {
+            manager.stop();
+        }
+    });
+
+    manager.run();
+    ASSERT_EQ(3, calls);
+}
+
+TEST(socketmanager, stop_from_other_thread_wakes_run)
+{
+    sockman::manager manager;
+
+    std::thread stopper([&manager](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        manager.stop();
+    });
+
+    auto const start = std::chrono::steady_clock::now();
+    manager.run();
+    stopper.join();
+
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(socketmanager, stop_before_run_returns_immediately)
+{
+    sockman::manager manager;
+
+    manager.stop();
+    manager.run();
+}
+
+TEST(socketmanager, run_for_returns_after_duration)
+{
+    sockman::manager manager;
+
+    auto const start = std::chrono::steady_clock::now();
+    manager.run_for(std::chrono::milliseconds(5));
+
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(5));
+}
+
+TEST(socketmanager, idle_hook_runs_between_batches)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    manager.add(sockets.get0(), EPOLLOUT, [](int, uint32_t){});
+
+    int idle_calls = 0;
+    manager.on_idle([&manager, &idle_calls](){
+        idle_calls++;
+        manager.stop();
+    });
+
+    manager.run();
+    ASSERT_EQ(1, idle_calls);
+}
+
+TEST(socketmanager, on_signal)
+{
+    sockman::manager manager;
+
+    int received = 0;
+    manager.on_signal(SIGUSR1, [&manager, &received](signalfd_siginfo const & info){
+        received = static_cast<int>(info.ssi_signo);
+        manager.stop();
+    });
+
+    ::raise(SIGUSR1);
+    manager.run_for(std::chrono::seconds(5));
+
+    ASSERT_EQ(SIGUSR1, received);
+}
+
+TEST(socketmanager, remove_other_socket_during_batch)
+{
+    sockman::manager manager;
+    paired_sockets first;
+    paired_sockets second;
+
+    int calls = 0;
+    auto remove_both = [&manager, &calls, &first, &second](int, uint32_t){
+        calls++;
+        manager.remove(first.get0());
+        manager.remove(second.get0());
+    };
+    manager.add(first.get0(), EPOLLOUT, remove_both);
+    manager.add(second.get0(), EPOLLOUT, remove_both);
+
+    manager.service();
+    ASSERT_EQ(1, calls);
+}
+
+TEST(socketmanager, tracing_records_callbacks)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    manager.add(sockets.get0(), EPOLLOUT, [](int, uint32_t){});
+    manager.enable_tracing(2);
+
+    manager.service();
+    manager.service();
+    manager.service();
+
+    auto const latency = manager.callback_latency(sockets.get0());
+    ASSERT_EQ(3, latency.count());
+
+    auto const trace = manager.dump_trace();
+    ASSERT_EQ(2, trace.size());
+    ASSERT_EQ(sockets.get0(), trace[0].fd);
+    ASSERT_EQ(EPOLLOUT, trace[0].events);
+    ASSERT_LE(trace[0].timestamp, trace[1].timestamp);
+}
+
+TEST(socketmanager, tracing_reports_slow_callbacks)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    manager.add(sockets.get0(), EPOLLOUT, [](int, uint32_t){
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    });
+
+    int slow_fd = -1;
+    manager.enable_tracing(16, std::chrono::milliseconds(1), [&slow_fd](sockman::trace_record const & record) {
+        slow_fd = record.fd;
+    });
+
+    manager.service();
+    ASSERT_EQ(sockets.get0(), slow_fd);
+}
+
+TEST(socketmanager, tracing_disabled_by_default)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    manager.add(sockets.get0(), EPOLLOUT, [](int, uint32_t){});
+    manager.service();
+
+    ASSERT_EQ(0, manager.callback_latency(sockets.get0()).count());
+    ASSERT_TRUE(manager.dump_trace().empty());
+}
+
+TEST(socketmanager, callback_latency_fails_for_unknown_socket)
+{
+    sockman::manager manager;
+
+    ASSERT_THROW({
+        manager.callback_latency(42);
+    }, std::exception);
+}
+
+TEST(socketmanager, add_many)
+{
+    sockman::manager manager;
+    std::vector<std::unique_ptr<paired_sockets>> sockets;
+    std::vector<sockman::registration> registrations;
+
+    int calls = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        sockets.emplace_back(new paired_sockets());
+        registrations.push_back({sockets.back()->get0(), EPOLLOUT, [&manager, &calls](int fd, uint32_t){
+            calls++;
+            manager.remove(fd);
+        }});
+    }
+
+    manager.add_many(std::move(registrations));
+    manager.service(0);
+    manager.service(0);
+
+    ASSERT_EQ(100, calls);
+}
+
+TEST(socketmanager, add_many_replaces_managed_socket)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+    mock_handler handler;
+    EXPECT_CALL(handler, handle(_, EPOLLOUT)).Times(1);
+
+    manager.add(sockets.get0(), EPOLLOUT, [](int, uint32_t){ FAIL(); });
+
+    std::vector<sockman::registration> registrations;
+    registrations.push_back({sockets.get0(), EPOLLOUT, [&handler](int fd, uint32_t event){handler.handle(fd, event);}});
+    manager.add_many(std::move(registrations));
+
+    manager.service();
+}
+
+TEST(socketmanager, add_many_fails_with_invalid_socket)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    std::vector<sockman::registration> registrations;
+    registrations.push_back({sockets.get0(), EPOLLOUT, [](int, uint32_t){ FAIL(); }});
+    registrations.push_back({-1, EPOLLOUT, [](int, uint32_t){}});
+
+    ASSERT_THROW({
+        manager.add_many(std::move(registrations));
+    }, std::exception);
+
+    manager.service(0);
+}
+
+TEST(socketmanager, add_many_restores_replaced_socket_on_failure)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+    mock_handler handler;
+    EXPECT_CALL(handler, handle(_, EPOLLOUT)).Times(1);
+
+    manager.add(sockets.get0(), EPOLLOUT, [&handler](int fd, uint32_t event){handler.handle(fd, event);});
+
+    std::vector<sockman::registration> registrations;
+    registrations.push_back({sockets.get0(), EPOLLOUT, [](int, uint32_t){ FAIL(); }});
+    registrations.push_back({-1, EPOLLOUT, [](int, uint32_t){}});
+
+    ASSERT_THROW({
+        manager.add_many(std::move(registrations));
+    }, std::exception);
+
+    manager.service(0);
+}
+
+TEST(socketmanager, add_many_rejects_duplicate_sockets)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    std::vector<sockman::registration> registrations;
+    registrations.push_back({sockets.get0(), EPOLLOUT, [](int, uint32_t){ FAIL(); }});
+    registrations.push_back({sockets.get0(), EPOLLOUT, [](int, uint32_t){ FAIL(); }});
+
+    ASSERT_THROW({
+        manager.add_many(std::move(registrations));
+    }, std::exception);
+
+    manager.service(0);
+    ASSERT_THROW(manager.notify_on_readable(sockets.get0()), std::exception);
+}
+
+TEST(socketmanager, remove_many)
+{
+    sockman::manager manager;
+    paired_sockets first;
+    paired_sockets second;
+
+    manager.add(first.get0(), EPOLLOUT, [](int, uint32_t){ FAIL(); });
+    manager.add(second.get0(), EPOLLOUT, [](int, uint32_t){ FAIL(); });
+    manager.remove_many({first.get0(), second.get0(), 42});
+
+    manager.service(0);
+}
+
+TEST(socketmanager, native_handle)
+{
+    sockman::manager manager;
+
+    ASSERT_LE(0, manager.native_handle());
+}
+
+TEST(socketmanager, service_with_event_limit)
+{
+    sockman::manager manager;
+    paired_sockets first;
+    paired_sockets second;
+
+    int calls = 0;
+    manager.add(first.get0(), EPOLLOUT, [&calls](int, uint32_t){ calls++; });
+    manager.add(second.get0(), EPOLLOUT, [&calls](int, uint32_t){ calls++; });
+
+    manager.service(0, 1);
+    ASSERT_EQ(1, calls);
+}
+
+TEST(socketmanager, child_manager)
+{
+    sockman::manager parent;
+    sockman::manager child;
+    paired_sockets sockets;
+    mock_handler handler;
+    EXPECT_CALL(handler, handle(_, EPOLLOUT)).Times(1);
+
+    child.add(sockets.get0(), EPOLLOUT, [&handler](int fd, uint32_t event){handler.handle(fd, event);});
+    parent.add(child);
+
+    parent.service();
+}
+
+TEST(socketmanager, child_manager_with_budget)
+{
+    sockman::manager parent;
+    sockman::manager child;
+    std::vector<std::unique_ptr<paired_sockets>> sockets;
+
+    int calls = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        sockets.emplace_back(new paired_sockets());
+        child.add(sockets.back()->get0(), EPOLLOUT, [&child, &calls](int fd, uint32_t){
+            calls++;
+            child.remove(fd);
+        });
+    }
+    parent.add(child, 4);
+
+    parent.service();
+    ASSERT_EQ(4, calls);
+
+    parent.service();
+    parent.service();
+    ASSERT_EQ(10, calls);
+}
+
+TEST(socketmanager, child_manager_can_be_skipped)
+{
+    sockman::manager parent;
+    sockman::manager child;
+    paired_sockets sockets;
+
+    child.add(sockets.get0(), EPOLLOUT, [](int, uint32_t){ FAIL(); });
+    parent.add(child);
+    parent.notify_on_readable(child.native_handle(), false);
+
+    parent.service(0);
+}
+
+TEST(socketmanager, add_self_as_child_fails)
+{
+    sockman::manager manager;
+
+    ASSERT_THROW({
+        manager.add(manager);
+    }, std::exception);
+}
+
+TEST(socketmanager, add_child_without_budget_fails)
+{
+    sockman::manager parent;
+    sockman::manager child;
+
+    ASSERT_THROW({
+        parent.add(child, 0);
+    }, std::exception);
+}
+
+TEST(socketmanager, send)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    manager.add(sockets.get0(), 0, [](int, uint32_t){});
+    manager.send(sockets.get0(), "foo", 3);
+
+    char buffer[4] = {0};
+    ASSERT_EQ(3, ::recv(sockets.get1(), buffer, 3, MSG_DONTWAIT));
+    ASSERT_STREQ("foo", buffer);
+}
+
+TEST(socketmanager, send_fails_with_unmanaged_socket)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    ASSERT_THROW({
+        manager.send(sockets.get0(), "foo", 3);
+    }, std::exception);
+}
+
+TEST(socketmanager, writes_during_dispatch_are_gathered)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+
+    ssize_t available = -1;
+    manager.add(sockets.get0(), EPOLLOUT, [&manager, &sockets, &available](int fd, uint32_t){
+        manager.send(fd, "foo", 3);
+        manager.send(fd, "bar", 3);
+
+        char buffer[8];
+        available = ::recv(sockets.get1(), buffer, sizeof(buffer), MSG_DONTWAIT | MSG_PEEK);
+        manager.notify_on_writable(fd, false);
+    });
+
+    manager.service();
+    ASSERT_EQ(-1, available);
+
+    char buffer[7] = {0};
+    ASSERT_EQ(6, ::recv(sockets.get1(), buffer, 6, MSG_DONTWAIT));
+    ASSERT_STREQ("foobar", buffer);
+}
+
+TEST(socketmanager, cork_scope)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+    manager.add(sockets.get0(), 0, [](int, uint32_t){});
+
+    char buffer[7] = {0};
+    {
+        sockman::cork_scope cork(manager);
+        manager.send(sockets.get0(), "foo", 3);
+        manager.send(sockets.get0(), "bar", 3);
+
+        ASSERT_EQ(6, manager.pending_output(sockets.get0()));
+        ASSERT_EQ(-1, ::recv(sockets.get1(), buffer, 6, MSG_DONTWAIT));
+    }
+
+    ASSERT_EQ(0, manager.pending_output(sockets.get0()));
+    ASSERT_EQ(6, ::recv(sockets.get1(), buffer, 6, MSG_DONTWAIT));
+    ASSERT_STREQ("foobar", buffer);
+}
+
+TEST(socketmanager, flush_while_corked)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+    manager.add(sockets.get0(), 0, [](int, uint32_t){});
+
+    sockman::cork_scope cork(manager);
+    manager.send(sockets.get0(), "foo", 3);
+    manager.flush(sockets.get0());
+
+    char buffer[4] = {0};
+    ASSERT_EQ(3, ::recv(sockets.get1(), buffer, 3, MSG_DONTWAIT));
+}
+
+TEST(socketmanager, send_completes_when_writable)
+{
+    sockman::manager manager;
+    paired_sockets sockets;
+    manager.add(sockets.get0(), 0, [](int, uint32_t){ FAIL(); });
+
+    int const sndbuf = 4096;
+    setsockopt(sockets.get0(), SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    std::string const data(1024 * 1024, 'x');
+    manager.send(sockets.get0(), data.data(), data.size());
+    ASSERT_LT(0, manager.pending_output(sockets.get0()));
+
+    std::string received;
+    char buffer[64 * 1024];
+    while (received.size() < data.size())
+    {
+        manager.service(0);
+        ssize_t const count = ::recv(sockets.get1(), buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (0 < count)
+        {
+            received.append(buffer, static_cast<size_t>(count));
+        }
+    }
+
+    ASSERT_EQ(0, manager.pending_output(sockets.get0()));
+    ASSERT_EQ(data, received);
+}
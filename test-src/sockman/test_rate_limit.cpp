@@ -0,0 +1,240 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+#include "sockman/test_helpers.hpp"
+#include "sockman/rate_shaper.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using sockman_test::socket_pair;
+using sockman_test::simulation;
+using sockman_test::first_fd;
+
+namespace
+{
+
+sockman::shaping_options events_per_second(double rate, std::size_t burst)
+{
+    sockman::shaping_options options;
+    options.receive_events.rate = rate;
+    options.receive_events.burst = burst;
+    return options;
+}
+
+}
+
+TEST(token_bucket, refills_lazily)
+{
+    auto const start = std::chrono::steady_clock::time_point();
+    sockman::token_bucket bucket;
+    sockman::rate_limit limit;
+    limit.rate = 10.0;
+    limit.burst = 2;
+    bucket.configure(limit, start);
+
+    ASSERT_EQ(2u, bucket.available(start));
+    bucket.take(2, start);
+    ASSERT_EQ(0u, bucket.available(start));
+    ASSERT_EQ(start + std::chrono::milliseconds(100), bucket.refilled_at(start));
+
+    ASSERT_EQ(0u, bucket.available(start + std::chrono::milliseconds(50)));
+    ASSERT_EQ(1u, bucket.available(start + std::chrono::milliseconds(100)));
+    ASSERT_EQ(2u, bucket.available(start + std::chrono::seconds(10)));
+}
+
+TEST(token_bucket, unlimited)
+{
+    sockman::token_bucket bucket;
+    bucket.configure(sockman::rate_limit(), std::chrono::steady_clock::time_point());
+
+    ASSERT_FALSE(bucket.limited());
+    ASSERT_LT(1000000u, bucket.available(std::chrono::steady_clock::time_point()));
+}
+
+TEST(rate_limit, disables_readable_interest_until_refilled)
+{
+    simulation sim;
+    int calls = 0;
+
+    sim.manager.add(first_fd, sockman::readable, [&calls](int, sockman::socket_events) {
+        calls++;
+    });
+    sim.manager.set_rate_limit(first_fd, events_per_second(10.0, 2));
+    sim.backend->set_ready(first_fd, EPOLLIN);
+
+    for (int i = 0; i < 5; i++)
+    {
+        sim.manager.service(0);
+    }
+    ASSERT_EQ(2, calls);
+    ASSERT_EQ(0u, sim.backend->interest(first_fd) & EPOLLIN);
+
+    sim.backend->advance(std::chrono::milliseconds(100));
+    sim.manager.service(0);
+    ASSERT_NE(0u, sim.backend->interest(first_fd) & EPOLLIN);
+
+    for (int i = 0; i < 5; i++)
+    {
+        sim.manager.service(0);
+    }
+    ASSERT_EQ(3, calls);
+}
+
+TEST(rate_limit, group_shares_buckets)
+{
+    simulation sim;
+    int calls = 0;
+
+    auto const group = sim.manager.add_rate_group(events_per_second(10.0, 3));
+    for (int i = 0; i < 4; i++)
+    {
+        sim.manager.add(first_fd + i, sockman::readable, [&calls](int, sockman::socket_events) {
+            calls++;
+        });
+        sim.manager.join_rate_group(first_fd + i, group);
+        sim.backend->set_ready(first_fd + i, EPOLLIN);
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        sim.manager.service(0);
+    }
+    ASSERT_EQ(3, calls);
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_EQ(0u, sim.backend->interest(first_fd + i) & EPOLLIN);
+    }
+
+    sim.manager.remove_rate_group(group);
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_NE(0u, sim.backend->interest(first_fd + i) & EPOLLIN);
+    }
+}
+
+TEST(rate_limit, counts_bytes_read)
+{
+    simulation sim;
+    socket_pair pair(SOCK_NONBLOCK);
+    int calls = 0;
+
+    sim.manager.add(pair.fds[0], sockman::readable, [&](int fd, sockman::socket_events) {
+        calls++;
+        char buffer[10];
+        ASSERT_EQ(10, sim.manager.read(fd, buffer, sizeof(buffer)));
+    });
+
+    sockman::shaping_options options;
+    options.receive_bytes.rate = 100.0;
+    options.receive_bytes.burst = 20;
+    sim.manager.set_rate_limit(pair.fds[0], options);
+
+    std::string const data(100, 'x');
+    ASSERT_EQ(100, ::write(pair.fds[1], data.data(), data.size()));
+    sim.backend->set_ready(pair.fds[0], EPOLLIN);
+
+    for (int i = 0; i < 5; i++)
+    {
+        sim.manager.service(0);
+    }
+    ASSERT_EQ(2, calls);
+
+    sim.backend->advance(std::chrono::milliseconds(200));
+    for (int i = 0; i < 5; i++)
+    {
+        sim.manager.service(0);
+    }
+    ASSERT_EQ(4, calls);
+}
+
+TEST(rate_limit, defers_writes_until_refilled)
+{
+    simulation sim;
+    socket_pair pair(SOCK_NONBLOCK);
+
+    sim.manager.add(pair.fds[0], 0, [](int, sockman::socket_events) { });
+
+    sockman::shaping_options options;
+    options.send_bytes.rate = 1000.0;
+    options.send_bytes.burst = 100;
+    sim.manager.set_rate_limit(pair.fds[0], options);
+
+    std::string const data(250, 'x');
+    sim.manager.send(pair.fds[0], data.data(), data.size());
+    ASSERT_EQ(100u, pair.drain());
+    ASSERT_EQ(0u, sim.backend->interest(pair.fds[0]) & EPOLLOUT);
+
+    sim.backend->advance(std::chrono::milliseconds(100));
+    sim.manager.service(0);
+    ASSERT_EQ(100u, pair.drain());
+
+    sim.backend->advance(std::chrono::milliseconds(100));
+    sim.manager.service(0);
+    ASSERT_EQ(50u, pair.drain());
+    ASSERT_EQ(0u, sim.manager.pending_output(pair.fds[0]));
+}
+
+TEST(rate_limit, clear_rate_limit_resumes_socket)
+{
+    simulation sim;
+    socket_pair pair(SOCK_NONBLOCK);
+
+    sim.manager.add(pair.fds[0], 0, [](int, sockman::socket_events) { });
+
+    sockman::shaping_options options;
+    options.send_bytes.rate = 1000.0;
+    options.send_bytes.burst = 100;
+    sim.manager.set_rate_limit(pair.fds[0], options);
+
+    std::string const data(250, 'x');
+    sim.manager.send(pair.fds[0], data.data(), data.size());
+    ASSERT_EQ(100u, pair.drain());
+
+    sim.manager.clear_rate_limit(pair.fds[0]);
+    ASSERT_EQ(150u, pair.drain());
+}
+
+TEST(rate_limit, fail_for_unknown_socket_or_group)
+{
+    simulation sim;
+    sim.manager.add(first_fd, sockman::readable, [](int, sockman::socket_events) { });
+
+    ASSERT_ANY_THROW(sim.manager.set_rate_limit(first_fd + 1, events_per_second(1.0, 1)));
+    ASSERT_ANY_THROW(sim.manager.join_rate_group(first_fd, 42));
+
+    auto const group = sim.manager.add_rate_group(events_per_second(1.0, 1));
+    ASSERT_ANY_THROW(sim.manager.join_rate_group(first_fd + 1, group));
+}
+
+TEST(rate_limit, removed_sockets_leave_group)
+{
+    simulation sim;
+    int calls = 0;
+
+    auto const group = sim.manager.add_rate_group(events_per_second(10.0, 1));
+    sim.manager.add(first_fd, sockman::readable, [&](int fd, sockman::socket_events) {
+        calls++;
+        sim.manager.remove(fd);
+    });
+    sim.manager.join_rate_group(first_fd, group);
+    sim.backend->set_ready(first_fd, EPOLLIN);
+
+    sim.manager.service(0);
+    ASSERT_EQ(1, calls);
+
+    sim.backend->advance(std::chrono::milliseconds(100));
+    sim.manager.service(0);
+    ASSERT_EQ(1, calls);
+}
@@ -0,0 +1,142 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <stdexcept>
+
+using sockman_test::socket_pair;
+
+TEST(ready_list, redispatches_until_drained)
+{
+    sockman::manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    int calls = 0;
+    int received = 0;
+
+    manager.add(pair.fds[0], sockman::readable | sockman::edge_triggered, [&](int fd, auto events) {
+        ASSERT_TRUE(events.readable());
+        calls++;
+        char c;
+        if (1 == manager.read(fd, &c, 1))
+        {
+            received++;
+        }
+    });
+
+    ASSERT_EQ(3, ::write(pair.fds[1], "abc", 3));
+
+    // the kernel reports the edge once; the rest is served from the ready list
+    for (int i = 0; i < 5; i++)
+    {
+        manager.service(0);
+    }
+
+    ASSERT_EQ(3, received);
+    ASSERT_EQ(4, calls);
+
+    manager.service(0);
+    manager.service(0);
+    ASSERT_EQ(4, calls);
+}
+
+TEST(ready_list, nested_child_is_serviced_until_drained)
+{
+    sockman::manager parent;
+    sockman::manager child;
+    socket_pair pair(SOCK_NONBLOCK);
+    int received = 0;
+
+    child.add(pair.fds[0], sockman::readable | sockman::edge_triggered, [&](int fd, auto) {
+        char c;
+        if (1 == child.read(fd, &c, 1))
+        {
+            received++;
+        }
+    });
+    parent.add(child, 10);
+
+    ASSERT_EQ(3, ::write(pair.fds[1], "abc", 3));
+    for (int i = 0; i < 10; i++)
+    {
+        parent.service(10);
+    }
+
+    ASSERT_EQ(3, received);
+}
+
+TEST(ready_list, does_not_block_while_not_drained)
+{
+    sockman::manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    int calls = 0;
+
+    manager.add(pair.fds[0], sockman::readable | sockman::edge_triggered, [&](int, auto) {
+        // leaves data in the socket without hitting EAGAIN
+        calls++;
+    });
+
+    ASSERT_EQ(1, ::write(pair.fds[1], "x", 1));
+    manager.service(0);
+    ASSERT_EQ(1, calls);
+
+    auto const start = std::chrono::steady_clock::now();
+    manager.service(1000);
+    ASSERT_GT(std::chrono::milliseconds(500), std::chrono::steady_clock::now() - start);
+    ASSERT_EQ(2, calls);
+}
+
+TEST(ready_list, skips_removed_sockets)
+{
+    sockman::manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    int calls = 0;
+
+    manager.add(pair.fds[0], sockman::readable | sockman::edge_triggered, [&](int, auto) {
+        calls++;
+    });
+
+    ASSERT_EQ(1, ::write(pair.fds[1], "x", 1));
+    manager.service(0);
+    ASSERT_EQ(1, calls);
+
+    manager.remove(pair.fds[0]);
+    manager.service(0);
+    ASSERT_EQ(1, calls);
+}
+
+TEST(ready_list, delivers_once_per_batch)
+{
+    sockman::manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    int calls = 0;
+
+    manager.add(pair.fds[0], sockman::readable | sockman::edge_triggered, [&](int fd, auto) {
+        calls++;
+        char c;
+        manager.read(fd, &c, 1);
+    });
+
+    ASSERT_EQ(2, ::write(pair.fds[1], "ab", 2));
+    manager.service(0);
+    ASSERT_EQ(1, calls);
+
+    // queued on the ready list and reported by a new edge
+    ASSERT_EQ(1, ::write(pair.fds[1], "c", 1));
+    manager.service(0);
+    ASSERT_EQ(2, calls);
+
+    manager.service(0);
+    ASSERT_EQ(3, calls);
+}
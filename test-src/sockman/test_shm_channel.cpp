@@ -0,0 +1,291 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/shm_channel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+class channel_descriptors
+{
+public:
+    explicit channel_descriptors(std::size_t capacity = 4096)
+    : value(sockman::create_shm_channel(capacity))
+    {
+    }
+
+    ~channel_descriptors()
+    {
+        sockman::close_shm_descriptors(value);
+    }
+
+    sockman::shm_descriptors value;
+};
+
+std::string read_all(sockman::shm_channel & channel)
+{
+    std::string result;
+    char buffer[1024];
+    ssize_t count = channel.read(buffer, sizeof(buffer));
+    while (0 < count)
+    {
+        result.append(buffer, static_cast<std::size_t>(count));
+        count = channel.read(buffer, sizeof(buffer));
+    }
+    return result;
+}
+
+}
+
+TEST(shm_channel, exchange_data)
+{
+    sockman::manager manager;
+    channel_descriptors descriptors;
+    std::string received;
+    std::string reply;
+
+    std::unique_ptr<sockman::shm_channel> first;
+    std::unique_ptr<sockman::shm_channel> second;
+    second.reset(new sockman::shm_channel(manager, descriptors.value, sockman::shm_side::second,
+        [&](int fd, sockman::socket_events events) {
+            ASSERT_EQ(second->native_handle(), fd);
+            if (events.readable())
+            {
+                received += read_all(*second);
+                if (received == "ping")
+                {
+                    ASSERT_EQ(4, second->write("pong", 4));
+                }
+            }
+        }));
+    first.reset(new sockman::shm_channel(manager, descriptors.value, sockman::shm_side::first,
+        [&](int, sockman::socket_events events) {
+            if (events.readable())
+            {
+                reply += read_all(*first);
+            }
+        }));
+
+    ASSERT_EQ(4, first->write("ping", 4));
+    manager.service(100);
+    manager.service(100);
+
+    ASSERT_EQ("ping", received);
+    ASSERT_EQ("pong", reply);
+}
+
+TEST(shm_channel, level_triggered_until_read)
+{
+    sockman::manager manager;
+    channel_descriptors descriptors;
+    int calls = 0;
+
+    std::unique_ptr<sockman::shm_channel> second;
+    sockman::shm_channel first(manager, descriptors.value, sockman::shm_side::first, [](int, sockman::socket_events) { });
+    second.reset(new sockman::shm_channel(manager, descriptors.value, sockman::shm_side::second,
+        [&](int, sockman::socket_events events) {
+            ASSERT_TRUE(events.readable());
+            calls++;
+            char c;
+            ASSERT_EQ(1, second->read(&c, 1));
+        }));
+
+    ASSERT_EQ(3, first.write("abc", 3));
+    for (int i = 0; i < 5; i++)
+    {
+        manager.service(0);
+    }
+
+    ASSERT_EQ(3, calls);
+}
+
+TEST(shm_channel, notifies_only_waiting_reader)
+{
+    sockman::manager manager;
+    channel_descriptors descriptors;
+
+    sockman::shm_channel first(manager, descriptors.value, sockman::shm_side::first, [](int, sockman::socket_events) { });
+    sockman::shm_channel second(manager, descriptors.value, sockman::shm_side::second, [](int, sockman::socket_events) { });
+
+    for (int i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(1, first.write("x", 1));
+    }
+
+    // a single notification for the transition from empty to non-empty
+    uint64_t notifications = 0;
+    ASSERT_EQ(8, ::read(second.native_handle(), &notifications, sizeof(notifications)));
+    ASSERT_EQ(1u, notifications);
+}
+
+TEST(shm_channel, backpressure)
+{
+    constexpr std::size_t const size = 1024 * 1024;
+
+    sockman::manager manager;
+    channel_descriptors descriptors(4096);
+    std::string const data(size, 'x');
+    std::string received;
+    std::size_t written = 0;
+    int blocked = 0;
+
+    std::unique_ptr<sockman::shm_channel> first;
+    std::unique_ptr<sockman::shm_channel> second;
+    auto const send = [&]() {
+        while (written < size)
+        {
+            ssize_t const count = first->write(&(data[written]), size - written);
+            if (0 > count)
+            {
+                ASSERT_EQ(EAGAIN, errno);
+                blocked++;
+                return;
+            }
+            written += static_cast<std::size_t>(count);
+        }
+    };
+
+    first.reset(new sockman::shm_channel(manager, descriptors.value, sockman::shm_side::first,
+        [&](int, sockman::socket_events events) {
+            if (events.writable())
+            {
+                send();
+            }
+        }));
+    second.reset(new sockman::shm_channel(manager, descriptors.value, sockman::shm_side::second,
+        [&](int, sockman::socket_events events) {
+            if (events.readable())
+            {
+                received += read_all(*second);
+            }
+        }));
+
+    send();
+    for (int i = 0; (i < 10000) && (received.size() < size); i++)
+    {
+        manager.service(100);
+    }
+
+    ASSERT_EQ(size, received.size());
+    ASSERT_LT(0, blocked);
+}
+
+TEST(shm_channel, report_closed_peer)
+{
+    sockman::manager manager;
+    channel_descriptors descriptors;
+    bool hungup = false;
+    std::string received;
+
+    std::unique_ptr<sockman::shm_channel> first(new sockman::shm_channel(manager, descriptors.value,
+        sockman::shm_side::first, [](int, sockman::socket_events) { }));
+    std::unique_ptr<sockman::shm_channel> second;
+    second.reset(new sockman::shm_channel(manager, descriptors.value, sockman::shm_side::second,
+        [&](int, sockman::socket_events events) {
+            char buffer[16];
+            ssize_t count = second->read(buffer, sizeof(buffer));
+            while (0 < count)
+            {
+                received.append(buffer, static_cast<std::size_t>(count));
+                count = second->read(buffer, sizeof(buffer));
+            }
+            if ((events.hungup()) && (0 == count))
+            {
+                hungup = true;
+                second.reset();
+            }
+        }));
+
+    ASSERT_EQ(3, first->write("bye", 3));
+    first.reset();
+    manager.service(100);
+
+    ASSERT_TRUE(hungup);
+    ASSERT_EQ("bye", received);
+}
+
+TEST(shm_channel, fail_to_write_to_closed_peer)
+{
+    sockman::manager manager;
+    channel_descriptors descriptors;
+
+    sockman::shm_channel first(manager, descriptors.value, sockman::shm_side::first, [](int, sockman::socket_events) { });
+    {
+        sockman::shm_channel second(manager, descriptors.value, sockman::shm_side::second, [](int, sockman::socket_events) { });
+    }
+
+    ASSERT_EQ(-1, first.write("x", 1));
+    ASSERT_EQ(EPIPE, errno);
+}
+
+TEST(shm_channel, cross_thread_transfer)
+{
+    constexpr std::size_t const size = 4 * 1024 * 1024;
+
+    channel_descriptors descriptors(8192);
+    std::string received;
+
+    std::thread producer([&descriptors]() {
+        sockman::manager manager;
+        std::string const data(size, 'y');
+        std::size_t written = 0;
+        std::unique_ptr<sockman::shm_channel> channel;
+        channel.reset(new sockman::shm_channel(manager, descriptors.value, sockman::shm_side::first,
+            [&](int, sockman::socket_events events) {
+                while ((events.writable()) && (written < size))
+                {
+                    ssize_t const count = channel->write(&(data[written]), size - written);
+                    if (0 > count)
+                    {
+                        return;
+                    }
+                    written += static_cast<std::size_t>(count);
+                }
+            }));
+
+        while (written < size)
+        {
+            ssize_t const count = channel->write(&(data[written]), size - written);
+            if (0 < count)
+            {
+                written += static_cast<std::size_t>(count);
+            }
+            else
+            {
+                manager.service(100);
+            }
+        }
+    });
+
+    sockman::manager manager;
+    std::unique_ptr<sockman::shm_channel> channel;
+    channel.reset(new sockman::shm_channel(manager, descriptors.value, sockman::shm_side::second,
+        [&](int, sockman::socket_events events) {
+            if (events.readable())
+            {
+                received += read_all(*channel);
+            }
+        }));
+
+    for (int i = 0; (i < 100000) && (received.size() < size); i++)
+    {
+        manager.service(100);
+    }
+    producer.join();
+
+    ASSERT_EQ(size, received.size());
+    ASSERT_EQ(std::string::npos, received.find_first_not_of('y'));
+}
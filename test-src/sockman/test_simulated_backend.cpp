@@ -0,0 +1,214 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using sockman_test::simulation;
+using sockman_test::first_fd;
+
+TEST(simulated_backend, dispatches_injected_events)
+{
+    simulation sim;
+    std::vector<int> received;
+
+    sim.manager.add(first_fd, sockman::readable, [&](int fd, sockman::socket_events events) {
+        ASSERT_TRUE(events.readable());
+        received.push_back(fd);
+    });
+
+    sim.backend->trigger(first_fd, EPOLLIN);
+    sim.manager.service(0);
+    sim.manager.service(0);
+    ASSERT_EQ(std::vector<int>{first_fd}, received);
+
+    sim.backend->set_ready(first_fd, EPOLLIN);
+    sim.manager.service(0);
+    sim.manager.service(0);
+    ASSERT_EQ(3, received.size());
+
+    sim.manager.notify_on_readable(first_fd, false);
+    sim.manager.service(0);
+    ASSERT_EQ(3, received.size());
+}
+
+TEST(simulated_backend, many_sockets)
+{
+    simulation sim;
+    constexpr int const count = 100000;
+    std::size_t received = 0;
+
+    std::vector<sockman::registration> registrations;
+    for (int i = 0; i < count; i++)
+    {
+        registrations.push_back({first_fd + i, sockman::readable, [&](int, sockman::socket_events) {
+            received++;
+        }});
+    }
+    sim.manager.add_many(std::move(registrations));
+    ASSERT_EQ(count + 1, sim.backend->watched());
+
+    for (int i = 0; i < count; i++)
+    {
+        sim.backend->trigger(first_fd + i, EPOLLIN);
+    }
+    sim.manager.service(0, count);
+    ASSERT_EQ(count, received);
+}
+
+TEST(simulated_backend, injected_errors)
+{
+    simulation sim;
+
+    sim.backend->fail_next(ENOMEM);
+    ASSERT_THROW(sim.manager.add(first_fd, sockman::readable, [](int, sockman::socket_events){}), std::exception);
+
+    sim.manager.add(first_fd, sockman::readable, [](int, sockman::socket_events){});
+    ASSERT_EQ(EPOLLIN, sim.backend->interest(first_fd));
+
+    sim.backend->fail_next(ENOMEM);
+    ASSERT_THROW(sim.manager.notify_on_writable(first_fd, true), std::exception);
+}
+
+TEST(simulated_backend, level_triggered_sockets_are_served_fairly)
+{
+    simulation sim;
+    std::vector<int> received;
+
+    for (int i = 0; i < 3; i++)
+    {
+        sim.manager.add(first_fd + i, sockman::readable, [&](int fd, sockman::socket_events) {
+            received.push_back(fd - first_fd);
+        });
+        sim.backend->set_ready(first_fd + i, EPOLLIN);
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        sim.manager.service(0, 1);
+    }
+
+    ASSERT_EQ((std::vector<int>{0, 1, 2, 0, 1, 2}), received);
+}
+
+TEST(simulated_backend, shuffle_is_reproducible)
+{
+    auto run = [](uint32_t seed) {
+        simulation sim;
+        std::vector<int> received;
+        sim.backend->shuffle(seed);
+        for (int i = 0; i < 16; i++)
+        {
+            sim.manager.add(first_fd + i, sockman::readable, [&](int fd, sockman::socket_events) {
+                received.push_back(fd);
+            });
+            sim.backend->trigger(first_fd + i, EPOLLIN);
+        }
+        sim.manager.service(0);
+        return received;
+    };
+
+    auto const first = run(42);
+    ASSERT_EQ(16, first.size());
+    ASSERT_EQ(first, run(42));
+    ASSERT_NE(first, run(0));
+}
+
+TEST(simulated_backend, virtual_time)
+{
+    simulation sim;
+    std::vector<int> inactive;
+
+    sim.manager.add(first_fd, sockman::readable, [](int, sockman::socket_events){});
+    sim.manager.track_inactivity(first_fd);
+    sim.manager.set_inactivity_timeout(std::chrono::seconds(60), [&](int fd) {
+        inactive.push_back(fd);
+        sim.manager.remove(fd);
+    });
+
+    auto const start = sim.backend->now();
+    sim.manager.run_for(std::chrono::seconds(30));
+    ASSERT_TRUE(inactive.empty());
+    ASSERT_EQ(start + std::chrono::seconds(30), sim.backend->now());
+
+    sim.manager.run_for(std::chrono::minutes(10));
+    ASSERT_EQ(std::vector<int>{first_fd}, inactive);
+}
+
+TEST(simulated_backend, timers_use_virtual_time)
+{
+    simulation sim;
+    std::vector<int> fired;
+
+    auto const start = sim.manager.now();
+    sim.manager.schedule(start + std::chrono::minutes(1), [&]() { fired.push_back(1); });
+    auto const cancelled = sim.manager.schedule(start + std::chrono::seconds(10), [&]() { fired.push_back(2); });
+    sim.manager.cancel(cancelled);
+
+    sim.manager.run_for(std::chrono::seconds(30));
+    ASSERT_TRUE(fired.empty());
+
+    sim.manager.run_for(std::chrono::minutes(1));
+    ASSERT_EQ(std::vector<int>{1}, fired);
+}
+
+TEST(simulated_backend, oneshot_disarms_after_report)
+{
+    sockman::simulated_backend backend;
+    epoll_event events[4];
+    auto const now = backend.now();
+
+    ASSERT_EQ(0, backend.add(first_fd, EPOLLIN | EPOLLONESHOT, nullptr));
+    backend.set_ready(first_fd, EPOLLIN);
+    ASSERT_EQ(1, backend.wait(events, 4, now));
+    ASSERT_EQ(0, backend.wait(events, 4, now));
+
+    backend.trigger(first_fd, EPOLLHUP);
+    ASSERT_EQ(0, backend.wait(events, 4, now));
+
+    ASSERT_EQ(0, backend.modify(first_fd, EPOLLIN | EPOLLONESHOT, nullptr));
+    ASSERT_EQ(1, backend.wait(events, 4, now));
+    ASSERT_EQ(static_cast<uint32_t>(EPOLLIN | EPOLLHUP), events[0].events);
+    ASSERT_EQ(0, backend.wait(events, 4, now));
+}
+
+TEST(simulated_backend, edge_triggered_reports_edges_only)
+{
+    sockman::simulated_backend backend;
+    epoll_event events[4];
+    auto const now = backend.now();
+
+    ASSERT_EQ(0, backend.add(first_fd, EPOLLIN | EPOLLOUT | EPOLLET, nullptr));
+    backend.set_ready(first_fd, EPOLLIN);
+    ASSERT_EQ(1, backend.wait(events, 4, now));
+    ASSERT_EQ(0, backend.wait(events, 4, now));
+
+    // still readable, only the new writable edge is reported
+    backend.set_ready(first_fd, EPOLLIN | EPOLLOUT);
+    ASSERT_EQ(1, backend.wait(events, 4, now));
+    ASSERT_EQ(static_cast<uint32_t>(EPOLLOUT), events[0].events);
+    ASSERT_EQ(0, backend.wait(events, 4, now));
+
+    // drained and readable again
+    backend.set_ready(first_fd, EPOLLOUT);
+    backend.set_ready(first_fd, EPOLLIN | EPOLLOUT);
+    ASSERT_EQ(1, backend.wait(events, 4, now));
+    ASSERT_EQ(static_cast<uint32_t>(EPOLLIN), events[0].events);
+
+    // modifying the interest reports the current readiness
+    ASSERT_EQ(0, backend.modify(first_fd, EPOLLIN | EPOLLET, nullptr));
+    ASSERT_EQ(1, backend.wait(events, 4, now));
+    ASSERT_EQ(static_cast<uint32_t>(EPOLLIN), events[0].events);
+    ASSERT_EQ(0, backend.wait(events, 4, now));
+}
@@ -0,0 +1,153 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+class tcp_server
+{
+public:
+    tcp_server()
+    {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+
+        socklen_t length = sizeof(address);
+        if ((0 != ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+            || (0 != ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length))
+            || (0 != ::listen(fd, 16)))
+        {
+            ::close(fd);
+            throw std::runtime_error("failed to listen");
+        }
+    }
+
+    ~tcp_server()
+    {
+        for (int client: clients)
+        {
+            ::close(client);
+        }
+        ::close(fd);
+    }
+
+    void connect_client()
+    {
+        int const client = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (0 != ::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+        {
+            ::close(client);
+            throw std::runtime_error("failed to connect");
+        }
+        clients.push_back(client);
+    }
+
+    int fd;
+    sockaddr_in address;
+    std::vector<int> clients;
+};
+
+int get_option(int sock, int level, int name)
+{
+    int value = 0;
+    socklen_t length = sizeof(value);
+    if (0 != ::getsockopt(sock, level, name, &value, &length))
+    {
+        throw std::runtime_error("failed to get socket option");
+    }
+    return value;
+}
+
+}
+
+TEST(socket_options, accepted_sockets_use_profile)
+{
+    sockman::manager manager;
+    tcp_server server;
+    std::vector<int> accepted;
+
+    sockman::listener_options options;
+    options.socket.no_delay = 1;
+    options.socket.keepalive = 1;
+    options.socket.keepalive_idle = 30;
+    options.socket.keepalive_count = 4;
+    options.socket.notsent_lowat = 16384;
+    options.socket.quick_ack = 1;
+    manager.add_listener(server.fd, options, [&accepted](int client) {
+        accepted.push_back(client);
+    });
+
+    server.connect_client();
+    manager.service(1000);
+    ASSERT_EQ(1u, accepted.size());
+
+    int const client = accepted[0];
+    ASSERT_NE(0, get_option(client, IPPROTO_TCP, TCP_NODELAY));
+    ASSERT_NE(0, get_option(client, SOL_SOCKET, SO_KEEPALIVE));
+    ASSERT_EQ(30, get_option(client, IPPROTO_TCP, TCP_KEEPIDLE));
+    ASSERT_EQ(4, get_option(client, IPPROTO_TCP, TCP_KEEPCNT));
+    ASSERT_EQ(16384, get_option(client, IPPROTO_TCP, TCP_NOTSENT_LOWAT));
+
+    manager.remove(server.fd);
+    ::close(client);
+}
+
+TEST(socket_options, unset_options_are_unchanged)
+{
+    tcp_server server;
+    int const before = get_option(server.fd, IPPROTO_TCP, TCP_NODELAY);
+
+    sockman::socket_options options;
+    options.keepalive = 1;
+    sockman::apply_socket_options(server.fd, options);
+
+    ASSERT_EQ(before, get_option(server.fd, IPPROTO_TCP, TCP_NODELAY));
+    ASSERT_NE(0, get_option(server.fd, SOL_SOCKET, SO_KEEPALIVE));
+}
+
+TEST(socket_options, fail_to_apply_tcp_options_to_unix_socket)
+{
+    int fds[2];
+    ASSERT_EQ(0, ::socketpair(AF_LOCAL, SOCK_STREAM, 0, fds));
+
+    sockman::socket_options options;
+    options.no_delay = 1;
+    ASSERT_ANY_THROW(sockman::apply_socket_options(fds[0], options));
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST(socket_options, fail_to_add_listener_with_invalid_options)
+{
+    sockman::manager manager;
+    int fds[2];
+    ASSERT_EQ(0, ::socketpair(AF_LOCAL, SOCK_STREAM, 0, fds));
+
+    sockman::listener_options options;
+    options.socket.keepalive_idle = 30;
+    ASSERT_ANY_THROW(manager.add_listener(fds[0], options, [](int) { }));
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
@@ -0,0 +1,129 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using sockman_test::socket_pair;
+
+TEST(statistics, count_reads)
+{
+    sockman::manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    manager.add(pair.fds[0], sockman::readable, [&](int fd, auto) {
+        char buffer[16];
+        while (0 < manager.read(fd, buffer, sizeof(buffer)))
+        {
+        }
+    });
+
+    ASSERT_EQ(5, ::write(pair.fds[1], "hello", 5));
+    manager.service(0);
+
+    auto const stats = manager.statistics(pair.fds[0]);
+    ASSERT_EQ(pair.fds[0], stats.sock);
+    ASSERT_EQ(5, stats.bytes_received);
+    ASSERT_EQ(2, stats.reads);
+    ASSERT_EQ(1, stats.would_block);
+    ASSERT_EQ(0, stats.bytes_sent);
+    ASSERT_EQ(0, stats.writes);
+}
+
+TEST(statistics, count_writes)
+{
+    sockman::manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    manager.add(pair.fds[0], 0, [](int, auto) { });
+
+    manager.send(pair.fds[0], "hello", 5);
+
+    auto const stats = manager.statistics(pair.fds[0]);
+    ASSERT_EQ(5, stats.bytes_sent);
+    ASSERT_EQ(1, stats.writes);
+    ASSERT_EQ(5, stats.peak_output);
+    ASSERT_EQ(0, stats.would_block);
+    ASSERT_EQ(std::chrono::nanoseconds::zero(), stats.write_blocked);
+}
+
+TEST(statistics, track_blocked_output)
+{
+    sockman::manager manager;
+    socket_pair pair(SOCK_NONBLOCK);
+    int const size = 4096;
+    ASSERT_EQ(0, setsockopt(pair.fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)));
+    manager.add(pair.fds[0], 0, [](int, auto) { });
+
+    std::string const data(1024 * 1024, 'x');
+    manager.send(pair.fds[0], data.data(), data.size());
+    ASSERT_LT(0, manager.pending_output(pair.fds[0]));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    auto stats = manager.statistics(pair.fds[0]);
+    ASSERT_EQ(data.size(), stats.peak_output);
+    ASSERT_LT(stats.bytes_sent, data.size());
+    ASSERT_LE(std::chrono::milliseconds(5), stats.write_blocked);
+
+    while (0 < manager.pending_output(pair.fds[0]))
+    {
+        pair.drain();
+        manager.service(0);
+    }
+    pair.drain();
+
+    stats = manager.statistics(pair.fds[0]);
+    ASSERT_EQ(data.size(), stats.bytes_sent);
+    auto const blocked = stats.write_blocked;
+
+    // no longer blocked, so the time does not advance anymore
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_EQ(blocked, manager.statistics(pair.fds[0]).write_blocked);
+}
+
+TEST(statistics, snapshot_all_sockets)
+{
+    sockman::manager manager;
+    socket_pair first(SOCK_NONBLOCK);
+    socket_pair second(SOCK_NONBLOCK);
+    manager.add(first.fds[0], 0, [](int, auto) { });
+    manager.add(second.fds[0], 0, [](int, auto) { });
+    manager.send(second.fds[0], "abc", 3);
+
+    std::vector<sockman::socket_statistics> snapshot;
+    manager.statistics(snapshot);
+    ASSERT_EQ(2, snapshot.size());
+
+    std::sort(snapshot.begin(), snapshot.end(), [](auto const & a, auto const & b) { return a.sock < b.sock; });
+    auto const & first_stats = (snapshot[0].sock == first.fds[0]) ? snapshot[0] : snapshot[1];
+    auto const & second_stats = (snapshot[0].sock == first.fds[0]) ? snapshot[1] : snapshot[0];
+    ASSERT_EQ(first.fds[0], first_stats.sock);
+    ASSERT_EQ(0, first_stats.bytes_sent);
+    ASSERT_EQ(second.fds[0], second_stats.sock);
+    ASSERT_EQ(3, second_stats.bytes_sent);
+
+    // the snapshot is replaced
+    manager.remove(first.fds[0]);
+    manager.statistics(snapshot);
+    ASSERT_EQ(1, snapshot.size());
+    ASSERT_EQ(second.fds[0], snapshot[0].sock);
+}
+
+TEST(statistics, fail_to_query_unknown_socket)
+{
+    sockman::manager manager;
+    ASSERT_THROW(manager.statistics(42), std::runtime_error);
+}
@@ -0,0 +1,68 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/timer_queue.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using clock_type = sockman::timer_queue::clock;
+
+TEST(timer_queue, empty)
+{
+    sockman::timer_queue timers;
+
+    ASSERT_TRUE(timers.empty());
+    ASSERT_EQ(clock_type::time_point::max(), timers.next_deadline());
+}
+
+TEST(timer_queue, expires_in_deadline_order)
+{
+    sockman::timer_queue timers;
+    auto const now = clock_type::now();
+    std::vector<int> fired;
+
+    timers.schedule(now + std::chrono::seconds(2), [&]() { fired.push_back(2); });
+    timers.schedule(now + std::chrono::seconds(1), [&]() { fired.push_back(1); });
+    timers.schedule(now + std::chrono::seconds(3), [&]() { fired.push_back(3); });
+    ASSERT_EQ(now + std::chrono::seconds(1), timers.next_deadline());
+
+    timers.expire(now + std::chrono::seconds(2));
+    ASSERT_EQ((std::vector<int>{1, 2}), fired);
+    ASSERT_EQ(now + std::chrono::seconds(3), timers.next_deadline());
+}
+
+TEST(timer_queue, cancel)
+{
+    sockman::timer_queue timers;
+    auto const now = clock_type::now();
+    bool fired = false;
+
+    auto const id = timers.schedule(now, [&]() { fired = true; });
+    timers.cancel(id);
+    timers.cancel(id);
+    timers.expire(now);
+
+    ASSERT_FALSE(fired);
+    ASSERT_TRUE(timers.empty());
+}
+
+TEST(timer_queue, schedule_from_callback)
+{
+    sockman::timer_queue timers;
+    auto const now = clock_type::now();
+    int count = 0;
+
+    timers.schedule(now, [&]() {
+        count++;
+        timers.schedule(now + std::chrono::seconds(1), [&]() { count++; });
+    });
+
+    timers.expire(now);
+    ASSERT_EQ(1, count);
+    ASSERT_FALSE(timers.empty());
+}
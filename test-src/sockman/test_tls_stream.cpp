@@ -0,0 +1,313 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/tls_stream.hpp"
+
+#include <gtest/gtest.h>
+
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+// self-signed certificate for localhost, created once per test
+class certificate
+{
+public:
+    certificate()
+    : key(EVP_EC_gen("P-256"))
+    , cert(X509_new())
+    {
+        if ((nullptr == key) || (nullptr == cert))
+        {
+            throw std::runtime_error("failed to create certificate");
+        }
+
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 60 * 60);
+        X509_set_pubkey(cert, key);
+
+        X509_NAME * name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<unsigned char const *>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        if (0 == X509_sign(cert, key, EVP_sha256()))
+        {
+            throw std::runtime_error("failed to sign certificate");
+        }
+    }
+
+    ~certificate()
+    {
+        X509_free(cert);
+        EVP_PKEY_free(key);
+    }
+
+    EVP_PKEY * key;
+    X509 * cert;
+};
+
+class tls_contexts
+{
+public:
+    explicit tls_contexts(bool trust_server = true)
+    : server(SSL_CTX_new(TLS_server_method()))
+    , client(SSL_CTX_new(TLS_client_method()))
+    {
+        SSL_CTX_use_certificate(server, identity.cert);
+        SSL_CTX_use_PrivateKey(server, identity.key);
+
+        SSL_CTX_set_verify(client, SSL_VERIFY_PEER, nullptr);
+        if (trust_server)
+        {
+            X509_STORE_add_cert(SSL_CTX_get_cert_store(client), identity.cert);
+        }
+    }
+
+    ~tls_contexts()
+    {
+        SSL_CTX_free(client);
+        SSL_CTX_free(server);
+    }
+
+    certificate identity;
+    SSL_CTX * server;
+    SSL_CTX * client;
+};
+
+// connected TCP sockets over loopback, as needed by kernel TLS
+class tcp_pair
+{
+public:
+    tcp_pair()
+    {
+        int const listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+
+        client = ::socket(AF_INET, SOCK_STREAM, 0);
+        if ((0 != ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+            || (0 != ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length))
+            || (0 != ::listen(listener, 1))
+            || (0 != ::connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address))))
+        {
+            ::close(client);
+            ::close(listener);
+            throw std::runtime_error("failed to connect");
+        }
+
+        server = ::accept(listener, nullptr, nullptr);
+        ::close(listener);
+    }
+
+    ~tcp_pair()
+    {
+        ::close(client);
+        ::close(server);
+    }
+
+    int client;
+    int server;
+};
+
+template <typename Predicate>
+bool service_until(sockman::manager & manager, Predicate predicate)
+{
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((!predicate()) && (std::chrono::steady_clock::now() < deadline))
+    {
+        manager.service(10);
+    }
+
+    return predicate();
+}
+
+}
+
+TEST(tls_stream, exchange_data)
+{
+    sockman::manager manager;
+    tls_contexts contexts;
+    tcp_pair sockets;
+    std::string received;
+    std::string reply;
+
+    sockman::tls_stream server(manager, sockets.server, contexts.server, sockman::tls_role::server,
+        [&received](sockman::tls_stream & stream, sockman::socket_events events) {
+            if (events.readable())
+            {
+                char buffer[64];
+                ssize_t count = stream.read(buffer, sizeof(buffer));
+                while (0 < count)
+                {
+                    received.append(buffer, static_cast<std::size_t>(count));
+                    count = stream.read(buffer, sizeof(buffer));
+                }
+                if (received == "ping")
+                {
+                    ASSERT_EQ(4, stream.write("pong", 4));
+                }
+            }
+        });
+
+    sockman::tls_stream client(manager, sockets.client, contexts.client, sockman::tls_role::client,
+        [&reply](sockman::tls_stream & stream, sockman::socket_events events) {
+            if (events.writable() && reply.empty())
+            {
+                ASSERT_TRUE(stream.established());
+                ASSERT_EQ(4, stream.write("ping", 4));
+            }
+            if (events.readable())
+            {
+                char buffer[64];
+                ssize_t count = stream.read(buffer, sizeof(buffer));
+                while (0 < count)
+                {
+                    reply.append(buffer, static_cast<std::size_t>(count));
+                    count = stream.read(buffer, sizeof(buffer));
+                }
+            }
+        });
+
+    ASSERT_TRUE(service_until(manager, [&reply]() { return reply == "pong"; }));
+    ASSERT_EQ("ping", received);
+    ASSERT_TRUE(server.established());
+}
+
+TEST(tls_stream, transfer_file_larger_than_socket_buffers)
+{
+    constexpr std::size_t const size = 4 * 1024 * 1024;
+
+    sockman::manager manager;
+    tls_contexts contexts;
+    tcp_pair sockets;
+
+    int const file = memfd_create("sockman_tls", 0);
+    ASSERT_LE(0, file);
+    std::string contents(size, '\0');
+    for (std::size_t i = 0; i < size; i++)
+    {
+        contents[i] = static_cast<char>('a' + (i % 26));
+    }
+    ASSERT_EQ(static_cast<ssize_t>(size), ::write(file, contents.data(), size));
+
+    std::string received;
+    sockman::tls_stream server(manager, sockets.server, contexts.server, sockman::tls_role::server,
+        [&received](sockman::tls_stream & stream, sockman::socket_events events) {
+            if (events.readable())
+            {
+                char buffer[16 * 1024];
+                ssize_t count = stream.read(buffer, sizeof(buffer));
+                while (0 < count)
+                {
+                    received.append(buffer, static_cast<std::size_t>(count));
+                    count = stream.read(buffer, sizeof(buffer));
+                }
+            }
+        });
+
+    off_t offset = 0;
+    int blocked = 0;
+    sockman::tls_stream client(manager, sockets.client, contexts.client, sockman::tls_role::client,
+        [&](sockman::tls_stream & stream, sockman::socket_events events) {
+            if (!events.writable())
+            {
+                return;
+            }
+
+            while (static_cast<std::size_t>(offset) < size)
+            {
+                ssize_t const count = stream.sendfile(file, offset, size - static_cast<std::size_t>(offset));
+                if (0 > count)
+                {
+                    ASSERT_EQ(EAGAIN, errno);
+                    blocked++;
+                    return;
+                }
+                offset += count;
+            }
+        });
+
+    ASSERT_TRUE(service_until(manager, [&received]() { return received.size() == size; }));
+    ASSERT_TRUE(contents == received);
+    ASSERT_LT(0, blocked);
+
+    ::close(file);
+}
+
+TEST(tls_stream, report_failed_handshake_as_error)
+{
+    sockman::manager manager;
+    tls_contexts contexts(false);
+    tcp_pair sockets;
+    bool client_failed = false;
+
+    sockman::tls_stream server(manager, sockets.server, contexts.server, sockman::tls_role::server,
+        [](sockman::tls_stream &, sockman::socket_events) { });
+    sockman::tls_stream client(manager, sockets.client, contexts.client, sockman::tls_role::client,
+        [&client_failed](sockman::tls_stream & stream, sockman::socket_events events) {
+            ASSERT_FALSE(stream.established());
+            if (events.error())
+            {
+                client_failed = true;
+            }
+        });
+
+    ASSERT_TRUE(service_until(manager, [&client_failed]() { return client_failed; }));
+}
+
+TEST(tls_stream, report_closed_connection)
+{
+    sockman::manager manager;
+    tls_contexts contexts;
+    tcp_pair sockets;
+    bool closed = false;
+
+    sockman::tls_stream server(manager, sockets.server, contexts.server, sockman::tls_role::server,
+        [&closed](sockman::tls_stream & stream, sockman::socket_events events) {
+            char buffer[16];
+            if ((events.readable()) && (0 == stream.read(buffer, sizeof(buffer))))
+            {
+                closed = true;
+            }
+        });
+    sockman::tls_stream client(manager, sockets.client, contexts.client, sockman::tls_role::client,
+        [](sockman::tls_stream & stream, sockman::socket_events events) {
+            if (events.writable())
+            {
+                stream.shutdown();
+            }
+        });
+
+    ASSERT_TRUE(service_until(manager, [&closed]() { return closed; }));
+}
+
+TEST(tls_stream, fail_to_create_without_context)
+{
+    sockman::manager manager;
+    tcp_pair sockets;
+
+    ASSERT_ANY_THROW(sockman::tls_stream(manager, sockets.client, nullptr, sockman::tls_role::client,
+        [](sockman::tls_stream &, sockman::socket_events) { }));
+}
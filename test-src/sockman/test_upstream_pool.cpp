@@ -0,0 +1,280 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/upstream_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+class unix_listener
+{
+public:
+    unix_listener()
+    {
+        char dir[] = "/tmp/sockman_upstream_XXXXXX";
+        if (nullptr == mkdtemp(dir))
+        {
+            throw std::runtime_error("failed to create temp dir");
+        }
+        path = std::string(dir) + "/server.sock";
+
+        fd = ::socket(AF_LOCAL, SOCK_STREAM, 0);
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_LOCAL;
+        strcpy(address.sun_path, path.c_str());
+
+        if ((0 != ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))) || (0 != ::listen(fd, 16)))
+        {
+            throw std::runtime_error("failed to listen");
+        }
+    }
+
+    ~unix_listener()
+    {
+        for (int client: clients)
+        {
+            ::close(client);
+        }
+        ::close(fd);
+        ::unlink(path.c_str());
+        ::rmdir(path.substr(0, path.rfind('/')).c_str());
+    }
+
+    int accept()
+    {
+        int const client = ::accept(fd, nullptr, nullptr);
+        clients.push_back(client);
+        return client;
+    }
+
+    sockaddr const * addr() const
+    {
+        return reinterpret_cast<sockaddr const *>(&address);
+    }
+
+    socklen_t length() const
+    {
+        return sizeof(address);
+    }
+
+    int fd;
+    std::string path;
+    sockaddr_un address;
+    std::vector<int> clients;
+};
+
+}
+
+TEST(manager_connect, connects_asynchronously)
+{
+    unix_listener listener;
+    sockman::manager manager;
+
+    int const sock = ::socket(AF_LOCAL, SOCK_STREAM, 0);
+    int result = -1;
+    int connected_fd = -1;
+    manager.connect(sock, listener.addr(), listener.length(), [&](int fd, int error) {
+        connected_fd = fd;
+        result = error;
+        manager.stop();
+    });
+
+    manager.run_for(std::chrono::seconds(5));
+
+    ASSERT_EQ(sock, connected_fd);
+    ASSERT_EQ(0, result);
+    ASSERT_EQ(0, fcntl(sock, F_GETFL) & O_NONBLOCK);
+    ::close(sock);
+}
+
+TEST(manager_connect, reports_error_asynchronously)
+{
+    sockman::manager manager;
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_LOCAL;
+    strcpy(address.sun_path, "/tmp/sockman_non_existing.sock");
+
+    int const sock = ::socket(AF_LOCAL, SOCK_STREAM, 0);
+    int result = 0;
+    manager.connect(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address), [&](int, int error) {
+        result = error;
+        manager.stop();
+    });
+    ASSERT_EQ(0, result);
+
+    manager.run_for(std::chrono::seconds(5));
+    ASSERT_NE(0, result);
+    ::close(sock);
+}
+
+TEST(manager_connect, fails_with_invalid_socket)
+{
+    sockman::manager manager;
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+
+    ASSERT_THROW({
+        manager.connect(-1, reinterpret_cast<sockaddr*>(&address), sizeof(address), [](int, int) {});
+    }, std::exception);
+}
+
+TEST(upstream_pool, acquire_and_reuse)
+{
+    unix_listener listener;
+    sockman::manager manager;
+    sockman::upstream_pool pool(manager);
+    pool.add_upstream("backend", listener.addr(), listener.length());
+
+    int first = -1;
+    pool.acquire("backend", [&](int fd, int error) {
+        ASSERT_EQ(0, error);
+        first = fd;
+        manager.stop();
+    });
+    ASSERT_EQ(1, pool.pending_connects());
+
+    manager.run_for(std::chrono::seconds(5));
+    ASSERT_LE(0, first);
+    ASSERT_EQ(0, pool.pending_connects());
+    listener.accept();
+
+    pool.release("backend", first);
+    ASSERT_EQ(1, pool.idle_count("backend"));
+
+    int second = -1;
+    pool.acquire("backend", [&](int fd, int) {
+        second = fd;
+    });
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(0, pool.idle_count("backend"));
+
+    pool.release("backend", second, false);
+    ASSERT_EQ(0, pool.idle_count("backend"));
+}
+
+TEST(upstream_pool, evicts_hung_up_idle_connection)
+{
+    unix_listener listener;
+    sockman::manager manager;
+    sockman::upstream_pool pool(manager);
+    pool.add_upstream("backend", listener.addr(), listener.length());
+
+    int connection = -1;
+    pool.acquire("backend", [&](int fd, int) {
+        connection = fd;
+        manager.stop();
+    });
+    manager.run_for(std::chrono::seconds(5));
+
+    int const server_side = listener.accept();
+    pool.release("backend", connection);
+    ASSERT_EQ(1, pool.idle_count("backend"));
+
+    ::close(server_side);
+    listener.clients.clear();
+    manager.service(100);
+
+    ASSERT_EQ(0, pool.idle_count("backend"));
+}
+
+TEST(upstream_pool, limits_concurrent_connects)
+{
+    unix_listener listener;
+    sockman::manager manager;
+    sockman::upstream_pool_options options;
+    options.max_concurrent_connects = 1;
+    sockman::upstream_pool pool(manager, options);
+    pool.add_upstream("backend", listener.addr(), listener.length());
+
+    std::vector<int> connections;
+    for (int i = 0; i < 3; i++)
+    {
+        pool.acquire("backend", [&](int fd, int error) {
+            ASSERT_EQ(0, error);
+            connections.push_back(fd);
+            if (3 == connections.size())
+            {
+                manager.stop();
+            }
+        });
+        ASSERT_EQ(1, pool.pending_connects());
+    }
+
+    manager.run_for(std::chrono::seconds(5));
+    ASSERT_EQ(3, connections.size());
+
+    for (int fd: connections)
+    {
+        ::close(fd);
+    }
+}
+
+TEST(upstream_pool, acquire_fails_with_unknown_upstream)
+{
+    sockman::manager manager;
+    sockman::upstream_pool pool(manager);
+
+    ASSERT_THROW({
+        pool.acquire("unknown", [](int, int) {});
+    }, std::exception);
+}
+
+TEST(upstream_pool, closes_idle_connection_after_timeout)
+{
+    sockman::manager manager;
+    sockman::upstream_pool_options options;
+    options.idle_timeout = std::chrono::milliseconds(10);
+    sockman::upstream_pool pool(manager, options);
+    unix_listener listener;
+    pool.add_upstream("backend", listener.addr(), listener.length());
+
+    int fds[2];
+    ASSERT_EQ(0, ::socketpair(AF_LOCAL, SOCK_STREAM, 0, fds));
+    pool.release("backend", fds[0]);
+    ASSERT_EQ(1, pool.idle_count("backend"));
+
+    manager.run_for(std::chrono::milliseconds(100));
+    ASSERT_EQ(0, pool.idle_count("backend"));
+
+    char c;
+    ASSERT_EQ(0, ::read(fds[1], &c, 1));
+    ::close(fds[1]);
+}
+
+TEST(upstream_pool, reports_socket_failure_asynchronously)
+{
+    sockman::manager manager;
+    sockman::upstream_pool pool(manager);
+
+    sockaddr_storage address;
+    memset(&address, 0, sizeof(address));
+    address.ss_family = AF_MAX;
+    pool.add_upstream("invalid", reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+    int error = 0;
+    pool.acquire("invalid", [&](int fd, int err) {
+        ASSERT_EQ(-1, fd);
+        error = err;
+    });
+    ASSERT_EQ(0, error);
+
+    manager.service(0);
+    ASSERT_NE(0, error);
+}
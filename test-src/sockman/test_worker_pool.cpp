@@ -0,0 +1,220 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/sockman.hpp"
+#include "sockman/test_helpers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using sockman_test::socket_pair;
+
+namespace
+{
+
+template<typename Predicate>
+void service_until(sockman::manager & manager, Predicate done)
+{
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((!done()) && (std::chrono::steady_clock::now() < deadline))
+    {
+        manager.service(10);
+    }
+}
+
+}
+
+TEST(worker_pool, runs_tasks)
+{
+    std::atomic<int> count(0);
+    {
+        sockman::worker_pool pool(4);
+        ASSERT_EQ(4, pool.size());
+
+        for (int i = 0; i < 1000; i++)
+        {
+            pool.submit([&count]() { count++; });
+        }
+    }
+
+    ASSERT_EQ(1000, count);
+}
+
+TEST(worker_pool, tasks_submitted_by_workers)
+{
+    std::atomic<int> count(0);
+    {
+        sockman::worker_pool pool(2);
+        pool.submit([&]() {
+            for (int i = 0; i < 100; i++)
+            {
+                pool.submit([&count]() { count++; });
+            }
+        });
+    }
+
+    ASSERT_EQ(100, count);
+}
+
+TEST(worker_pool, post)
+{
+    sockman::manager manager;
+    bool done = false;
+
+    std::thread thread([&manager, &done]() {
+        manager.post([&done]() { done = true; });
+    });
+    thread.join();
+
+    service_until(manager, [&done]() { return done; });
+    ASSERT_TRUE(done);
+}
+
+TEST(worker_pool, offload_completes_in_order)
+{
+    sockman::worker_pool pool(4);
+    sockman::manager manager;
+    socket_pair sockets;
+    std::vector<int> results;
+
+    manager.add(sockets.fds[0], sockman::readable, [](int, sockman::socket_events) {});
+
+    for (int i = 0; i < 8; i++)
+    {
+        manager.offload(pool, sockets.fds[0], [i]() {
+            // later work finishes first
+            std::this_thread::sleep_for(std::chrono::milliseconds(8 - i));
+            return i;
+        }, [&results](int value) {
+            results.push_back(value);
+        });
+    }
+    ASSERT_EQ(8, manager.pending_offloads(sockets.fds[0]));
+
+    service_until(manager, [&results]() { return results.size() == 8; });
+    ASSERT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}), results);
+    ASSERT_EQ(0, manager.pending_offloads(sockets.fds[0]));
+
+    manager.remove(sockets.fds[0]);
+}
+
+TEST(worker_pool, socket_is_disarmed_while_work_is_outstanding)
+{
+    sockman::worker_pool pool(1);
+    sockman::manager manager;
+    socket_pair sockets;
+    int readable = 0;
+    std::atomic<bool> release(false);
+    bool completed = false;
+
+    manager.add(sockets.fds[0], sockman::readable, [&readable](int, sockman::socket_events) {
+        readable++;
+    });
+
+    manager.offload(pool, sockets.fds[0], [&release]() {
+        while (!release)
+        {
+            std::this_thread::yield();
+        }
+        return std::string("done");
+    }, [&completed](std::string const & value) {
+        completed = ("done" == value);
+    });
+
+    ASSERT_EQ(1, ::write(sockets.fds[1], "x", 1));
+    manager.service(10);
+    manager.service(10);
+    ASSERT_EQ(0, readable);
+
+    release = true;
+    service_until(manager, [&readable]() { return readable > 0; });
+    ASSERT_TRUE(completed);
+    ASSERT_LT(0, readable);
+
+    manager.remove(sockets.fds[0]);
+}
+
+TEST(worker_pool, completion_of_removed_socket_is_dropped)
+{
+    sockman::worker_pool pool(1);
+    sockman::manager manager;
+    socket_pair sockets;
+    bool completed = false;
+    bool marker = false;
+
+    manager.add(sockets.fds[0], sockman::readable, [](int, sockman::socket_events) {});
+    manager.offload(pool, sockets.fds[0], []() { return 42; }, [&completed](int) {
+        completed = true;
+    });
+    manager.remove(sockets.fds[0]);
+
+    // posts are processed in order, so the marker runs after the dropped completion
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    manager.post([&marker]() { marker = true; });
+    service_until(manager, [&marker]() { return marker; });
+    ASSERT_FALSE(completed);
+}
+
+TEST(worker_pool, socket_is_rearmed_after_throwing_completion)
+{
+    sockman::worker_pool pool(1);
+    sockman::manager manager;
+    socket_pair sockets;
+    int readable = 0;
+    int completed = 0;
+
+    manager.add(sockets.fds[0], sockman::readable, [&readable](int, sockman::socket_events) {
+        readable++;
+    });
+
+    manager.offload(pool, sockets.fds[0], []() { return 1; }, [&completed](int) {
+        completed++;
+        throw std::runtime_error("completion failed");
+    });
+    manager.offload(pool, sockets.fds[0], []() { return 2; }, [&completed](int) {
+        completed++;
+    });
+
+    bool thrown = false;
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((!thrown) && (std::chrono::steady_clock::now() < deadline))
+    {
+        try
+        {
+            manager.service(10);
+        }
+        catch (std::runtime_error const &)
+        {
+            thrown = true;
+        }
+    }
+    ASSERT_TRUE(thrown);
+
+    ASSERT_EQ(1, ::write(sockets.fds[1], "x", 1));
+    service_until(manager, [&]() { return (readable > 0) && (completed == 2); });
+    ASSERT_EQ(2, completed);
+    ASSERT_LT(0, readable);
+    ASSERT_EQ(0, manager.pending_offloads(sockets.fds[0]));
+
+    manager.remove(sockets.fds[0]);
+}
+
+TEST(worker_pool, offload_fails_with_unmanaged_socket)
+{
+    sockman::worker_pool pool(1);
+    sockman::manager manager;
+
+    ASSERT_THROW(manager.offload(pool, 42, []() { return 0; }, [](int) {}), std::exception);
+}
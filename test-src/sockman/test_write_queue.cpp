@@ -0,0 +1,121 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "sockman/write_queue.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+std::string to_string(sockman::write_queue const & queue)
+{
+    iovec iov[16];
+    int const count = queue.prepare(iov, 16);
+
+    std::string result;
+    for (int i = 0; i < count; i++)
+    {
+        result.append(reinterpret_cast<char const *>(iov[i].iov_base), iov[i].iov_len);
+    }
+
+    return result;
+}
+
+}
+
+TEST(write_queue, empty)
+{
+    sockman::buffer_pool pool;
+    sockman::write_queue queue;
+
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(0, queue.size());
+
+    iovec iov[1];
+    ASSERT_EQ(0, queue.prepare(iov, 1));
+}
+
+TEST(write_queue, coalesces_small_writes)
+{
+    sockman::buffer_pool pool;
+    sockman::write_queue queue;
+    queue.append(pool, "foo", 3);
+    queue.append(pool, "bar", 3);
+
+    iovec iov[4];
+    ASSERT_EQ(1, queue.prepare(iov, 4));
+    ASSERT_EQ(6, queue.size());
+    ASSERT_EQ("foobar", to_string(queue));
+}
+
+TEST(write_queue, large_writes_use_separate_segments)
+{
+    sockman::buffer_pool pool;
+    sockman::write_queue queue;
+    std::string const large(sockman::write_queue::coalesce_limit, 'x');
+    queue.append(pool, "a", 1);
+    queue.append(pool, large.data(), large.size());
+    queue.append(pool, "b", 1);
+
+    iovec iov[4];
+    ASSERT_EQ(3, queue.prepare(iov, 4));
+    ASSERT_EQ("a" + large + "b", to_string(queue));
+}
+
+TEST(write_queue, consume_partial)
+{
+    sockman::buffer_pool pool;
+    sockman::write_queue queue;
+    std::string const large(sockman::write_queue::coalesce_limit, 'x');
+    queue.append(pool, "abc", 3);
+    queue.append(pool, large.data(), large.size());
+
+    queue.consume(2);
+    ASSERT_EQ(1 + large.size(), queue.size());
+    ASSERT_EQ("c" + large, to_string(queue));
+
+    queue.consume(2);
+    ASSERT_EQ(large.size() - 1, queue.size());
+    ASSERT_EQ(large.substr(1), to_string(queue));
+
+    queue.consume(large.size());
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(write_queue, clear)
+{
+    sockman::buffer_pool pool;
+    sockman::write_queue queue;
+    queue.append(pool, "foo", 3);
+    queue.clear();
+
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(write_queue, buffers_are_shared)
+{
+    sockman::buffer_pool pool;
+    sockman::write_queue queue;
+
+    auto buffer = pool.allocate(3);
+    std::memcpy(buffer.data(), "foo", 3);
+    queue.append(buffer);
+    queue.append(pool, "bar", 3);
+
+    iovec iov[4];
+    ASSERT_EQ(2, queue.prepare(iov, 4));
+    ASSERT_EQ(buffer.data(), iov[0].iov_base);
+    ASSERT_EQ(2, buffer.use_count());
+    ASSERT_EQ("foobar", to_string(queue));
+
+    queue.consume(3);
+    ASSERT_EQ(1, buffer.use_count());
+    ASSERT_EQ("foo", std::string(buffer.data(), buffer.size()));
+}